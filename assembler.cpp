@@ -0,0 +1,460 @@
+#include "assembler.h"
+#include <algorithm>
+#include <charconv>
+#include <unordered_map>
+
+namespace {
+
+char upper(char c) { return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c; }
+bool is_digit(char c) { return c >= '0' && c <= '9'; }
+bool is_ident(char c) { return is_digit(c) || (upper(c) >= 'A' && upper(c) <= 'Z') || c == '_' || c == '.' || c == '$'; }
+bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v'; }
+
+std::string_view trim(std::string_view s) {
+    size_t b = 0, e = s.size();
+    while (b < e && is_space(s[b])) ++b;
+    while (e > b && is_space(s[e - 1])) --e;
+    return s.substr(b, e - b);
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) if (upper(a[i]) != upper(b[i])) return false;
+    return true;
+}
+
+// Labels are case-insensitive; keys are string_views into the source, no copies.
+struct NoCaseHash {
+    size_t operator()(std::string_view s) const {
+        uint64_t h = 1469598103934665603ull;
+        for (char c : s) { h ^= static_cast<unsigned char>(upper(c)); h *= 1099511628211ull; }
+        return static_cast<size_t>(h);
+    }
+};
+struct NoCaseEqual { bool operator()(std::string_view a, std::string_view b) const { return iequals(a, b); } };
+
+int8_t gpr_of(std::string_view s) {
+    if (s.size() < 2 || s.size() > 3) return NO_REG;
+    for (int i = 0; i < NUM_GPRS; ++i) if (iequals(s, reg_name(i))) return static_cast<int8_t>(i);
+    return NO_REG;
+}
+
+enum class Kind : uint8_t { Alu, Cmp, Mov, Lea, Load, Store, Unary, Push, Pop, Jump, Ret };
+struct Mnemonic { const char* name; Kind kind; Opcode op; BranchClass branch_class; };
+const Mnemonic MNEMONICS[] = {
+    {"ADD", Kind::Alu, Opcode::ADD, BranchClass::Conditional}, {"SUB", Kind::Alu, Opcode::SUB, BranchClass::Conditional},
+    {"MUL", Kind::Alu, Opcode::MUL, BranchClass::Conditional}, {"DIV", Kind::Alu, Opcode::DIV, BranchClass::Conditional},
+    {"AND", Kind::Alu, Opcode::AND, BranchClass::Conditional}, {"OR", Kind::Alu, Opcode::OR, BranchClass::Conditional},
+    {"XOR", Kind::Alu, Opcode::XOR, BranchClass::Conditional}, {"CMP", Kind::Cmp, Opcode::CMP, BranchClass::Conditional},
+    {"MOV", Kind::Mov, Opcode::MOV, BranchClass::Conditional}, {"LEA", Kind::Lea, Opcode::LEA, BranchClass::Conditional},
+    {"LOAD", Kind::Load, Opcode::LOAD, BranchClass::Conditional}, {"STORE", Kind::Store, Opcode::STORE, BranchClass::Conditional},
+    {"INC", Kind::Unary, Opcode::INC, BranchClass::Conditional}, {"DEC", Kind::Unary, Opcode::DEC, BranchClass::Conditional},
+    {"NOT", Kind::Unary, Opcode::NOT, BranchClass::Conditional}, {"PUSH", Kind::Push, Opcode::STORE, BranchClass::Conditional},
+    {"POP", Kind::Pop, Opcode::LOAD, BranchClass::Conditional}, {"JMP", Kind::Jump, Opcode::JMP, BranchClass::Direct},
+    {"JZ", Kind::Jump, Opcode::JZ, BranchClass::Conditional}, {"JNZ", Kind::Jump, Opcode::JNZ, BranchClass::Conditional},
+    {"JG", Kind::Jump, Opcode::JG, BranchClass::Conditional}, {"JGE", Kind::Jump, Opcode::JGE, BranchClass::Conditional},
+    {"JL", Kind::Jump, Opcode::JL, BranchClass::Conditional}, {"JLE", Kind::Jump, Opcode::JLE, BranchClass::Conditional},
+    {"CALL", Kind::Jump, Opcode::JMP, BranchClass::Call}, {"RET", Kind::Ret, Opcode::JMP_IND, BranchClass::Return}};
+
+const Mnemonic* find_mnemonic(std::string_view word) {
+    for (const Mnemonic& m : MNEMONICS) if (iequals(word, m.name)) return &m;
+    return nullptr;
+}
+
+// A parsed operand: a register, an immediate, or a memory reference [base + index << shift + value].
+// A label term is kept apart and added to value when it is resolved.
+struct Operand {
+    enum Type : uint8_t { Reg, Imm, Mem } type = Imm;
+    int8_t reg = NO_REG, index = NO_REG; uint8_t shift = 0; // Reg: reg; Mem: reg is the base
+    int64_t value = 0;
+    std::string_view label; int label_column = 0;
+    int column = 0;
+    bool constant() const { return type == Imm && label.empty(); }
+};
+
+struct Symbol { int64_t value; bool code; int line; };
+
+struct Fixup {
+    enum Field : uint8_t { Target, Imm, Disp, Data } field;
+    uint32_t index; std::string_view label; int line, column;
+};
+
+class Assembler {
+public:
+    Assembler(std::string_view source, const MachineConfig& config) : src_(source), config_(config) {}
+
+    AssembledProgram run() {
+        size_t pos = 0;
+        while (pos <= src_.size()) {
+            size_t end = src_.find('\n', pos); if (end == std::string_view::npos) end = src_.size();
+            ++line_no_; statement(src_.substr(pos, end - pos));
+            pos = end + 1;
+        }
+        resolve();
+        if (!errors_.empty()) {
+            std::stable_sort(errors_.begin(), errors_.end(), [](const AssemblyDiagnostic& a, const AssemblyDiagnostic& b) {
+                return a.line != b.line ? a.line < b.line : a.column < b.column; });
+            throw AssemblyError(std::move(errors_));
+        }
+        for (const auto& s : symbols_) {
+            if (!s.second.code) continue;
+            std::string name(s.first); std::transform(name.begin(), name.end(), name.begin(), upper);
+            out_.labels[name] = static_cast<uint64_t>(s.second.value);
+        }
+        return std::move(out_);
+    }
+
+private:
+    int column(std::string_view token) const { return static_cast<int>(token.data() - line_begin_) + 1; }
+    bool error(int col, std::string message) { errors_.push_back({line_no_, col, std::move(message)}); return false; }
+    bool error(std::string_view at, std::string message) { return error(column(at), std::move(message)); }
+    static std::string quoted(std::string_view s) { return "'" + std::string(s) + "'"; }
+
+    static std::string_view take_word(std::string_view& s) {
+        size_t n = 0; while (n < s.size() && is_ident(s[n])) ++n;
+        std::string_view w = s.substr(0, n); s.remove_prefix(n); return w;
+    }
+
+    void statement(std::string_view line) {
+        line_begin_ = line.data();
+        for (size_t i = 0; i < line.size(); ++i) { // comment: ';' or '//'
+            if (line[i] == ';' || (line[i] == '/' && i + 1 < line.size() && line[i + 1] == '/')) { line = line.substr(0, i); break; }
+        }
+        std::string_view rest = trim(line);
+        if (rest.empty()) return;
+        std::string_view start = rest, word = take_word(rest);
+        if (word.empty()) { error(start, "Expected a label, instruction or directive"); return; }
+        rest = trim(rest);
+        if (!rest.empty() && rest.front() == ':') {
+            define_label(word);
+            rest = trim(rest.substr(1));
+            if (rest.empty()) return;
+            start = rest; word = take_word(rest);
+            if (word.empty()) { error(start, "Expected an instruction or directive"); return; }
+        }
+        if (word.front() == '.') directive(word, rest);
+        else instruction(word, rest, std::string_view(start.data(), static_cast<size_t>(line.data() + trim_end(line) - start.data())));
+    }
+    static size_t trim_end(std::string_view line) { size_t e = line.size(); while (e > 0 && is_space(line[e - 1])) --e; return e; }
+
+    void define_label(std::string_view name) {
+        if (is_digit(name.front())) { error(name, "Label " + quoted(name) + " starts with a digit"); return; }
+        if (gpr_of(name) != NO_REG) { error(name, "Register name " + quoted(name) + " used as a label"); return; }
+        const Symbol sym{in_data_ ? data_pointer_ : static_cast<int64_t>(out_.instructions.size()), !in_data_, line_no_};
+        auto inserted = symbols_.emplace(name, sym);
+        if (!inserted.second) error(name, "Duplicate label " + quoted(name) + " (first defined on line " + std::to_string(inserted.first->second.line) + ")");
+    }
+
+    // Splits at commas into fields_ (empty text: no operands).
+    bool split_operands(std::string_view text) {
+        fields_.clear();
+        text = trim(text);
+        if (text.empty()) return true;
+        for (;;) {
+            size_t comma = text.find(',');
+            std::string_view field = trim(text.substr(0, comma));
+            if (field.empty()) return error(comma == std::string_view::npos ? text.data() + text.size() - line_begin_ + 1 : column(text.substr(comma)), "Empty operand");
+            fields_.push_back(field);
+            if (comma == std::string_view::npos) return true;
+            text = text.substr(comma + 1);
+        }
+    }
+
+    bool number(std::string_view token, uint64_t& value) {
+        std::string_view digits = token; int base = 10;
+        if (digits.size() > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) { base = 16; digits.remove_prefix(2); }
+        else if (digits.size() > 2 && digits[0] == '0' && (digits[1] == 'b' || digits[1] == 'B')) { base = 2; digits.remove_prefix(2); }
+        auto r = std::from_chars(digits.data(), digits.data() + digits.size(), value, base);
+        if (r.ec == std::errc::result_out_of_range) return error(token, "Number out of range: " + std::string(token));
+        if (r.ec != std::errc() || r.ptr != digits.data() + digits.size()) return error(token, "Invalid number " + quoted(token));
+        return true;
+    }
+
+    // One factor of a sum: a number, a register or a label.
+    bool factor(std::string_view& s, std::string_view& token, bool& is_number, uint64_t& value, int8_t& reg) {
+        token = take_word(s);
+        if (token.empty()) return error(s.empty() ? static_cast<int>(s.data() - line_begin_) + 1 : column(s), s.empty() ? "Missing operand" : "Unexpected " + quoted(s.substr(0, 1)));
+        is_number = is_digit(token.front()); reg = NO_REG;
+        if (is_number) return number(token, value);
+        reg = gpr_of(token);
+        return true;
+    }
+
+    // Sum of terms: [+-] number | register | register*scale | scale*register | label.
+    bool sum(std::string_view s, Operand& op) {
+        bool first = true;
+        for (;;) {
+            s = trim(s);
+            bool negative = false;
+            if (!s.empty() && (s.front() == '+' || s.front() == '-')) { negative = s.front() == '-'; s = trim(s.substr(1)); }
+            else if (!first) return error(s, "Expected '+' or '-' before " + quoted(s.substr(0, 1)));
+            first = false;
+            std::string_view token; bool is_number = false; uint64_t value = 0; int8_t reg = NO_REG;
+            if (!factor(s, token, is_number, value, reg)) return false;
+            s = trim(s);
+            std::string_view scale_token; uint64_t scale = 1;
+            if (!s.empty() && s.front() == '*') {
+                s = trim(s.substr(1));
+                std::string_view other; bool other_number = false; uint64_t other_value = 0; int8_t other_reg = NO_REG;
+                if (!factor(s, other, other_number, other_value, other_reg)) return false;
+                if (is_number && other_reg != NO_REG) { scale_token = token; scale = value; token = other; reg = other_reg; }
+                else if (reg != NO_REG && other_number) { scale_token = other; scale = other_value; }
+                else return error(token, "Only register*scale can be multiplied");
+                is_number = false;
+            }
+            if (reg != NO_REG) {
+                if (negative) return error(token, "Registers cannot be subtracted");
+                uint8_t shift = 0;
+                if (!scale_token.empty()) {
+                    if (scale != 1 && scale != 2 && scale != 4 && scale != 8) return error(scale_token, "Scale must be 1, 2, 4 or 8");
+                    shift = scale == 8 ? 3 : scale == 4 ? 2 : scale == 2 ? 1 : 0;
+                }
+                if (scale_token.empty() && op.reg == NO_REG) op.reg = reg;
+                else if (op.index == NO_REG) op.index = reg, op.shift = shift;
+                else if (scale_token.empty() || op.shift != 0 || op.reg != NO_REG) return error(token, "Too many registers");
+                else { op.reg = op.index; op.index = reg; op.shift = shift; } // the first register was unscaled: it is the base
+            } else if (is_number) {
+                op.value = static_cast<int64_t>(negative ? 0 - value : value) + op.value;
+            } else {
+                if (negative) return error(token, "Labels cannot be subtracted");
+                if (!op.label.empty()) return error(token, "Only one label per operand");
+                op.label = token; op.label_column = column(token);
+            }
+            if (s.empty()) return true;
+        }
+    }
+
+    bool operand(std::string_view text, Operand& op) {
+        op = Operand(); op.column = column(text);
+        if (text.front() == '[') {
+            if (text.back() != ']') return error(text, "Missing ']'");
+            std::string_view inner = trim(text.substr(1, text.size() - 2));
+            if (inner.empty()) return error(text, "Empty memory operand");
+            op.type = Operand::Mem;
+            return sum(inner, op);
+        }
+        if (!sum(text, op)) return false;
+        if (op.reg == NO_REG && op.index == NO_REG) { op.type = Operand::Imm; return true; }
+        if (op.index != NO_REG || op.value != 0 || !op.label.empty() || text.size() != std::string_view(reg_name(op.reg)).size())
+            return error(text, "Register arithmetic needs a memory operand: [" + std::string(text) + "]");
+        op.type = Operand::Reg; return true;
+    }
+
+    bool expect_reg(const Operand& op, const char* what) {
+        if (op.type == Operand::Reg) return true;
+        if (op.type == Operand::Imm && op.value == 0 && !op.label.empty()) return error(op.column, "Unknown register " + quoted(op.label));
+        return error(op.column, std::string(what) + " must be a register");
+    }
+    bool expect_reg_or_imm(const Operand& op) {
+        return op.type != Operand::Mem || error(op.column, "Expected a register or an immediate (memory needs LOAD/STORE/LEA)");
+    }
+    bool expect_mem(const Operand& op) { return op.type == Operand::Mem || error(op.column, "Expected a memory operand [base+index*scale+disp]"); }
+
+    MicroOp& emit(Opcode op, int8_t dst, int8_t src1, int8_t src2, int64_t imm = 0, int64_t disp = 0) {
+        MicroOp u; u.op = op; u.dst = dst; u.src1 = src1; u.src2 = src2; u.imm = imm; u.disp = disp;
+        u.instr_index = static_cast<uint32_t>(out_.instructions.size());
+        if (op == Opcode::MUL) { u.fu = FUKind::MULT_DIV; u.latency = static_cast<uint8_t>(config_.mul_latency); }
+        else if (op == Opcode::DIV) { u.fu = FUKind::MULT_DIV; u.latency = static_cast<uint8_t>(config_.div_latency); }
+        else if (op == Opcode::LOAD || op == Opcode::STORE) { u.fu = FUKind::MEMORY; u.latency = 0; }
+        else if (is_branch_op(op)) { u.fu = FUKind::BRANCH; u.latency = static_cast<uint8_t>(config_.alu_latency); }
+        else { u.fu = FUKind::ALU; u.latency = static_cast<uint8_t>(config_.alu_latency); }
+        out_.micro_ops.push_back(u);
+        return out_.micro_ops.back();
+    }
+    void fixup(Fixup::Field field, size_t index, const Operand& op) {
+        if (!op.label.empty()) fixups_.push_back({field, static_cast<uint32_t>(index), op.label, line_no_, op.label_column});
+    }
+    // Register-or-immediate source: the register, or NO_REG with the immediate in imm.
+    int8_t source(const Operand& op, int64_t& imm) { if (op.type == Operand::Reg) return op.reg; imm = op.value; return NO_REG; }
+    size_t last_uop() const { return out_.micro_ops.size() - 1; }
+
+    // Address of a memory operand for LOAD/STORE: base (or none) and displacement; a scaled index is
+    // first folded into TMP.
+    int8_t address(const Operand& m) {
+        if (m.index == NO_REG) return m.reg;
+        emit(Opcode::LEA, REG_TMP, m.reg, m.index).shift = m.shift;
+        return REG_TMP;
+    }
+
+    void instruction(std::string_view word, std::string_view rest, std::string_view text) {
+        if (in_data_) { error(word, "Instruction in the .data section (missing .text?)"); return; }
+        const Mnemonic* m = find_mnemonic(word);
+        if (!m) { error(word, "Unknown instruction " + quoted(word)); return; }
+        if (!split_operands(rest)) return;
+        const size_t n = fields_.size();
+        Operand ops[3];
+        if (n > 3) { error(fields_[3], "Too many operands"); return; }
+        for (size_t i = 0; i < n; ++i) if (!operand(fields_[i], ops[i])) return;
+        auto count = [&](size_t lo, size_t hi) {
+            if (n >= lo && n <= hi) return true;
+            std::string need = lo == hi ? std::to_string(lo) : std::to_string(lo) + " or " + std::to_string(hi);
+            return error(word, std::string(m->name) + " requires " + need + (hi == 1 ? " operand" : " operands"));
+        };
+        // All checks first; micro-ops are emitted only for a valid instruction.
+        bool ok = true;
+        switch (m->kind) {
+        case Kind::Alu: ok = count(2, 3) && expect_reg(ops[0], "Destination") && expect_reg(ops[n - 2], "First source") && expect_reg_or_imm(ops[n - 1]); break;
+        case Kind::Cmp: ok = count(2, 2) && expect_reg(ops[0], "First operand") && expect_reg_or_imm(ops[1]); break;
+        case Kind::Mov: ok = count(2, 2) && expect_reg(ops[0], "Destination") && expect_reg_or_imm(ops[1]); break;
+        case Kind::Lea: case Kind::Load: ok = count(2, 2) && expect_reg(ops[0], "Destination") && expect_mem(ops[1]); break;
+        case Kind::Store: ok = count(2, 2) && expect_reg_or_imm(ops[0]) && expect_mem(ops[1]); break;
+        case Kind::Unary: case Kind::Push: case Kind::Pop: ok = count(1, 1) && expect_reg(ops[0], "Operand"); break;
+        case Kind::Jump:
+            ok = count(1, 1) && ((ops[0].type == Operand::Imm && !ops[0].label.empty() && ops[0].value == 0) || error(ops[0].column, "Expected a label"));
+            break;
+        case Kind::Ret: ok = count(0, 0); break;
+        }
+        if (!ok) return;
+
+        Instruction instr;
+        instr.address = out_.instructions.size(); instr.line = line_no_;
+        instr.first_uop = static_cast<uint32_t>(out_.micro_ops.size());
+        instr.text_offset = static_cast<uint32_t>(text.data() - src_.data()); instr.text_length = static_cast<uint32_t>(text.size());
+        int64_t imm = 0;
+        switch (m->kind) {
+        case Kind::Alu: { int8_t r = source(ops[n - 1], imm); emit(m->op, ops[0].reg, ops[n - 2].reg, r, imm); fixup(Fixup::Imm, last_uop(), ops[n - 1]); break; }
+        case Kind::Cmp: { int8_t r = source(ops[1], imm); emit(Opcode::CMP, REG_FLAGS, ops[0].reg, r, imm); fixup(Fixup::Imm, last_uop(), ops[1]); break; }
+        case Kind::Mov: { int8_t r = source(ops[1], imm); emit(Opcode::MOV, ops[0].reg, r, NO_REG, imm); fixup(Fixup::Imm, last_uop(), ops[1]); break; }
+        case Kind::Lea: { // LEA dst, [b+i*s+d]: one micro-op, base and index plus an ADD for d
+            const Operand& a = ops[1]; const int8_t dst = ops[0].reg;
+            if (a.index == NO_REG && a.reg == NO_REG) emit(Opcode::MOV, dst, NO_REG, NO_REG, a.value);
+            else if (a.index == NO_REG) emit(Opcode::LEA, dst, a.reg, NO_REG, a.value);
+            else if (a.reg == NO_REG) emit(Opcode::LEA, dst, NO_REG, a.index, a.value).shift = a.shift;
+            else {
+                emit(Opcode::LEA, dst, a.reg, a.index).shift = a.shift;
+                if (a.value != 0 || !a.label.empty()) emit(Opcode::ADD, dst, dst, NO_REG, a.value);
+            }
+            fixup(Fixup::Imm, last_uop(), a);
+            break;
+        }
+        case Kind::Load: { int8_t base = address(ops[1]); emit(Opcode::LOAD, ops[0].reg, base, NO_REG, 0, ops[1].value); fixup(Fixup::Disp, last_uop(), ops[1]); break; }
+        case Kind::Store: {
+            int8_t base = address(ops[1]), r = source(ops[0], imm);
+            emit(Opcode::STORE, NO_REG, base, r, imm, ops[1].value);
+            fixup(Fixup::Disp, last_uop(), ops[1]); fixup(Fixup::Imm, last_uop(), ops[0]);
+            break;
+        }
+        case Kind::Unary: emit(m->op, ops[0].reg, ops[0].reg, NO_REG); break;
+        case Kind::Push: // STORE src,[RSP-8] ; SUB RSP,RSP,8
+            emit(Opcode::STORE, NO_REG, REG_RSP, ops[0].reg, 0, -8);
+            emit(Opcode::SUB, REG_RSP, REG_RSP, NO_REG, 8);
+            break;
+        case Kind::Pop: // LOAD dst,[RSP+0] ; ADD RSP,RSP,8
+            emit(Opcode::LOAD, ops[0].reg, REG_RSP, NO_REG);
+            if (ops[0].reg != REG_RSP) emit(Opcode::ADD, REG_RSP, REG_RSP, NO_REG, 8);
+            break;
+        case Kind::Jump: // CALL: STORE ret,[RSP-8] ; SUB RSP,RSP,8 ; JMP label
+            if (m->branch_class == BranchClass::Call) {
+                emit(Opcode::STORE, NO_REG, REG_RSP, NO_REG, static_cast<int64_t>(instr.address + 1), -8);
+                emit(Opcode::SUB, REG_RSP, REG_RSP, NO_REG, 8);
+            }
+            emit(m->op, NO_REG, m->branch_class == BranchClass::Conditional ? REG_FLAGS : NO_REG, NO_REG).branch_class = m->branch_class;
+            fixup(Fixup::Target, last_uop(), ops[0]);
+            break;
+        case Kind::Ret: // LOAD TMP,[RSP+0] ; ADD RSP,RSP,8 ; JMP* TMP
+            emit(Opcode::LOAD, REG_TMP, REG_RSP, NO_REG);
+            emit(Opcode::ADD, REG_RSP, REG_RSP, NO_REG, 8);
+            emit(Opcode::JMP_IND, NO_REG, REG_TMP, NO_REG).branch_class = BranchClass::Return;
+            break;
+        }
+        instr.uop_count = static_cast<uint32_t>(out_.micro_ops.size()) - instr.first_uop;
+        for (uint32_t i = instr.first_uop; i + 1 < out_.micro_ops.size(); ++i) out_.micro_ops[i].last = false;
+        out_.instructions.push_back(instr);
+    }
+
+    // A constant operand of a directive (no registers or labels).
+    bool constant(std::string_view field, int64_t& value) {
+        Operand op;
+        if (!operand(field, op)) return false;
+        if (!op.constant()) return error(field, "Expected a number");
+        value = op.value; return true;
+    }
+
+    void directive(std::string_view word, std::string_view rest) {
+        if (!split_operands(rest)) return;
+        const size_t n = fields_.size();
+        if (iequals(word, ".text") || iequals(word, ".code")) {
+            if (n != 0) { error(fields_[0], "Unexpected operand"); return; }
+            in_data_ = false;
+        } else if (iequals(word, ".data")) {
+            if (n > 1) { error(fields_[1], "Unexpected operand"); return; }
+            int64_t address = data_pointer_;
+            if (n == 1 && !constant(fields_[0], address)) return;
+            in_data_ = true; data_pointer_ = address;
+        } else if (iequals(word, ".word") || iequals(word, ".quad") || iequals(word, ".dq")) {
+            if (!in_data_) { error(word, quoted(word) + " outside .data"); return; }
+            if (n == 0) { error(word, quoted(word) + " needs at least one value"); return; }
+            for (std::string_view field : fields_) {
+                Operand op;
+                if (!operand(field, op)) continue;
+                if (op.type != Operand::Imm) { error(field, "Expected a number or a label"); continue; }
+                fixup(Fixup::Data, out_.data.size(), op);
+                out_.data.push_back({data_pointer_, op.value});
+                data_pointer_ += 8;
+            }
+        } else if (iequals(word, ".space") || iequals(word, ".zero") || iequals(word, ".align")) {
+            if (!in_data_) { error(word, quoted(word) + " outside .data"); return; }
+            if (n != 1) { error(word, quoted(word) + " requires 1 operand"); return; }
+            int64_t v = 0;
+            if (!constant(fields_[0], v)) return;
+            if (iequals(word, ".align")) {
+                if (v <= 0 || (v & (v - 1)) != 0) { error(fields_[0], "Alignment must be a power of two"); return; }
+                data_pointer_ = (data_pointer_ + v - 1) & ~(v - 1);
+            } else {
+                if (v < 0) { error(fields_[0], "Size cannot be negative"); return; }
+                data_pointer_ += v;
+            }
+        } else {
+            error(word, "Unknown directive " + quoted(word));
+        }
+    }
+
+    void resolve() {
+        for (const Fixup& f : fixups_) {
+            auto it = symbols_.find(f.label);
+            if (it == symbols_.end()) { errors_.push_back({f.line, f.column, "Label not found: " + std::string(f.label)}); continue; }
+            const Symbol& s = it->second;
+            switch (f.field) {
+            case Fixup::Target: {
+                if (!s.code) { errors_.push_back({f.line, f.column, quoted(f.label) + " is a data label, not a branch target"}); break; }
+                const uint64_t address = static_cast<uint64_t>(s.value);
+                out_.micro_ops[f.index].target = address < out_.instructions.size() ? out_.instructions[address].first_uop
+                                                                                    : static_cast<uint32_t>(out_.micro_ops.size());
+                break;
+            }
+            case Fixup::Imm: out_.micro_ops[f.index].imm += s.value; break;
+            case Fixup::Disp: out_.micro_ops[f.index].disp += s.value; break;
+            case Fixup::Data: out_.data[f.index].second += s.value; break;
+            }
+        }
+    }
+
+    std::string_view src_;
+    const MachineConfig& config_;
+    AssembledProgram out_;
+    std::unordered_map<std::string_view, Symbol, NoCaseHash, NoCaseEqual> symbols_;
+    std::vector<Fixup> fixups_;
+    std::vector<AssemblyDiagnostic> errors_;
+    std::vector<std::string_view> fields_; // operands of the current line, reused
+    const char* line_begin_ = nullptr;
+    int line_no_ = 0;
+    bool in_data_ = false;
+    int64_t data_pointer_ = DATA_BASE;
+};
+
+std::string summary(const std::vector<AssemblyDiagnostic>& diagnostics) {
+    constexpr size_t shown = 10;
+    std::string s;
+    for (size_t i = 0; i < diagnostics.size() && i < shown; ++i) { if (i) s += '\n'; s += diagnostics[i].text(); }
+    if (diagnostics.size() > shown) s += "\n(" + std::to_string(diagnostics.size() - shown) + " more errors)";
+    return s;
+}
+
+} // namespace
+
+AssemblyError::AssemblyError(std::vector<AssemblyDiagnostic> diagnostics)
+    : std::runtime_error(summary(diagnostics)), diagnostics_(std::move(diagnostics)) {}
+
+AssembledProgram assemble(std::string_view source, const MachineConfig& config) {
+    return Assembler(source, config).run();
+}
@@ -0,0 +1,59 @@
+#ifndef ASSEMBLER_H
+#define ASSEMBLER_H
+
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "pipelinesimulator.h"
+
+// Single-pass assembler: a string_view tokenizer over the source, no per-line or per-operand strings.
+// Forward references (branch targets, labels used as immediates, displacements or data words) are
+// recorded as fix-ups and patched once every label is known, so the cost is linear in the source size.
+//
+// Syntax (mnemonics, registers, directives and labels are case-insensitive):
+//   label:                    on its own line or in front of an instruction
+//   ADD RAX, RBX, RCX         operands: registers, numbers (decimal, 0x hex, 0b binary), labels and
+//   MOV RSI, table+16         sums of them ("label+8", "-4")
+//   LOAD RAX, [RBX+RCX*8+16]  memory: [base + index*scale + disp], each part optional, scale 1/2/4/8
+//   ; comment, // comment
+// Data: ".data [ADDRESS]" starts (or continues) the data section, ".text" returns to code. In it, labels
+// name data addresses and ".word"/".quad"/".dq" V, ... store 64-bit words (8 address units apart, like
+// --data), ".space"/".zero" N skips N units and ".align" N aligns. The data section starts at
+// DATA_BASE unless an address is given.
+//
+// A scaled index costs a LEA micro-op into TMP in front of the load or store (the LSB has one address
+// operand); LEA itself takes base + index*scale in one micro-op, plus an ADD for a displacement.
+
+constexpr int64_t DATA_BASE = 0x100000;
+
+struct AssemblyDiagnostic {
+    int line = 0, column = 0; // 1-based; column counts bytes
+    std::string message;
+    std::string text() const { return "line " + std::to_string(line) + ", col " + std::to_string(column) + ": " + message; }
+};
+
+// Thrown with every problem the source has, in source order (undefined labels last). what() lists the
+// first few.
+class AssemblyError : public std::runtime_error {
+public:
+    explicit AssemblyError(std::vector<AssemblyDiagnostic> diagnostics);
+    const std::vector<AssemblyDiagnostic>& diagnostics() const { return diagnostics_; }
+private:
+    std::vector<AssemblyDiagnostic> diagnostics_;
+};
+
+struct AssembledProgram {
+    std::vector<Instruction> instructions; // Instruction::text_* index the assembled source
+    std::vector<MicroOp> micro_ops;
+    std::map<std::string, uint64_t> labels;        // code labels, upper-case -> instruction address
+    std::vector<std::pair<int64_t, int64_t>> data; // initial memory from .word: address, value
+};
+
+// Latencies come from config. Throws AssemblyError.
+AssembledProgram assemble(std::string_view source, const MachineConfig& config);
+
+#endif // ASSEMBLER_H
@@ -0,0 +1,50 @@
+// Microbenchmark: assembler throughput on generated programs of doubling size, from ~80 KB to tens of
+// MB. Parse time per byte should stay flat (single pass, linear fix-ups). The code mixes register
+// ALU ops, immediates, scaled-index loads and stores, forward branches, calls and a .data table.
+#include "pipelinesimulator.h"
+#include "assembler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+static std::string make_program(int blocks, bool with_errors) {
+    std::string src; src.reserve(static_cast<size_t>(blocks) * 420);
+    src += "        MOV RSI, table\n        JMP block0\nhelper:\n        ADD R15, R15, 1\n        RET\n";
+    for (int b = 0; b < blocks; ++b) {
+        const std::string n = std::to_string(b), next = std::to_string(b + 1);
+        src += "block" + n + ":\n";
+        src += "        ADD RAX, RBX, RCX\n        SUB RDX, RDX, 17\n        LOAD R8, [RSI+RCX*8+16] ; scaled index\n";
+        src += "        STORE R8, [RDI+24]\n        XOR R9, R9, R10\n        CMP RAX, 0x64\n        JNZ block" + next + "\n";
+        src += "        INC R11\n        MUL R12, R12, R13\n        AND R14, R14, 255\n        LEA RCX, [RBX+RDX*4+8]\n";
+        src += with_errors && b % 64 == 0 ? "        ADD RAX, RQQ, 1\n" : "        CALL helper\n";
+        src += "        OR R15, R15, RAX    // tail\n";
+    }
+    src += "block" + std::to_string(blocks) + ":\n        .data\ntable:  .word 1, 2, 3, 4, 5, 6, 7, 8, block0, helper\n";
+    return src;
+}
+
+int main(int argc, char* argv[]) {
+    const int max_blocks = argc > 1 ? std::stoi(argv[1]) : 131072;
+    std::printf("%-10s %10s %10s %10s %10s %12s %10s\n", "blocks", "lines", "MB", "ms", "MB/s", "ns/line", "uops");
+    for (int blocks = 256; blocks <= max_blocks; blocks *= 2) {
+        const std::string program = make_program(blocks, false);
+        const size_t lines = static_cast<size_t>(std::count(program.begin(), program.end(), '\n'));
+        double best = 1e300; PipelineSimulator sim;
+        for (int rep = 0; rep < 3; ++rep) {
+            auto t0 = std::chrono::steady_clock::now();
+            sim.parse_and_load_program(program);
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+        }
+        std::printf("%-10d %10zu %10.2f %10.2f %10.1f %12.1f %10zu\n", blocks, lines, program.size() / 1e6, best,
+                    program.size() / 1e3 / best, best * 1e6 / lines, sim.micro_ops.size());
+    }
+    // Every error is collected: one bad line per 64 blocks.
+    const std::string bad = make_program(max_blocks, true);
+    PipelineSimulator sim; size_t errors = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    try { sim.parse_and_load_program(bad); } catch (const AssemblyError& e) { errors = e.diagnostics().size(); }
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("with errors: %zu diagnostics in %.2f ms (%.1f MB/s)\n", errors, ms, bad.size() / 1e3 / ms);
+    return 0;
+}
@@ -0,0 +1,50 @@
+// Microbenchmark: host time per simulated cycle with growing ROB/RS/LSB sizes, for the generic
+// core and (where the shape is compiled in) the specialized one.
+// The kernel keeps many RS entries waiting on long-latency DIV/MUL results, which is
+// where a broadcast scan over every RS entry used to dominate.
+#include "pipelinesimulator.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+static std::string make_kernel(int iterations, int consumers) {
+    std::string src = "MOV RCX, " + std::to_string(iterations) + "\nMOV RAX, 1000003\nloop:\n";
+    src += "DIV RAX, RAX, 3\nMUL R8, R8, 5\n";
+    static const char* regs[] = {"RBX", "RDX", "RSI", "RDI", "R9", "R10", "R11", "R12"};
+    for (int i = 0; i < consumers; ++i) {
+        src += std::string("ADD ") + regs[i % 8] + ", RAX, " + std::to_string(i) + "\n";
+        src += std::string("XOR ") + regs[(i + 3) % 8] + ", R8, " + regs[i % 8] + "\n";
+    }
+    src += "STORE RBX, [RSI+0]\nLOAD R13, [RDI+8]\nADD RAX, RAX, 1000003\nDEC RCX\nCMP RCX, 0\nJNZ loop\n";
+    return src;
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 2000;
+    const std::string program = make_kernel(iterations, 24);
+    struct Shape { int rob, alu, md, lsb; } shapes[] = {
+        {32, 6, 3, 6}, {128, 32, 16, 32}, {512, 128, 64, 128}, {2048, 512, 256, 512}};
+
+    std::printf("%-22s %12s %12s %10s %14s %14s\n", "ROB/ALU/MD/LSB", "cycles", "committed", "IPC", "ns/cycle", "specialized");
+    for (const auto& s : shapes) {
+        MachineConfig cfg;
+        cfg.rob_size = s.rob; cfg.alu_rs_size = s.alu; cfg.mul_div_rs_size = s.md; cfg.lsb_size = s.lsb;
+        double ns_per_cycle[2] = {0.0, 0.0}; bool specialized = false;
+        PipelineSimulator sim(cfg);
+        for (int pass = 0; pass < 2; ++pass) {
+            sim.setSpecializedCoreEnabled(pass == 1);
+            if (pass == 1 && !sim.isSpecializedCoreActive()) break;
+            specialized = pass == 1;
+            sim.parse_and_load_program(program);
+            auto t0 = std::chrono::steady_clock::now();
+            while (!sim.is_finished()) sim.step();
+            ns_per_cycle[pass] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / sim.cycle_count;
+        }
+        char shape[32]; std::snprintf(shape, sizeof(shape), "%d/%d/%d/%d", s.rob, s.alu, s.md, s.lsb);
+        char spec[32] = "-"; if (specialized) std::snprintf(spec, sizeof(spec), "%.1f", ns_per_cycle[1]);
+        std::printf("%-22s %12llu %12llu %10.3f %14.1f %14s\n", shape, (unsigned long long)sim.cycle_count,
+                    (unsigned long long)sim.committed_ins_count,
+                    sim.cycle_count ? (double)sim.committed_ins_count / sim.cycle_count : 0.0, ns_per_cycle[0], spec);
+    }
+    return 0;
+}
@@ -0,0 +1,258 @@
+#include "branchpredictor.h"
+#include "checkpoint.h"
+#include <algorithm>
+#include <array>
+
+namespace {
+
+// 2-bit saturating counter helpers: 0,1 = not taken; 2,3 = taken.
+inline void bump(uint8_t& c, bool taken) { if (taken) { if (c < 3) c++; } else if (c > 0) c--; }
+
+// Folds the low `length` bits of the history into `bits` bits by XOR-ing bits-wide chunks.
+inline uint64_t fold(uint64_t h, int length, int bits) {
+    if (length < 64) h &= (uint64_t(1) << length) - 1;
+    uint64_t out = 0, mask = (uint64_t(1) << bits) - 1;
+    for (; h; h >>= bits) out ^= h & mask;
+    return out;
+}
+
+// Backward taken, forward not taken; the baseline predictor of the original pipeline.
+class StaticPredictor : public DirectionPredictor {
+public:
+    const char* name() const override { return "static"; }
+    bool predict(uint64_t pc, uint64_t target, uint64_t) const override { return target < pc; }
+    void update(uint64_t, uint64_t, uint64_t, bool) override {}
+    std::unique_ptr<DirectionPredictor> clone() const override { return std::make_unique<StaticPredictor>(*this); }
+};
+
+class BimodalPredictor : public DirectionPredictor {
+public:
+    explicit BimodalPredictor(int table_bits) : table(size_t(1) << table_bits, 1), mask((uint64_t(1) << table_bits) - 1) {}
+    const char* name() const override { return "bimodal"; }
+    bool predict(uint64_t pc, uint64_t, uint64_t) const override { return table[pc & mask] >= 2; }
+    void update(uint64_t pc, uint64_t, uint64_t, bool taken) override { bump(table[pc & mask], taken); }
+    std::unique_ptr<DirectionPredictor> clone() const override { return std::make_unique<BimodalPredictor>(*this); }
+    void checkpoint(CheckpointIO& io) override { DirectionPredictor::checkpoint(io); io.vec(table, true); }
+private:
+    std::vector<uint8_t> table; uint64_t mask;
+};
+
+class GsharePredictor : public DirectionPredictor {
+public:
+    GsharePredictor(int table_bits, int history_bits)
+        : table(size_t(1) << table_bits, 1), bits(table_bits), history_bits(history_bits), mask((uint64_t(1) << table_bits) - 1) {}
+    const char* name() const override { return "gshare"; }
+    bool predict(uint64_t pc, uint64_t, uint64_t ghist) const override { return table[index(pc, ghist)] >= 2; }
+    void update(uint64_t pc, uint64_t, uint64_t ghist, bool taken) override { bump(table[index(pc, ghist)], taken); }
+    std::unique_ptr<DirectionPredictor> clone() const override { return std::make_unique<GsharePredictor>(*this); }
+    void checkpoint(CheckpointIO& io) override { DirectionPredictor::checkpoint(io); io.vec(table, true); }
+private:
+    size_t index(uint64_t pc, uint64_t ghist) const { return (pc ^ fold(ghist, history_bits, bits)) & mask; }
+    std::vector<uint8_t> table; int bits, history_bits; uint64_t mask;
+};
+
+// TAGE-like: a bimodal base plus tagged tables indexed with geometrically longer history. The longest
+// matching table provides the prediction; a newly allocated (weak, not yet useful) entry defers to the
+// alternate prediction. Mispredicts allocate one entry in a longer table.
+class TagePredictor : public DirectionPredictor {
+public:
+    static constexpr int TABLES = 4, TAG_BITS = 9;
+    static constexpr std::array<int, TABLES> HISTORY = {4, 10, 24, 56};
+
+    explicit TagePredictor(int table_bits)
+        : base(size_t(1) << table_bits, 1), base_mask((uint64_t(1) << table_bits) - 1), tagged_bits(std::max(4, table_bits - 2)) {
+        for (auto& t : tables) t.assign(size_t(1) << tagged_bits, Entry());
+    }
+    const char* name() const override { return "tage"; }
+    bool predict(uint64_t pc, uint64_t, uint64_t ghist) const override { return lookup(pc, ghist).prediction; }
+    void update(uint64_t pc, uint64_t, uint64_t ghist, bool taken) override {
+        Lookup l = lookup(pc, ghist);
+        provider_count[l.provider + 1]++;
+        if (l.provider < 0) bump(base[pc & base_mask], taken);
+        else {
+            Entry& e = tables[l.provider][l.index[l.provider]];
+            bool provider_pred = e.ctr >= 0;
+            if (provider_pred != l.alt_prediction) { if (provider_pred == taken) { if (e.useful < 3) e.useful++; } else if (e.useful > 0) e.useful--; }
+            if (taken) { if (e.ctr < 3) e.ctr++; } else if (e.ctr > -4) e.ctr--;
+            if (l.alt < 0 && e.useful == 0) bump(base[pc & base_mask], taken);
+        }
+        if (l.prediction != taken && l.provider < TABLES - 1) {
+            bool allocated = false;
+            for (int t = l.provider + 1; t < TABLES && !allocated; ++t) {
+                Entry& e = tables[t][l.index[t]];
+                if (e.useful == 0) { e.tag = l.tag[t]; e.ctr = taken ? 0 : -1; allocated = true; allocations++; }
+            }
+            if (!allocated) for (int t = l.provider + 1; t < TABLES; ++t) { Entry& e = tables[t][l.index[t]]; if (e.useful > 0) e.useful--; }
+        }
+        // Age the useful bits periodically; otherwise stale entries lock up the tables.
+        if (++ticks % (1u << 18) == 0) for (auto& t : tables) for (auto& e : t) e.useful >>= 1;
+    }
+    std::unique_ptr<DirectionPredictor> clone() const override { return std::make_unique<TagePredictor>(*this); }
+    void checkpoint(CheckpointIO& io) override {
+        DirectionPredictor::checkpoint(io);
+        io.vec(base, true); for (auto& t : tables) io.vec(t, true);
+        io.pod(provider_count); io.pod(allocations); io.pod(ticks);
+    }
+    std::string detail() const override {
+        std::string out = "base=" + std::to_string(provider_count[0]);
+        for (int t = 0; t < TABLES; ++t) out += " t" + std::to_string(t + 1) + "=" + std::to_string(provider_count[t + 1]);
+        return out + " allocations=" + std::to_string(allocations);
+    }
+private:
+    struct Entry { uint16_t tag = 0; int8_t ctr = 0; uint8_t useful = 0; };
+    struct Lookup {
+        std::array<size_t, TABLES> index{}; std::array<uint16_t, TABLES> tag{};
+        int provider = -1, alt = -1; bool prediction = false, alt_prediction = false;
+    };
+    Lookup lookup(uint64_t pc, uint64_t ghist) const {
+        Lookup l;
+        const uint64_t idx_mask = (uint64_t(1) << tagged_bits) - 1, tag_mask = (uint64_t(1) << TAG_BITS) - 1;
+        for (int t = 0; t < TABLES; ++t) {
+            l.index[t] = (pc ^ (pc >> tagged_bits) ^ fold(ghist, HISTORY[t], tagged_bits)) & idx_mask;
+            l.tag[t] = static_cast<uint16_t>((pc ^ fold(ghist, HISTORY[t], TAG_BITS) ^ (fold(ghist, HISTORY[t], TAG_BITS - 1) << 1)) & tag_mask);
+        }
+        for (int t = TABLES - 1; t >= 0; --t) {
+            if (tables[t][l.index[t]].tag != l.tag[t]) continue;
+            if (l.provider < 0) l.provider = t; else { l.alt = t; break; }
+        }
+        bool base_pred = base[pc & base_mask] >= 2;
+        l.alt_prediction = l.alt >= 0 ? tables[l.alt][l.index[l.alt]].ctr >= 0 : base_pred;
+        if (l.provider < 0) { l.prediction = base_pred; return l; }
+        const Entry& e = tables[l.provider][l.index[l.provider]];
+        bool weak = e.ctr == 0 || e.ctr == -1;
+        l.prediction = (weak && e.useful == 0) ? l.alt_prediction : e.ctr >= 0;
+        return l;
+    }
+    std::vector<uint8_t> base; uint64_t base_mask; int tagged_bits;
+    std::array<std::vector<Entry>, TABLES> tables;
+    std::array<uint64_t, TABLES + 1> provider_count{};
+    uint64_t allocations = 0; uint32_t ticks = 0;
+};
+
+} // namespace
+
+void DirectionPredictor::checkpoint(CheckpointIO& io) { io.pod(counters); }
+
+std::unique_ptr<DirectionPredictor> make_direction_predictor(const MachineConfig& config) {
+    switch (static_cast<PredictorKind>(config.predictor)) {
+    case PredictorKind::Static: return std::make_unique<StaticPredictor>();
+    case PredictorKind::Bimodal: return std::make_unique<BimodalPredictor>(config.bp_table_bits);
+    case PredictorKind::Gshare: return std::make_unique<GsharePredictor>(config.bp_table_bits, config.bp_history_bits);
+    case PredictorKind::Tage: return std::make_unique<TagePredictor>(config.bp_table_bits);
+    }
+    return std::make_unique<StaticPredictor>();
+}
+
+BranchTargetBuffer::BranchTargetBuffer(int entries) : entries_(entries) {}
+
+bool BranchTargetBuffer::lookup(uint64_t pc, uint64_t& target) const {
+    if (entries_.empty()) return false;
+    const Entry& e = entries_[pc & (entries_.size() - 1)];
+    if (!e.valid || e.tag != pc) return false;
+    target = e.target; return true;
+}
+
+void BranchTargetBuffer::insert(uint64_t pc, uint64_t target) {
+    if (entries_.empty()) return;
+    entries_[pc & (entries_.size() - 1)] = {true, pc, target};
+}
+
+void BranchTargetBuffer::checkpoint(CheckpointIO& io) { io.vec(entries_, true); io.pod(counters); }
+
+ReturnAddressStack::ReturnAddressStack(int entries) : stack_(entries, 0) {}
+
+void ReturnAddressStack::push(uint64_t return_pc) {
+    if (stack_.empty()) return;
+    top_ = (top_ + 1) % stack_.size(); stack_[top_] = return_pc;
+    if (depth_ < stack_.size()) depth_++; else overflows++;
+}
+
+bool ReturnAddressStack::pop(uint64_t& return_pc) {
+    if (depth_ == 0) { underflows++; return false; }
+    return_pc = stack_[top_];
+    top_ = (top_ + static_cast<uint32_t>(stack_.size()) - 1) % stack_.size(); depth_--;
+    return true;
+}
+
+void ReturnAddressStack::restore(uint32_t top, uint32_t depth, uint64_t top_value) {
+    if (stack_.empty()) return;
+    top_ = top; depth_ = depth; stack_[top_] = top_value;
+}
+
+void ReturnAddressStack::checkpoint(CheckpointIO& io) {
+    io.vec(stack_, true); io.pod(top_); io.pod(depth_); io.pod(counters); io.pod(overflows); io.pod(underflows);
+    if (io.loading() && !holds(top_, depth_)) throw std::runtime_error("Checkpoint is corrupt");
+}
+
+BranchUnit::BranchUnit(const MachineConfig& config)
+    : dir_(make_direction_predictor(config)), btb_(config.btb_entries), ras_(config.ras_entries) {}
+
+BranchUnit::BranchUnit(const BranchUnit& o)
+    : dir_(o.dir_->clone()), btb_(o.btb_), ras_(o.ras_), overall_(o.overall_), ghist_(o.ghist_) {}
+
+BranchUnit& BranchUnit::operator=(const BranchUnit& o) {
+    if (this != &o) { dir_ = o.dir_->clone(); btb_ = o.btb_; ras_ = o.ras_; overall_ = o.overall_; ghist_ = o.ghist_; }
+    return *this;
+}
+
+uint64_t BranchUnit::predict(BranchClass cls, uint64_t pc, uint64_t target, BranchCheckpoint& cp) {
+    cp = {};
+    cp.ghist = ghist_; cp.ras_top = ras_.top(); cp.ras_depth = ras_.depth(); cp.ras_top_value = ras_.top_value();
+    cp.btb_hit = btb_.lookup(pc, cp.btb_target);
+    cp.predicted_taken = cls == BranchClass::Conditional ? dir_->predict(pc, target, ghist_) : true;
+
+    uint64_t next = pc + 1;
+    if (cls == BranchClass::Return) cp.ras_used = ras_.pop(next);
+    if (!cp.ras_used && cp.predicted_taken) {
+        // Without a BTB a direct target is known from decode; a return's target only ever comes from the BTB.
+        if (cp.btb_hit) next = cp.btb_target;
+        else if (!btb_.enabled() && cls != BranchClass::Return) next = target;
+        else next = pc + 1;
+    }
+    if (cls == BranchClass::Call) ras_.push(pc + 1);
+    if (cls == BranchClass::Conditional) ghist_ = (ghist_ << 1) | (cp.predicted_taken ? 1 : 0);
+    return next;
+}
+
+void BranchUnit::recover(BranchClass cls, uint64_t pc, const BranchCheckpoint& cp, bool taken) {
+    ghist_ = cp.ghist;
+    if (cls == BranchClass::Conditional) ghist_ = (ghist_ << 1) | (taken ? 1 : 0);
+    ras_.restore(cp.ras_top, cp.ras_depth, cp.ras_top_value);
+    uint64_t ignored;
+    if (cls == BranchClass::Return && cp.ras_used) ras_.pop(ignored);
+    if (cls == BranchClass::Call) ras_.push(pc + 1);
+}
+
+void BranchUnit::rewind(const BranchCheckpoint& cp) {
+    ghist_ = cp.ghist;
+    ras_.restore(cp.ras_top, cp.ras_depth, cp.ras_top_value);
+}
+
+void BranchUnit::train(BranchClass cls, uint64_t pc, uint64_t target, const BranchCheckpoint& cp, bool taken,
+                       uint64_t actual_next, uint64_t predicted_next) {
+    overall_.lookups++; if (actual_next == predicted_next) overall_.correct++;
+    if (cls == BranchClass::Conditional) {
+        dir_->counters.lookups++; if (cp.predicted_taken == taken) dir_->counters.correct++;
+        dir_->update(pc, target, cp.ghist, taken);
+    }
+    if (cp.ras_used) { ras_.counters.lookups++; if (actual_next == predicted_next) ras_.counters.correct++; }
+    if (taken && btb_.enabled()) {
+        if (!cp.ras_used) { btb_.counters.lookups++; if (cp.btb_hit && cp.btb_target == actual_next) btb_.counters.correct++; }
+        btb_.insert(pc, actual_next);
+    }
+}
+
+void BranchUnit::warm(BranchClass cls, uint64_t pc, uint64_t target, bool taken, uint64_t actual_next) {
+    const PredictorCounters overall = overall_, dir = dir_->counters, btb = btb_.counters, ras = ras_.counters;
+    const uint64_t overflows = ras_.overflows, underflows = ras_.underflows;
+    BranchCheckpoint cp;
+    const uint64_t predicted = predict(cls, pc, target, cp);
+    if (predicted != actual_next) recover(cls, pc, cp, taken);
+    train(cls, pc, target, cp, taken, actual_next, predicted);
+    overall_ = overall; dir_->counters = dir; btb_.counters = btb; ras_.counters = ras;
+    ras_.overflows = overflows; ras_.underflows = underflows;
+}
+
+void BranchUnit::checkpoint(CheckpointIO& io) {
+    dir_->checkpoint(io); btb_.checkpoint(io); ras_.checkpoint(io); io.pod(overall_); io.pod(ghist_);
+}
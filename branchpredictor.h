@@ -0,0 +1,120 @@
+#ifndef BRANCHPREDICTOR_H
+#define BRANCHPREDICTOR_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "machineconfig.h"
+
+class CheckpointIO;
+
+// Branch prediction for the fetch/dispatch stage. PCs are micro-op indices; the branch unit combines a
+// pluggable direction predictor with a BTB for taken targets and a return-address stack for RET.
+
+// Accuracy counters every predictor component keeps. Updated when a branch resolves (non-speculatively).
+struct PredictorCounters {
+    uint64_t lookups = 0, correct = 0;
+    uint64_t mispredicts() const { return lookups - correct; }
+    double accuracy() const { return lookups ? (double)correct / lookups : 0.0; }
+};
+
+// Direction predictor interface. ghist is the global history (youngest outcome in bit 0) as seen by
+// this branch at prediction time; the branch unit keeps it and hands the same value back on update.
+class DirectionPredictor {
+public:
+    virtual ~DirectionPredictor() = default;
+    virtual const char* name() const = 0;
+    virtual bool predict(uint64_t pc, uint64_t target, uint64_t ghist) const = 0;
+    virtual void update(uint64_t pc, uint64_t target, uint64_t ghist, bool taken) = 0;
+    virtual std::unique_ptr<DirectionPredictor> clone() const = 0;
+    // Extra per-component counters ("name=value ..."), empty if the predictor has none.
+    virtual std::string detail() const { return {}; }
+    // Saves or restores the tables and counters (see checkpoint.h); overrides call the base version first.
+    virtual void checkpoint(CheckpointIO& io);
+    PredictorCounters counters;
+};
+
+enum class PredictorKind : int { Static, Bimodal, Gshare, Tage };
+std::unique_ptr<DirectionPredictor> make_direction_predictor(const MachineConfig& config);
+
+// Direct-mapped, tagged branch target buffer. Only taken branches are inserted.
+class BranchTargetBuffer {
+public:
+    explicit BranchTargetBuffer(int entries = 0);
+    bool enabled() const { return !entries_.empty(); }
+    bool lookup(uint64_t pc, uint64_t& target) const;
+    void insert(uint64_t pc, uint64_t target);
+    void checkpoint(CheckpointIO& io);
+    PredictorCounters counters; // lookups/correct = hits with the right target
+private:
+    struct Entry { bool valid = false; uint64_t tag = 0, target = 0; };
+    std::vector<Entry> entries_;
+};
+
+// Circular return-address stack. Overflow overwrites the oldest entry; recovery restores the top
+// pointer and the top value saved in the branch's checkpoint.
+class ReturnAddressStack {
+public:
+    explicit ReturnAddressStack(int entries = 0);
+    bool enabled() const { return !stack_.empty(); }
+    void push(uint64_t return_pc);
+    bool pop(uint64_t& return_pc);
+    uint32_t top() const { return top_; }
+    uint32_t depth() const { return depth_; }
+    uint64_t top_value() const { return stack_.empty() ? 0 : stack_[top_]; }
+    void restore(uint32_t top, uint32_t depth, uint64_t top_value);
+    // Whether top/depth are a state this stack can be in (checks restored checkpoints).
+    bool holds(uint32_t top, uint32_t depth) const { return stack_.empty() || (top < stack_.size() && depth <= stack_.size()); }
+    void checkpoint(CheckpointIO& io);
+    PredictorCounters counters;
+    uint64_t overflows = 0, underflows = 0;
+private:
+    std::vector<uint64_t> stack_;
+    uint32_t top_ = 0, depth_ = 0;
+};
+
+// Everything needed to undo a branch's speculative predictor updates and to train it at resolution.
+struct BranchCheckpoint {
+    uint64_t ghist = 0;
+    uint32_t ras_top = 0, ras_depth = 0; uint64_t ras_top_value = 0;
+    uint64_t btb_target = 0;
+    bool predicted_taken = false, btb_hit = false, ras_used = false;
+};
+
+enum class BranchClass : uint8_t { Conditional, Direct, Call, Return };
+
+class BranchUnit {
+public:
+    explicit BranchUnit(const MachineConfig& config = MachineConfig());
+    BranchUnit(const BranchUnit& o);
+    BranchUnit& operator=(const BranchUnit& o);
+
+    // Predicts the next fetch PC after the branch at pc and speculatively updates history and RAS.
+    uint64_t predict(BranchClass cls, uint64_t pc, uint64_t target, BranchCheckpoint& cp);
+    // Mispredict recovery: rewinds history/RAS to the branch's checkpoint and re-applies its real outcome.
+    void recover(BranchClass cls, uint64_t pc, const BranchCheckpoint& cp, bool taken);
+    // Squash of a branch that was not the cause (e.g. a load replay): back to the state before its prediction.
+    void rewind(const BranchCheckpoint& cp);
+    // Resolution-time training and accuracy accounting (call once per retired branch, in order).
+    void train(BranchClass cls, uint64_t pc, uint64_t target, const BranchCheckpoint& cp, bool taken, uint64_t actual_next, uint64_t predicted_next);
+    // Functional warming (fast-forward): predict, recover if wrong and train, as for a branch retiring in
+    // order, leaving the accuracy counters untouched.
+    void warm(BranchClass cls, uint64_t pc, uint64_t target, bool taken, uint64_t actual_next);
+
+    const DirectionPredictor& direction() const { return *dir_; }
+    const BranchTargetBuffer& btb() const { return btb_; }
+    const ReturnAddressStack& ras() const { return ras_; }
+    const PredictorCounters& overall() const { return overall_; } // every branch, next-PC correct
+    uint64_t history() const { return ghist_; }
+    void checkpoint(CheckpointIO& io); // complete predictor state (see checkpoint.h)
+
+private:
+    std::unique_ptr<DirectionPredictor> dir_;
+    BranchTargetBuffer btb_;
+    ReturnAddressStack ras_;
+    PredictorCounters overall_;
+    uint64_t ghist_ = 0;
+};
+
+#endif // BRANCHPREDICTOR_H
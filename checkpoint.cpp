@@ -0,0 +1,67 @@
+#include "checkpoint.h"
+#include "pipelinesimulator.h"
+#include <cstdio>
+#include <memory>
+
+namespace {
+
+const char CHECKPOINT_MAGIC[8] = {'P', 'L', 'C', 'K', 'P', 'T', '\r', '\n'};
+constexpr uint32_t CHECKPOINT_VERSION = 1;
+
+// Sizes of the structs stored byte-wise; any change of layout makes older files unreadable.
+std::vector<uint32_t> layout_fingerprint() {
+    return {static_cast<uint32_t>(sizeof(ReorderBufferEntry)), static_cast<uint32_t>(sizeof(ReservationStationEntry)),
+            static_cast<uint32_t>(sizeof(LoadStoreBufferEntry)), static_cast<uint32_t>(sizeof(RatEntry)),
+            static_cast<uint32_t>(sizeof(RegisterFile)), static_cast<uint32_t>(sizeof(PagedMemory::Page)),
+            static_cast<uint32_t>(sizeof(CacheLevel::Line)), static_cast<uint32_t>(sizeof(CacheLevel::Mshr)),
+            static_cast<uint32_t>(sizeof(WidthStats)), static_cast<uint32_t>(sizeof(InstructionProfile)),
+            static_cast<uint32_t>(NUM_REGS)};
+}
+
+} // namespace
+
+uint64_t save_checkpoint(PipelineSimulator& sim, const std::string& path) {
+    CheckpointIO io;
+    char magic[8]; std::memcpy(magic, CHECKPOINT_MAGIC, 8); io.raw(magic, 8);
+    uint32_t version = CHECKPOINT_VERSION; io.pod(version);
+    std::vector<uint32_t> layout = layout_fingerprint(); io.vec(layout);
+    std::string config = sim.getConfig().to_string(), program = sim.programSource();
+    io.str(config); io.str(program);
+    sim.checkpoint(io);
+
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "wb"), &std::fclose);
+    if (!file) throw std::runtime_error("Cannot create checkpoint file: " + path);
+    const std::vector<uint8_t>& data = io.buffer();
+    if (std::fwrite(data.data(), 1, data.size(), file.get()) != data.size() || std::fflush(file.get()) != 0)
+        throw std::runtime_error("Cannot write checkpoint file: " + path);
+    return data.size();
+}
+
+void load_checkpoint(PipelineSimulator& sim, const std::string& path) {
+    std::vector<uint8_t> data;
+    {
+        std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+        if (!file) throw std::runtime_error("Cannot open checkpoint file: " + path);
+        std::fseek(file.get(), 0, SEEK_END); long size = std::ftell(file.get()); std::fseek(file.get(), 0, SEEK_SET);
+        if (size < 0) throw std::runtime_error("Cannot read checkpoint file: " + path);
+        data.resize(static_cast<size_t>(size));
+        if (std::fread(data.data(), 1, data.size(), file.get()) != data.size()) throw std::runtime_error("Cannot read checkpoint file: " + path);
+    }
+    CheckpointIO io(data.data(), data.size());
+    char magic[8] = {}; io.raw(magic, 8);
+    if (std::memcmp(magic, CHECKPOINT_MAGIC, 8) != 0) throw std::runtime_error("Not a checkpoint file: " + path);
+    uint32_t version = 0; io.pod(version);
+    if (version != CHECKPOINT_VERSION) throw std::runtime_error("Unsupported checkpoint version " + std::to_string(version) + ": " + path);
+    std::vector<uint32_t> layout; io.vec(layout);
+    if (layout != layout_fingerprint()) throw std::runtime_error("Checkpoint was written by an incompatible build: " + path);
+    std::string config_text, program; io.str(config_text); io.str(program);
+    MachineConfig config; config.load_string(config_text); config.validate();
+
+    try {
+        sim.setConfig(config);
+        sim.parse_and_load_program(program);
+        sim.checkpoint(io);
+        if (io.remaining()) throw std::runtime_error("Checkpoint has trailing data");
+    }
+    catch (...) { sim.reset(); throw; }
+}
@@ -0,0 +1,73 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+class PipelineSimulator;
+
+// On-disk checkpoints of the complete simulator state: the machine configuration, the program source,
+// the ROB, RS, LSB, RAT, wakeup lists and ready/free queues, registers and flags, data memory, the
+// branch predictor, caches, MSHRs, prefetcher and store sets, and every counter. Restoring one and
+// stepping on is bit-exact with the run that wrote it.
+//
+// File layout: magic, format version, a layout fingerprint (struct sizes), then the state. Entries are
+// stored as raw host structs, so a checkpoint is only readable by a build with the same layout; the
+// fingerprint turns a mismatch into an error instead of garbage.
+
+// Symmetric (de)serializer. Each component has a single checkpoint(CheckpointIO&) that saves or restores
+// its fields in the same order, so the two directions cannot drift apart.
+class CheckpointIO {
+public:
+    CheckpointIO() = default;                                                            // saving, into buffer()
+    CheckpointIO(const uint8_t* data, size_t size) : loading_(true), in_(data), in_size_(size) {} // restoring
+
+    bool loading() const { return loading_; }
+    const std::vector<uint8_t>& buffer() const { return out_; }
+    size_t remaining() const { return in_size_ - pos_; }
+
+    void raw(void* p, size_t n) {
+        if (!loading_) { const size_t at = out_.size(); out_.resize(at + n); std::memcpy(out_.data() + at, p, n); return; }
+        if (n > remaining()) throw std::runtime_error("Checkpoint is truncated");
+        std::memcpy(p, in_ + pos_, n); pos_ += n;
+    }
+    template<class T> void pod(T& v) {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint fields are copied byte-wise");
+        raw(&v, sizeof(T));
+    }
+    // fixed_size: the length follows from the configuration, so a different one means a corrupt file.
+    template<class T> void vec(std::vector<T>& v, bool fixed_size = false) {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint fields are copied byte-wise");
+        uint64_t n = v.size(); pod(n);
+        if (loading_) {
+            if (fixed_size && n != v.size()) throw std::runtime_error("Checkpoint does not match its machine configuration");
+            if (n > remaining() / sizeof(T)) throw std::runtime_error("Checkpoint is truncated");
+            v.resize(n);
+        }
+        if (n) raw(v.data(), n * sizeof(T));
+    }
+    void str(std::string& s) {
+        uint64_t n = s.size(); pod(n);
+        if (loading_) { if (n > remaining()) throw std::runtime_error("Checkpoint is truncated"); s.resize(n); }
+        if (n) raw(&s[0], n);
+    }
+
+private:
+    bool loading_ = false;
+    std::vector<uint8_t> out_;
+    const uint8_t* in_ = nullptr; size_t in_size_ = 0, pos_ = 0;
+};
+
+// Writes sim's state to path; returns the file size. Throws std::runtime_error if it cannot be written.
+// Saving does not change sim (checkpoint() is shared with restoring, hence the non-const reference).
+uint64_t save_checkpoint(PipelineSimulator& sim, const std::string& path);
+// Replaces sim's configuration, program and state with the checkpoint's. Throws std::runtime_error on
+// unreadable, incompatible or corrupt files; sim is then reset (no program loaded) unless the file
+// was rejected before anything was changed.
+void load_checkpoint(PipelineSimulator& sim, const std::string& path);
+
+#endif // CHECKPOINT_H
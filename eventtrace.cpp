@@ -0,0 +1,373 @@
+#include "eventtrace.h"
+#include "assembler.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX // windows.h would otherwise define min/max macros that break std::min/std::max
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char TRACE_MAGIC[8] = {'P', 'L', 'T', 'R', 'A', 'C', 'E', '1'};
+static const char INDEX_MAGIC[8] = {'P', 'L', 'T', 'R', 'I', 'D', 'X', '1'};
+static constexpr uint8_t KEYFRAME = 0x80;
+static constexpr size_t FOOTER_BYTES = 24; // index offset, keyframe count, magic
+
+// Indices read from the file are checked before they are used as subscripts; a foreign or damaged trace ends here.
+[[noreturn]] static void corrupt_trace() { throw std::runtime_error("Trace file is corrupt"); }
+
+const char* trace_kind_name(TraceKind k) {
+    static const char* const names[] = {"issue", "execute", "complete", "writeback", "commit", "flush", "memory"};
+    return names[static_cast<int>(k)];
+}
+
+// --- Writer ---
+TraceWriter::TraceWriter(const std::string& path, uint64_t keyframe_interval) : keyframe_interval_(std::max<uint64_t>(keyframe_interval, 1)) {
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) throw std::runtime_error("Cannot create trace file: " + path);
+    buf_.reserve(FLUSH_AT + (size_t(1) << 16));
+}
+
+TraceWriter::~TraceWriter() { finish(); }
+
+void TraceWriter::drain() {
+    if (!buf_.empty() && file_) std::fwrite(buf_.data(), 1, buf_.size(), file_);
+    written_ += buf_.size(); buf_.clear();
+}
+
+void TraceWriter::begin(PipelineSimulator& sim, const std::string& program) {
+    buf_.insert(buf_.end(), TRACE_MAGIC, TRACE_MAGIC + 8);
+    const std::string config = sim.getConfig().to_string();
+    uvar(program.size()); buf_.insert(buf_.end(), program.begin(), program.end());
+    uvar(config.size()); buf_.insert(buf_.end(), config.begin(), config.end());
+    keyframe(sim);
+    sim_ = &sim; sim.setTrace(this);
+}
+
+// Only what the tables show (and what the events keep up to date) is stored; free entries are one byte.
+void TraceWriter::keyframe(const PipelineSimulator& sim) {
+    index_.push_back({sim.cycle_count, written_ + buf_.size()});
+    next_keyframe_ = sim.cycle_count + keyframe_interval_;
+    std::vector<uint8_t> record; record.swap(buf_); // the body is written separately, prefixed with its length
+    uvar(sim.cycle_count); uvar(sim.committed_ins_count);
+    uvar(static_cast<uint64_t>(sim.rob_head)); uvar(static_cast<uint64_t>(sim.rob_tail)); uvar(static_cast<uint64_t>(sim.rob_count));
+    uvar(sim.reorder_buffer.size());
+    for (const ReorderBufferEntry& e : sim.reorder_buffer) {
+        buf_.push_back(e.busy | (e.ready << 1) | (static_cast<uint8_t>(e.state) << 2));
+        if (!e.busy) continue;
+        uvar(e.uop_index); svar(e.value); svar(e.address_result); svar(e.lsb_index);
+    }
+    for (const auto* group : {&sim.alu_rs, &sim.mul_div_rs}) {
+        uvar(group->size());
+        for (const ReservationStationEntry& e : *group) {
+            buf_.push_back(e.busy);
+            if (!e.busy) continue;
+            buf_.push_back(static_cast<uint8_t>(e.op)); svar(e.Vj); svar(e.Vk); svar(e.Qj); svar(e.Qk); svar(e.dest_rob_index);
+        }
+    }
+    uvar(sim.lsb.size());
+    for (const LoadStoreBufferEntry& e : sim.lsb) {
+        buf_.push_back(e.busy);
+        if (!e.busy) continue;
+        buf_.push_back(static_cast<uint8_t>(e.op)); buf_.push_back(e.is_load | (e.address_ready << 1) | (e.forwarded << 2));
+        svar(e.dest_rob_index); svar(e.V_addr); svar(e.Q_addr); svar(e.addr_offset); svar(e.address); svar(e.Vs); svar(e.Qs);
+        if (e.forwarded) svar(e.forward_value);
+    }
+    for (const RatEntry& r : sim.register_alias_table) svar(r.is_rob ? r.rob_index : -1);
+    for (int r = 0; r < NUM_REGS; ++r) svar(sim.reg_file.read(r));
+    uvar(sim.data_memory.word_count());
+    int64_t previous = 0;
+    sim.data_memory.for_each_word([&](int64_t address, int64_t value) { svar(address - previous); svar(value); previous = address; });
+    record.swap(buf_);
+    buf_.push_back(KEYFRAME); uvar(record.size()); buf_.insert(buf_.end(), record.begin(), record.end());
+    last_cycle_ = sim.cycle_count;
+    if (buf_.size() >= FLUSH_AT) drain();
+}
+
+void TraceWriter::finish() {
+    if (!file_) return;
+    if (sim_) {
+        sim_->setTrace(nullptr);
+        if (index_.empty() || index_.back().first != sim_->cycle_count) keyframe(*sim_);
+        sim_ = nullptr;
+    }
+    const uint64_t index_offset = written_ + buf_.size(), count = index_.size();
+    auto raw = [&](uint64_t v) { for (int i = 0; i < 8; ++i) buf_.push_back(static_cast<uint8_t>(v >> (8 * i))); };
+    for (const auto& k : index_) { raw(k.first); raw(k.second); }
+    raw(index_offset); raw(count); buf_.insert(buf_.end(), INDEX_MAGIC, INDEX_MAGIC + 8);
+    drain();
+    std::fclose(file_); file_ = nullptr;
+}
+
+// --- Reader ---
+static uint64_t raw_at(const uint8_t* p) { uint64_t v = 0; for (int i = 7; i >= 0; --i) v = (v << 8) | p[i]; return v; }
+
+TraceReader::TraceReader(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Cannot open trace file: " + path);
+    LARGE_INTEGER bytes; GetFileSizeEx(file, &bytes); size_ = static_cast<size_t>(bytes.QuadPart);
+    HANDLE map = size_ ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    CloseHandle(file);
+    if (map) { data_ = static_cast<const uint8_t*>(MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0)); CloseHandle(map); }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open trace file: " + path);
+    struct stat st; if (::fstat(fd, &st) == 0) size_ = static_cast<size_t>(st.st_size);
+    void* mapped = size_ ? ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (mapped != MAP_FAILED) data_ = static_cast<const uint8_t*>(mapped);
+#endif
+    try { parse(path); } catch (...) { unmap(); throw; } // the destructor does not run for a throwing constructor
+}
+
+void TraceReader::parse(const std::string& path) {
+    auto fail = [&](const std::string& why) { throw std::runtime_error("Not a valid trace file (" + why + "): " + path); };
+    if (!data_ || size_ < 8 + FOOTER_BYTES || std::memcmp(data_, TRACE_MAGIC, 8) != 0) fail("bad header");
+    if (std::memcmp(data_ + size_ - 8, INDEX_MAGIC, 8) != 0) fail("no index; the run did not finish writing it");
+    const uint64_t index_offset = raw_at(data_ + size_ - FOOTER_BYTES), count = raw_at(data_ + size_ - 16);
+    if (count == 0 || index_offset > size_ - FOOTER_BYTES || (size_ - FOOTER_BYTES - index_offset) / 16 != count) fail("bad index");
+    records_end_ = data_ + index_offset;
+    for (uint64_t i = 0; i < count; ++i) {
+        index_.push_back({raw_at(records_end_ + 16 * i), raw_at(records_end_ + 16 * i + 8)});
+        if (index_.back().second >= index_offset) fail("bad index");
+    }
+    const uint8_t* p = data_ + 8;
+    uint64_t n = uvar(p, records_end_);
+    if (n > static_cast<uint64_t>(records_end_ - p)) fail("bad header");
+    program_.assign(reinterpret_cast<const char*>(p), n); p += n;
+    n = uvar(p, records_end_);
+    if (n > static_cast<uint64_t>(records_end_ - p)) fail("bad header");
+    config_.load_string(std::string(reinterpret_cast<const char*>(p), n));
+    try { uop_count_ = assemble(program_, config_).micro_ops.size(); } catch (const AssemblyError&) { fail("bad program"); }
+}
+
+TraceReader::~TraceReader() { unmap(); }
+
+void TraceReader::unmap() {
+    if (!data_) return;
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+#else
+    ::munmap(const_cast<uint8_t*>(data_), size_);
+#endif
+    data_ = nullptr;
+}
+
+uint64_t TraceReader::uvar(const uint8_t*& p, const uint8_t* end) {
+    uint64_t v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++; v |= uint64_t(b & 0x7f) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    throw std::runtime_error("Trace file is truncated");
+}
+
+std::unique_ptr<PipelineSimulator> TraceReader::makeView() const {
+    auto view = std::make_unique<PipelineSimulator>(config_);
+    view->parse_and_load_program(program_);
+    seek(*view, firstCycle());
+    return view;
+}
+
+TraceReader::Cursor TraceReader::cursor_at(uint64_t cycle) const {
+    auto it = std::upper_bound(index_.begin(), index_.end(), cycle, [](uint64_t c, const std::pair<uint64_t, uint64_t>& k) { return c < k.first; });
+    if (it != index_.begin()) --it;
+    return {data_ + it->second, records_end_, it->first};
+}
+
+bool TraceReader::next_event(Cursor& c, TraceEvent& e) const {
+    while (c.p < c.end) {
+        uint8_t kind = *c.p++;
+        if (kind == KEYFRAME) {
+            uint64_t n = uvar(c.p, c.end);
+            if (n > static_cast<uint64_t>(c.end - c.p)) throw std::runtime_error("Trace file is truncated");
+            const uint8_t* body = c.p; c.cycle = uvar(body, c.end); c.p += n;
+            continue;
+        }
+        if (kind >= static_cast<uint8_t>(TraceKind::Count)) corrupt_trace();
+        e = TraceEvent(); e.kind = static_cast<TraceKind>(kind);
+        c.cycle += uvar(c.p, c.end); e.cycle = c.cycle;
+        const uint64_t rob = uvar(c.p, c.end), uop = uvar(c.p, c.end);
+        if (rob >= static_cast<uint64_t>(config_.rob_size) || uop >= uop_count_) corrupt_trace();
+        e.rob = static_cast<int>(rob); e.uop = static_cast<uint32_t>(uop);
+        switch (e.kind) {
+        case TraceKind::Issue:
+            e.station = static_cast<int>(uvar(c.p, c.end));
+            e.v1 = svar(c.p, c.end); e.q1 = static_cast<int>(svar(c.p, c.end)); e.v2 = svar(c.p, c.end); e.q2 = static_cast<int>(svar(c.p, c.end));
+            if (e.q1 < -1 || e.q1 >= config_.rob_size || e.q2 < -1 || e.q2 >= config_.rob_size) corrupt_trace();
+            break;
+        case TraceKind::Writeback: e.value = svar(c.p, c.end); e.address = svar(c.p, c.end); break;
+        case TraceKind::Flush:
+            e.head = static_cast<int>(uvar(c.p, c.end));
+            if (e.head < 0 || e.head >= config_.rob_size) corrupt_trace();
+            break;
+        case TraceKind::MemoryAccess:
+            if (c.p >= c.end) throw std::runtime_error("Trace file is truncated");
+            e.store = *c.p & 1; e.forwarded = (*c.p++ & 2) != 0; e.address = svar(c.p, c.end); e.value = svar(c.p, c.end);
+            break;
+        default: break;
+        }
+        return true;
+    }
+    return false;
+}
+
+void TraceReader::read_keyframe(const uint8_t*& p, PipelineSimulator& v) const {
+    const uint8_t* end = records_end_;
+    if (p >= end || *p++ != KEYFRAME) throw std::runtime_error("Trace index does not point at a keyframe");
+    uvar(p, end);
+    auto byte = [&] { if (p >= end) throw std::runtime_error("Trace file is truncated"); return *p++; };
+    auto count = [&](size_t expected) { if (uvar(p, end) != expected) throw std::runtime_error("Trace does not match its configuration"); };
+    const int rob_size = static_cast<int>(v.reorder_buffer.size()), lsb_size = static_cast<int>(v.lsb.size());
+    auto index = [&](int64_t i, int size) { if (i < -1 || i >= size) corrupt_trace(); return static_cast<int>(i); }; // -1: none
+    auto opcode = [&] { uint8_t op = byte(); if (op > static_cast<uint8_t>(Opcode::JMP_IND)) corrupt_trace(); return static_cast<Opcode>(op); };
+    v.cycle_count = uvar(p, end); v.committed_ins_count = uvar(p, end);
+    const uint64_t head = uvar(p, end), tail = uvar(p, end), busy = uvar(p, end);
+    if (head >= v.reorder_buffer.size() || tail >= v.reorder_buffer.size() || busy > v.reorder_buffer.size()) corrupt_trace();
+    v.rob_head = static_cast<int>(head); v.rob_tail = static_cast<int>(tail); v.rob_count = static_cast<int>(busy);
+    count(v.reorder_buffer.size());
+    for (ReorderBufferEntry& e : v.reorder_buffer) {
+        uint8_t flags = byte(); e = ReorderBufferEntry();
+        if (!(flags & 1)) continue;
+        if ((flags >> 2) > static_cast<uint8_t>(RobState::Commit)) corrupt_trace();
+        e.busy = true; e.ready = flags & 2; e.state = static_cast<RobState>(flags >> 2);
+        const uint64_t uop = uvar(p, end);
+        if (uop >= v.micro_ops.size()) corrupt_trace();
+        e.uop_index = static_cast<uint32_t>(uop); e.value = svar(p, end); e.address_result = svar(p, end); e.lsb_index = index(svar(p, end), lsb_size);
+    }
+    for (auto* group : {&v.alu_rs, &v.mul_div_rs}) {
+        count(group->size());
+        for (ReservationStationEntry& e : *group) {
+            e = ReservationStationEntry();
+            if (!byte()) continue;
+            e.busy = true; e.op = opcode();
+            e.Vj = svar(p, end); e.Vk = svar(p, end); e.Qj = index(svar(p, end), rob_size); e.Qk = index(svar(p, end), rob_size); e.dest_rob_index = index(svar(p, end), rob_size);
+        }
+    }
+    count(v.lsb.size());
+    for (LoadStoreBufferEntry& e : v.lsb) {
+        e = LoadStoreBufferEntry();
+        if (!byte()) continue;
+        e.busy = true; e.op = opcode(); uint8_t flags = byte(); e.is_load = flags & 1; e.address_ready = flags & 2;
+        e.dest_rob_index = index(svar(p, end), rob_size); e.V_addr = svar(p, end); e.Q_addr = index(svar(p, end), rob_size);
+        e.addr_offset = svar(p, end); e.address = svar(p, end); e.Vs = svar(p, end); e.Qs = index(svar(p, end), rob_size);
+        if (flags & 4) { e.forwarded = true; e.forward_value = svar(p, end); }
+    }
+    for (RatEntry& r : v.register_alias_table) { int rob = index(svar(p, end), rob_size); r = {rob >= 0, rob}; }
+    for (int r = 0; r < NUM_REGS; ++r) v.reg_file.write(r, svar(p, end));
+    // Unwritten rather than cleared, so the version keeps rising and the memory table sees every change.
+    std::vector<int64_t> stale;
+    v.data_memory.for_each_word([&](int64_t address, int64_t) { stale.push_back(address); });
+    for (int64_t address : stale) v.data_memory.restore(address, 0, false);
+    int64_t address = 0;
+    for (uint64_t n = uvar(p, end); n > 0; --n) { address += svar(p, end); v.data_memory.write(address, svar(p, end)); }
+}
+
+// Same effects on the displayed state as the core stage that emitted the event. next_event has range-checked
+// e.rob, e.uop and e.head; the station and LSB indices depend on the micro-op and are checked here.
+void TraceReader::apply(PipelineSimulator& v, const TraceEvent& e) {
+    const int size = static_cast<int>(v.reorder_buffer.size());
+    const MicroOp& u = v.micro_ops[e.uop];
+    ReorderBufferEntry& rob = v.reorder_buffer[e.rob];
+    auto free_station = [&] {
+        auto drop = [&](auto& group) { for (auto& s : group) if (s.busy && s.dest_rob_index == e.rob) s.busy = false; };
+        if (u.fu == FUKind::MEMORY) drop(v.lsb); else if (u.fu == FUKind::MULT_DIV) drop(v.mul_div_rs); else drop(v.alu_rs);
+    };
+    // lsb_index was range-checked when it was set (keyframe or issue), but need not be set for this entry.
+    auto lsb_entry = [&]() -> LoadStoreBufferEntry& { if (rob.lsb_index < 0) corrupt_trace(); return v.lsb[rob.lsb_index]; };
+    switch (e.kind) {
+    case TraceKind::Issue: {
+        const size_t stations = u.fu == FUKind::MEMORY ? v.lsb.size() : u.fu == FUKind::MULT_DIV ? v.mul_div_rs.size() : v.alu_rs.size();
+        if (e.station < 0 || static_cast<size_t>(e.station) >= stations || v.rob_count == size) corrupt_trace();
+        rob = ReorderBufferEntry(); rob.busy = true; rob.uop_index = e.uop; rob.state = RobState::Issue; rob.dispatch_cycle = e.cycle;
+        if (u.fu == FUKind::MEMORY) {
+            LoadStoreBufferEntry& l = v.lsb[e.station]; rob.lsb_index = e.station;
+            l = LoadStoreBufferEntry(); l.busy = true; l.op = u.op; l.is_load = u.op == Opcode::LOAD; l.dest_rob_index = e.rob; l.addr_offset = u.disp;
+            l.V_addr = e.v1; l.Q_addr = e.q1; l.Vs = e.v2; l.Qs = e.q2;
+        } else {
+            ReservationStationEntry& s = (u.fu == FUKind::MULT_DIV ? v.mul_div_rs : v.alu_rs)[e.station];
+            s = ReservationStationEntry(); s.busy = true; s.op = u.op; s.dest_rob_index = e.rob;
+            s.Vj = e.v1; s.Qj = e.q1; s.Vk = e.v2; s.Qk = e.q2;
+        }
+        if (u.dst != NO_REG) v.register_alias_table[u.dst] = {true, e.rob};
+        v.rob_tail = (e.rob + 1) % size; v.rob_count++;
+        break;
+    }
+    case TraceKind::ExecuteStart:
+        rob.state = RobState::Execute;
+        if (u.fu == FUKind::MEMORY) { LoadStoreBufferEntry& l = lsb_entry(); l.address = l.V_addr + l.addr_offset; l.address_ready = true; }
+        break;
+    case TraceKind::Complete: free_station(); break;
+    case TraceKind::Writeback:
+        if (u.op == Opcode::STORE) { rob.address_result = e.address; rob.value = e.value; rob.ready = true; break; }
+        rob.value = e.value; rob.state = RobState::Write; rob.ready = true;
+        for (auto* group : {&v.alu_rs, &v.mul_div_rs})
+            for (auto& s : *group) if (s.busy) { if (s.Qj == e.rob) { s.Vj = e.value; s.Qj = -1; } if (s.Qk == e.rob) { s.Vk = e.value; s.Qk = -1; } }
+        for (auto& l : v.lsb) if (l.busy) { if (l.Q_addr == e.rob) { l.V_addr = e.value; l.Q_addr = -1; } if (l.Qs == e.rob) { l.Vs = e.value; l.Qs = -1; } }
+        break;
+    case TraceKind::Commit:
+        if (v.rob_count == 0) corrupt_trace();
+        rob.state = RobState::Commit;
+        if (u.op == Opcode::STORE) lsb_entry().busy = false;
+        if (u.dst != NO_REG) {
+            v.reg_file.write(u.dst, rob.value);
+            RatEntry& r = v.register_alias_table[u.dst]; if (r.is_rob && r.rob_index == e.rob) r = {false, -1};
+        }
+        rob.busy = false; v.rob_head = (e.rob + 1) % size; v.rob_count--;
+        if (u.last) v.committed_ins_count++;
+        break;
+    case TraceKind::Flush: {
+        // A full flush ends with the retired branch itself (no longer busy), which moves the head to 0.
+        if (rob.busy) { if (v.rob_count == 0) corrupt_trace(); free_station(); v.rob_count--; }
+        rob = ReorderBufferEntry(); v.rob_head = e.head; v.rob_tail = (v.rob_head + v.rob_count) % size;
+        // After recovery the RAT points at the youngest remaining producers (same as the checkpoint).
+        v.register_alias_table.fill({false, -1});
+        for (int n = 0; n < v.rob_count; ++n) {
+            int r = (v.rob_head + n) % size; const MicroOp& w = v.micro_ops[v.reorder_buffer[r].uop_index];
+            if (w.dst != NO_REG) v.register_alias_table[w.dst] = {true, r};
+        }
+        break;
+    }
+    case TraceKind::MemoryAccess:
+        if (e.store) { v.data_memory.write(e.address, e.value); break; }
+        rob.address_result = e.address;
+        if (e.forwarded) { LoadStoreBufferEntry& l = lsb_entry(); l.forwarded = true; l.forward_value = e.value; }
+        break;
+    default: break;
+    }
+}
+
+void TraceReader::replay(TraceSink& sink) const {
+    forEachEvent(firstCycle(), lastCycle(), [&](const TraceEvent& e) {
+        switch (e.kind) {
+        case TraceKind::Issue: sink.issue(e.cycle, e.rob, e.uop, e.station, e.v1, e.q1, e.v2, e.q2); break;
+        case TraceKind::ExecuteStart: sink.executeStart(e.cycle, e.rob, e.uop); break;
+        case TraceKind::Complete: sink.complete(e.cycle, e.rob, e.uop); break;
+        case TraceKind::Writeback: sink.writeback(e.cycle, e.rob, e.uop, e.value, e.address); break;
+        case TraceKind::Commit: sink.commit(e.cycle, e.rob, e.uop); break;
+        case TraceKind::Flush: sink.flush(e.cycle, e.rob, e.uop, e.head); break;
+        case TraceKind::MemoryAccess: sink.memoryAccess(e.cycle, e.rob, e.uop, e.store, e.forwarded, e.address, e.value); break;
+        default: break;
+        }
+    });
+}
+
+void TraceReader::seek(PipelineSimulator& view, uint64_t cycle) const {
+    Cursor c = cursor_at(cycle);
+    read_keyframe(c.p, view);
+    TraceEvent e;
+    while (next_event(c, e) && e.cycle <= cycle) apply(view, e);
+    view.cycle_count = std::min(std::max(cycle, firstCycle()), lastCycle());
+    view.rob_head_q = view.rob_head; view.rob_tail_q = view.rob_tail;
+}
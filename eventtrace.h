@@ -0,0 +1,156 @@
+#ifndef EVENTTRACE_H
+#define EVENTTRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "pipelinesimulator.h"
+
+// Binary per-cycle event trace. A run is recorded once (pipelight-cli --trace) and inspected offline
+// without simulating again: TraceReader maps the file and rebuilds the state the GUI tables show at any
+// cycle from the nearest keyframe plus the events after it.
+//
+// File layout: header (magic, program source, machine configuration), then records in cycle order, then
+// the keyframe index and a fixed-size footer pointing at it. A record is a kind byte followed by LEB128
+// varints (zigzag for signed values); events store their cycle as a delta to the previous record's.
+// Keyframes hold the ROB, RS, LSB, RAT, registers and every written memory word, so their size grows
+// with the data footprint; the interval trades file size against seek time.
+//
+// The core's hooks are compiled out with PIPELIGHT_NO_TRACE (CMake: PIPELIGHT_TRACE=OFF).
+
+enum class TraceKind : uint8_t { Issue, ExecuteStart, Complete, Writeback, Commit, Flush, MemoryAccess, Count };
+const char* trace_kind_name(TraceKind k);
+
+// One decoded event. rob and uop identify the micro-op; the instruction address is
+// PipelineSimulator::instructionOf(uop).address.
+struct TraceEvent {
+    TraceKind kind = TraceKind::Issue;
+    uint64_t cycle = 0; int rob = 0; uint32_t uop = 0;
+    int station = -1;                      // Issue: its RS entry, or LSB entry for memory micro-ops
+    int64_t v1 = 0, v2 = 0; int q1 = -1, q2 = -1; // Issue: operands j/k (LSB: address base, store data); q = producer ROB index
+    int64_t value = 0, address = 0;        // Writeback (a store's address and data), MemoryAccess
+    bool store = false;                    // MemoryAccess: a retiring store (else a load performing its access)
+    bool forwarded = false;                // MemoryAccess: a load served by an older in-flight store
+    int head = 0;                          // Flush: ROB head after the squash
+};
+
+bool trace_supported(); // false if the core was built with PIPELIGHT_NO_TRACE
+
+// Receiver of the core's pipeline events (PipelineSimulator::setTrace). The hooks run on the simulating
+// thread, within a cycle in stage order: commit, writeback, execute, issue. Arguments are as in TraceEvent.
+class TraceSink {
+public:
+    virtual ~TraceSink() = default;
+    virtual void issue(uint64_t cycle, int rob, uint32_t uop, int station, int64_t v1, int q1, int64_t v2, int q2) = 0;
+    virtual void executeStart(uint64_t cycle, int rob, uint32_t uop) = 0;
+    virtual void complete(uint64_t cycle, int rob, uint32_t uop) = 0;
+    virtual void writeback(uint64_t cycle, int rob, uint32_t uop, int64_t value, int64_t address) = 0;
+    virtual void commit(uint64_t cycle, int rob, uint32_t uop) = 0;
+    virtual void flush(uint64_t cycle, int rob, uint32_t uop, int head) = 0;
+    virtual void memoryAccess(uint64_t cycle, int rob, uint32_t uop, bool store, bool forwarded, int64_t address, int64_t value) = 0;
+    virtual void endCycle(const PipelineSimulator&) {} // end of a step() or of a skipped stretch
+};
+
+class TraceWriter : public TraceSink {
+public:
+    // Throws std::runtime_error if the file cannot be created. keyframe_interval is in cycles.
+    TraceWriter(const std::string& path, uint64_t keyframe_interval = 4096);
+    ~TraceWriter(); // finish()es
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    // Writes the header and the first keyframe and attaches to sim (setTrace). program is the source sim
+    // was loaded from; the reader needs it to decode micro-ops.
+    void begin(PipelineSimulator& sim, const std::string& program);
+    // Detaches, writes a final keyframe and the index, and closes the file. Safe to call twice.
+    void finish();
+    uint64_t events() const { return events_; }
+    uint64_t bytes() const { return written_ + buf_.size(); }
+
+    void issue(uint64_t cycle, int rob, uint32_t uop, int station, int64_t v1, int q1, int64_t v2, int q2) override {
+        event(TraceKind::Issue, cycle, rob, uop); uvar(station); svar(v1); svar(q1); svar(v2); svar(q2);
+    }
+    void executeStart(uint64_t cycle, int rob, uint32_t uop) override { event(TraceKind::ExecuteStart, cycle, rob, uop); }
+    void complete(uint64_t cycle, int rob, uint32_t uop) override { event(TraceKind::Complete, cycle, rob, uop); }
+    void writeback(uint64_t cycle, int rob, uint32_t uop, int64_t value, int64_t address) override {
+        event(TraceKind::Writeback, cycle, rob, uop); svar(value); svar(address);
+    }
+    void commit(uint64_t cycle, int rob, uint32_t uop) override { event(TraceKind::Commit, cycle, rob, uop); }
+    void flush(uint64_t cycle, int rob, uint32_t uop, int head) override { event(TraceKind::Flush, cycle, rob, uop); uvar(head); }
+    void memoryAccess(uint64_t cycle, int rob, uint32_t uop, bool store, bool forwarded, int64_t address, int64_t value) override {
+        event(TraceKind::MemoryAccess, cycle, rob, uop); buf_.push_back(store | (forwarded << 1)); svar(address); svar(value);
+    }
+    // Writes a keyframe when one is due.
+    void endCycle(const PipelineSimulator& sim) override { if (sim.cycle_count >= next_keyframe_) keyframe(sim); }
+
+private:
+    void event(TraceKind kind, uint64_t cycle, int rob, uint32_t uop) {
+        if (buf_.size() >= FLUSH_AT) drain();
+        buf_.push_back(static_cast<uint8_t>(kind)); uvar(cycle - last_cycle_); last_cycle_ = cycle;
+        uvar(static_cast<uint64_t>(rob)); uvar(uop); events_++;
+    }
+    void uvar(uint64_t v) { while (v >= 0x80) { buf_.push_back(static_cast<uint8_t>(v | 0x80)); v >>= 7; } buf_.push_back(static_cast<uint8_t>(v)); }
+    void svar(int64_t v) { uvar((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63)); }
+    void keyframe(const PipelineSimulator& sim);
+    void drain();
+
+    static constexpr size_t FLUSH_AT = size_t(1) << 20;
+    std::FILE* file_ = nullptr;
+    std::vector<uint8_t> buf_;
+    uint64_t written_ = 0, events_ = 0, last_cycle_ = 0;
+    uint64_t keyframe_interval_, next_keyframe_ = 0;
+    std::vector<std::pair<uint64_t, uint64_t>> index_; // keyframe cycle, file offset
+    PipelineSimulator* sim_ = nullptr;
+};
+
+// Read-only view of a finished trace file, mapped into memory.
+class TraceReader {
+public:
+    explicit TraceReader(const std::string& path); // throws std::runtime_error on unreadable or truncated files
+    ~TraceReader();
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    const std::string& program() const { return program_; }
+    const MachineConfig& config() const { return config_; }
+    uint64_t firstCycle() const { return index_.front().first; }
+    uint64_t lastCycle() const { return index_.back().first; }
+    size_t keyframeCount() const { return index_.size(); }
+
+    // A simulator with the trace's configuration and program loaded, for seek() to fill in.
+    std::unique_ptr<PipelineSimulator> makeView() const;
+    // Rewrites view (from makeView) to the state at the end of `cycle`: the ROB, RS, LSB, RAT, register
+    // and memory contents, the ROB head/tail, cycle_count and committed_ins_count. Costs one keyframe
+    // plus at most keyframe_interval cycles of events. Loads waiting in the LSB (MSHR, older store, miss
+    // in flight) are not traced and show as ready; statistics and predictor state stay at their reset values.
+    void seek(PipelineSimulator& view, uint64_t cycle) const;
+    // Calls f(const TraceEvent&) for every event with first <= cycle <= last, in order.
+    template<class F> void forEachEvent(uint64_t first, uint64_t last, F f) const {
+        Cursor c = cursor_at(first); TraceEvent e;
+        while (next_event(c, e)) { if (e.cycle > last) break; if (e.cycle >= first) f(e); }
+    }
+    // Feeds every recorded event to sink, as the core did while recording (no endCycle calls).
+    void replay(TraceSink& sink) const;
+
+private:
+    struct Cursor { const uint8_t* p; const uint8_t* end; uint64_t cycle; };
+    Cursor cursor_at(uint64_t cycle) const; // just after the last keyframe at or before cycle
+    bool next_event(Cursor& c, TraceEvent& e) const; // skips keyframes; false at the end
+    static uint64_t uvar(const uint8_t*& p, const uint8_t* end);
+    static int64_t svar(const uint8_t*& p, const uint8_t* end) { uint64_t v = uvar(p, end); return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+    void parse(const std::string& path);
+    void unmap();
+    void read_keyframe(const uint8_t*& p, PipelineSimulator& view) const;
+    static void apply(PipelineSimulator& view, const TraceEvent& e);
+
+    const uint8_t* data_ = nullptr; size_t size_ = 0; // the mapped file
+    const uint8_t* records_end_ = nullptr;
+    size_t uop_count_ = 0; // micro-ops of the traced program, for range-checking decoded events
+    std::string program_;
+    MachineConfig config_;
+    std::vector<std::pair<uint64_t, uint64_t>> index_;
+};
+
+#endif // EVENTTRACE_H
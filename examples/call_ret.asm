@@ -0,0 +1,20 @@
+; Stack and subroutine usage: squares 1..10 and accumulates them in R8.
+        MOV RSP, 4096
+        MOV RCX, 10
+next:
+        MOV RAX, RCX
+        CALL square
+        ADD R8, R8, RAX
+        DEC RCX
+        CMP RCX, 0
+        JG next
+        PUSH R8
+        POP R9
+        JMP done
+square:
+        PUSH RBX
+        MUL RAX, RAX, RAX
+        POP RBX
+        RET
+done:
+        STORE R9, [RBP+0]
@@ -0,0 +1,17 @@
+; Independent DIVs and MULs. With unlimited units (the default) every ready MUL/DIV RS entry runs at once;
+; --set div_units=1 leaves one unpipelined divider, so the DIVs go one after another, while with
+; --set mul_units=1 a MUL still starts every cycle. The ports line of the report shows which pool binds.
+        MOV RAX, 1000000
+        MOV RCX, 24
+loop:
+        DIV R8, RAX, 3
+        DIV R9, RAX, 7
+        MUL R10, RCX, 5
+        MUL R11, RCX, 9
+        ADD R12, R12, R8
+        ADD R13, R13, R9
+        ADD R14, R10, R11
+        DEC RCX
+        CMP RCX, 0
+        JNZ loop
+        STORE R14, [RBP+8]
@@ -0,0 +1,20 @@
+; Fills 32 words starting at address 0, then copies them to address 1024.
+        MOV RSI, 0
+        MOV RCX, 32
+fill:
+        STORE RCX, [RSI+0]
+        ADD RSI, RSI, 8
+        DEC RCX
+        CMP RCX, 0
+        JNZ fill
+        MOV RSI, 0
+        MOV RDI, 1024
+        MOV RCX, 32
+copy:
+        LOAD RAX, [RSI+0]
+        STORE RAX, [RDI+0]
+        ADD RSI, RSI, 8
+        ADD RDI, RDI, 8
+        DEC RCX
+        CMP RCX, 0
+        JNZ copy
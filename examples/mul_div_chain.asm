@@ -0,0 +1,11 @@
+; Long-latency MUL/DIV dependency chain.
+        MOV RAX, 3
+        MOV RCX, 40
+loop:
+        MUL RAX, RAX, 7
+        DIV RAX, RAX, 5
+        ADD RDX, RDX, RAX
+        DEC RCX
+        CMP RCX, 0
+        JNZ loop
+        STORE RDX, [RBP+8]
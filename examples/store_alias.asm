@@ -0,0 +1,17 @@
+; Each store gets its address from a MUL, so the younger loads reach the LSB before the store knows
+; where it writes. The first load reads the stored word (it must forward or replay); the second one
+; never aliases and only speculation lets it run early. Compare memory_dependence settings.
+        MOV RCX, 64
+        MOV RSI, 0
+loop:
+        MUL RDI, RSI, 1
+        STORE RCX, [RDI+0]
+        LOAD RAX, [RSI+0]
+        LOAD RDX, [RSI+4096]
+        ADD RBX, RBX, RAX
+        ADD RBX, RBX, RDX
+        ADD RSI, RSI, 8
+        DEC RCX
+        CMP RCX, 0
+        JNZ loop
+        STORE RBX, [RBP+8192]
@@ -0,0 +1,14 @@
+; Sums 2048 consecutive words starting at address 65536 (preload them with --data 65536:FILE).
+; Each 64-byte line serves 8 loads, so the kernel is bound by L2/memory misses unless a prefetcher
+; runs ahead of it: compare --set prefetcher=none, nextline and stride.
+        MOV RSI, 65536
+        MOV RCX, 2048
+        MOV RBX, 0
+loop:
+        LOAD RAX, [RSI+0]
+        ADD RBX, RBX, RAX
+        ADD RSI, RSI, 8
+        DEC RCX
+        CMP RCX, 0
+        JNZ loop
+        STORE RBX, [RBP+0]
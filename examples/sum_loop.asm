@@ -0,0 +1,9 @@
+; Sums 1..100 into RBX and stores the result.
+        MOV RAX, 100
+        MOV RBX, 0
+loop:
+        ADD RBX, RBX, RAX
+        DEC RAX
+        CMP RAX, 0
+        JNZ loop
+        STORE RBX, [RBP+0]
@@ -0,0 +1,16 @@
+; Sums table[idx[i]] for the 8 entries of idx: scaled-index loads through a .data table.
+        MOV RCX, 0
+        MOV RAX, 0
+loop:
+        LOAD RDX, [idx+RCX*8]
+        LOAD RBX, [table+RDX*8]
+        ADD RAX, RAX, RBX
+        INC RCX
+        CMP RCX, 8
+        JL loop
+        STORE RAX, [result]
+
+        .data
+table:  .word 5, 10, 15, 20, 25, 30, 35, 40
+idx:    .word 7, 0, 3, 3, 6, 1, 2, 5
+result: .space 8
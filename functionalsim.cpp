@@ -0,0 +1,81 @@
+#include "functionalsim.h"
+#include <stdexcept>
+
+UopEffect FunctionalSimulator::execute(const PipelineSimulator& sim, uint32_t uop, RegisterFile& regs, PagedMemory& memory) {
+    const MicroOp& u = sim.micro_ops[uop];
+    UopEffect e; e.next = uop + 1;
+    switch (u.op) {
+    case Opcode::LOAD:
+        e.address = (u.src1 != NO_REG ? regs.read(u.src1) : 0) + u.disp; e.value = memory.read(e.address); regs.write(u.dst, e.value);
+        break;
+    case Opcode::STORE:
+        e.address = (u.src1 != NO_REG ? regs.read(u.src1) : 0) + u.disp; e.value = u.src2 != NO_REG ? regs.read(u.src2) : u.imm;
+        memory.write(e.address, e.value);
+        break;
+    default: {
+        // Operands are picked as in dispatch: the immediate when there is no source register.
+        const int64_t vj = u.src1 != NO_REG ? regs.read(u.src1) : u.imm, vk = u.src2 != NO_REG ? regs.read(u.src2) : u.imm;
+        e.value = alu_result(u.op, vj, vk, u.shift);
+        if (is_branch_op(u.op)) {
+            e.taken = branch_taken(u.op, vj & 1, vj & 2, vj & 4);
+            if (e.taken) e.next = u.op == Opcode::JMP_IND ? sim.instruction_to_uop(vj) : u.target;
+        }
+        if (u.dst != NO_REG) regs.write(u.dst, e.value);
+    }
+    }
+    return e;
+}
+
+uint64_t FunctionalSimulator::run(uint64_t max_instructions, int64_t stop_address) {
+    PipelineSimulator& s = sim_;
+    if (s.rob_count != 0) throw std::runtime_error("Fast-forward needs an empty pipeline");
+    const uint64_t end = s.micro_ops.size(), stop = stop_address < 0 ? UINT64_MAX : s.instruction_to_uop(stop_address);
+    uint64_t pc = s.program_counter, done = 0;
+    while (pc < end && pc != stop && done < max_instructions) {
+        const MicroOp& u = s.micro_ops[pc];
+        const UopEffect e = execute(s, static_cast<uint32_t>(pc), s.reg_file, s.data_memory);
+        if (warm_caches_ && u.fu == FUKind::MEMORY) s.memory_hierarchy.warm(e.address, u.op == Opcode::STORE);
+        if (warm_predictors_ && u.fu == FUKind::BRANCH) s.branch_unit.warm(u.branch_class, pc, u.target, e.taken, e.next);
+        if (u.last) done++;
+        pc = e.next;
+    }
+    s.program_counter = pc;
+    return done;
+}
+
+void LockstepChecker::begin(PipelineSimulator& sim) {
+    if (sim.rob_count != 0) throw std::runtime_error("The commit checker needs an empty pipeline");
+    sim_ = &sim; regs_ = sim.reg_file; memory_ = sim.data_memory; pc_ = sim.program_counter;
+    checked_ = 0; diverged_ = false; first_ = Divergence();
+    sim.setTrace(this);
+}
+
+void LockstepChecker::finish() {
+    if (!sim_) return;
+    sim_->setTrace(nullptr);
+    if (!diverged_ && sim_->rob_count == 0)
+        for (int r = 0; r < NUM_REGS; ++r)
+            if (sim_->reg_file.read(r) != regs_.read(r)) { mismatch(sim_->cycle_count, static_cast<uint32_t>(pc_), std::string("register ") + reg_name(r), regs_.read(r), sim_->reg_file.read(r)); break; }
+    sim_ = nullptr;
+}
+
+void LockstepChecker::commit(uint64_t cycle, int rob, uint32_t uop) {
+    if (diverged_) return;
+    if (uop != pc_) { mismatch(cycle, uop, "retired micro-op", static_cast<int64_t>(pc_), uop); return; }
+    const ReorderBufferEntry& e = sim_->reorder_buffer[rob]; const MicroOp& u = sim_->micro_ops[uop];
+    const UopEffect f = FunctionalSimulator::execute(*sim_, uop, regs_, memory_);
+    checked_++; pc_ = f.next;
+    if (u.fu == FUKind::MEMORY && e.address_result != f.address) mismatch(cycle, uop, "address", f.address, e.address_result);
+    else if ((u.dst != NO_REG || u.op == Opcode::STORE) && e.value != f.value) mismatch(cycle, uop, u.op == Opcode::STORE ? "store data" : "value", f.value, e.value);
+    else if (u.fu == FUKind::BRANCH && e.resolved_next != f.next) mismatch(cycle, uop, "next micro-op", static_cast<int64_t>(f.next), static_cast<int64_t>(e.resolved_next));
+}
+
+void LockstepChecker::mismatch(uint64_t cycle, uint32_t uop, const std::string& what, int64_t expected, int64_t actual) {
+    diverged_ = true; first_ = {cycle, uop, what, expected, actual, uop < sim_->micro_ops.size() ? sim_->uopText(uop) : "end of program"};
+}
+
+std::string LockstepChecker::report() const {
+    if (!diverged_) return "ok, " + std::to_string(checked_) + " micro-ops";
+    return "cycle " + std::to_string(first_.cycle) + ", micro-op " + std::to_string(first_.uop) + " (" + first_.text + "): " + first_.what +
+           " expected " + std::to_string(first_.expected) + ", got " + std::to_string(first_.actual);
+}
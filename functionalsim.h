@@ -0,0 +1,81 @@
+#ifndef FUNCTIONALSIM_H
+#define FUNCTIONALSIM_H
+
+#include <cstdint>
+#include <string>
+#include "eventtrace.h"
+
+// Functional (untimed) model of the loaded program: one micro-op at a time, straight on the architectural
+// registers, flags and data memory, with no ROB, reservation stations or LSB. The arithmetic is the
+// pipeline's own (alu_result, branch_taken), so the two models agree bit for bit.
+
+// What one micro-op did, for comparing against the pipeline's result.
+struct UopEffect {
+    int64_t value = 0;   // written to dst (CMP: packed flags); STORE: the stored data
+    int64_t address = 0; // LOAD/STORE: effective address
+    uint64_t next = 0;   // next micro-op index (micro_ops.size() past the end)
+    bool taken = false;  // branches
+};
+
+// Fast-forward: runs sim's program from its current architectural state and leaves the state it reaches -
+// registers, flags, data memory and program_counter - for step()/advance() to continue in detail.
+// cycle_count, committed_ins_count and the statistics do not move. With warming on, the branch predictor
+// and the caches see every branch and memory access in program order, so the detailed region does not
+// start cold.
+class FunctionalSimulator {
+public:
+    explicit FunctionalSimulator(PipelineSimulator& sim) : sim_(sim) {}
+    void setWarmup(bool predictors, bool caches) { warm_predictors_ = predictors; warm_caches_ = caches; }
+
+    // Executes up to max_instructions instructions; stops earlier when the next instruction is the one at
+    // stop_address (-1: none; checked before each instruction, the first one included) or the program
+    // ends. The pipeline must be empty (after loading, or once drained), else std::runtime_error is thrown.
+    // Returns the number of instructions executed.
+    uint64_t run(uint64_t max_instructions, int64_t stop_address = -1);
+
+    // Executes micro-op uop of sim's program on regs/memory.
+    static UopEffect execute(const PipelineSimulator& sim, uint32_t uop, RegisterFile& regs, PagedMemory& memory);
+
+private:
+    PipelineSimulator& sim_;
+    bool warm_predictors_ = false, warm_caches_ = false;
+};
+
+// Lockstep commit checker: attached as the trace sink, it executes every retiring micro-op on a
+// functional copy of the architectural state and compares the pipeline's result - the micro-op itself
+// (retirement order), its value, its memory address and a branch's next micro-op - and, at the end,
+// the register file. Only the first divergence is kept.
+class LockstepChecker : public TraceSink {
+public:
+    struct Divergence { uint64_t cycle = 0; uint32_t uop = 0; std::string what; int64_t expected = 0, actual = 0; std::string text; };
+
+    ~LockstepChecker() override { finish(); }
+    // Copies sim's architectural state and attaches (setTrace). The pipeline must be empty.
+    void begin(PipelineSimulator& sim);
+    // Detaches; if sim has drained, compares the final registers. Safe to call twice.
+    void finish();
+    bool ok() const { return !diverged_; }
+    const Divergence& divergence() const { return first_; }
+    uint64_t checked() const { return checked_; } // retired micro-ops compared
+    std::string report() const; // one line: "ok, N micro-ops" or the divergence
+
+    void commit(uint64_t cycle, int rob, uint32_t uop) override;
+    void issue(uint64_t, int, uint32_t, int, int64_t, int, int64_t, int) override {}
+    void executeStart(uint64_t, int, uint32_t) override {}
+    void complete(uint64_t, int, uint32_t) override {}
+    void writeback(uint64_t, int, uint32_t, int64_t, int64_t) override {}
+    void flush(uint64_t, int, uint32_t, int) override {}
+    void memoryAccess(uint64_t, int, uint32_t, bool, bool, int64_t, int64_t) override {}
+
+private:
+    void mismatch(uint64_t cycle, uint32_t uop, const std::string& what, int64_t expected, int64_t actual);
+
+    PipelineSimulator* sim_ = nullptr;
+    RegisterFile regs_;
+    PagedMemory memory_;
+    uint64_t pc_ = 0, checked_ = 0;
+    bool diverged_ = false;
+    Divergence first_;
+};
+
+#endif // FUNCTIONALSIM_H
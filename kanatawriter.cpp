@@ -0,0 +1,104 @@
+#include "kanatawriter.h"
+#include <charconv>
+#include <stdexcept>
+
+KanataWriter::KanataWriter(const std::string& path) {
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) throw std::runtime_error("Cannot create pipeline diagram file: " + path);
+    buf_.reserve(FLUSH_AT + 4096);
+}
+
+KanataWriter::~KanataWriter() { finish(); }
+
+void KanataWriter::begin(PipelineSimulator& sim) {
+    start(sim, sim.cycle_count);
+    attached_ = &sim; sim.setTrace(this);
+}
+
+void KanataWriter::beginReplay(const PipelineSimulator& sim, uint64_t cycle) { start(sim, cycle); }
+
+void KanataWriter::start(const PipelineSimulator& sim, uint64_t cycle) {
+    labels_ = &sim; cycle_ = cycle;
+    row_of_rob_.assign(sim.getROB().size(), -1);
+    buf_ += "Kanata\t0004\n";
+    buf_ += "C=\t"; buf_ += std::to_string(cycle); buf_ += '\n';
+}
+
+void KanataWriter::finish() {
+    if (!file_) return;
+    if (attached_) { attached_->setTrace(nullptr); attached_ = nullptr; }
+    advance(cycle_ + 1);
+    for (int64_t& row : row_of_rob_) if (row >= 0) { line('R', static_cast<uint64_t>(row), 0, 1); row = -1; }
+    drain();
+    std::fclose(file_); file_ = nullptr;
+}
+
+void KanataWriter::drain() {
+    if (!buf_.empty() && file_) std::fwrite(buf_.data(), 1, buf_.size(), file_);
+    buf_.clear();
+}
+
+void KanataWriter::line(char tag, uint64_t a, uint64_t b, uint64_t c) {
+    char tmp[80]; char* p = tmp; char* end = tmp + sizeof(tmp);
+    *p++ = tag;
+    for (uint64_t v : {a, b, c}) { *p++ = '\t'; p = std::to_chars(p, end, v).ptr; }
+    *p++ = '\n';
+    buf_.append(tmp, p);
+    if (buf_.size() >= FLUSH_AT) drain();
+}
+
+void KanataWriter::line(char tag, uint64_t id, int lane, const char* text) {
+    buf_ += tag; buf_ += '\t'; buf_ += std::to_string(id); buf_ += '\t'; buf_ += std::to_string(lane); buf_ += '\t';
+    buf_ += text; buf_ += '\n';
+    if (buf_.size() >= FLUSH_AT) drain();
+}
+
+// Moves the log's clock to `cycle`; what was deferred to the cycle after the last one shows first.
+void KanataWriter::advance(uint64_t cycle) {
+    if (cycle <= cycle_) return;
+    buf_ += "C\t1\n"; cycle_++;
+    for (uint64_t row : pending_issue_) line('S', row, 0, "Is");
+    for (const auto& r : pending_retire_) line('R', r.first, r.second ? 0 : next_retire_++, r.second ? 1 : 0);
+    pending_issue_.clear(); pending_retire_.clear();
+    if (cycle > cycle_) { buf_ += "C\t"; buf_ += std::to_string(cycle - cycle_); buf_ += '\n'; cycle_ = cycle; }
+}
+
+void KanataWriter::stage(uint64_t cycle, int rob, const char* name) {
+    advance(cycle);
+    if (row_of_rob_[rob] >= 0) line('S', static_cast<uint64_t>(row_of_rob_[rob]), 0, name);
+}
+
+void KanataWriter::issue(uint64_t cycle, int rob, uint32_t uop, int, int64_t, int, int64_t, int) {
+    advance(cycle);
+    const uint64_t row = next_id_++;
+    row_of_rob_[rob] = static_cast<int64_t>(row);
+    line('I', row, row, 0);
+    std::string label = std::to_string(labels_->instructionOf(uop).address) + ": " + labels_->uopText(uop);
+    for (char& ch : label) if (ch == '\t' || ch == '\n' || ch == '\r') ch = ' ';
+    line('L', row, 0, label.c_str());
+    line('S', row, 0, "F");
+    pending_issue_.push_back(row);
+}
+
+void KanataWriter::writeback(uint64_t cycle, int rob, uint32_t, int64_t, int64_t) { stage(cycle, rob, "Wb"); }
+
+void KanataWriter::memoryAccess(uint64_t cycle, int rob, uint32_t, bool store, bool, int64_t, int64_t) {
+    if (!store) stage(cycle, rob, "M"); // a store writes memory as it commits
+}
+
+void KanataWriter::commit(uint64_t cycle, int rob, uint32_t) {
+    stage(cycle, rob, "Cm");
+    retire(rob, false);
+}
+
+void KanataWriter::flush(uint64_t cycle, int rob, uint32_t, int) {
+    advance(cycle);
+    retire(rob, true); // after a full flush this is also called for the branch that already retired
+}
+
+void KanataWriter::retire(int rob, bool flushed) {
+    int64_t& row = row_of_rob_[rob];
+    if (row < 0) return;
+    pending_retire_.push_back({static_cast<uint64_t>(row), flushed});
+    row = -1;
+}
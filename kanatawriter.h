@@ -0,0 +1,62 @@
+#ifndef KANATAWRITER_H
+#define KANATAWRITER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "eventtrace.h"
+
+// Pipeline-diagram export in the Kanata log format (version 0004) read by the Konata viewer. Each
+// dispatched micro-op becomes one row with the stages F (fetch and dispatch), Is (waiting in its RS/LSB
+// entry), X (executing), M (a load's memory access), Wb (result written, waiting to commit) and Cm,
+// and leaves the diagram with a retire or, when squashed, a flush record.
+//
+// The log is streamed: only the rows in flight (at most one per ROB entry) are kept, so memory use does
+// not grow with the length of the run.
+class KanataWriter : public TraceSink {
+public:
+    explicit KanataWriter(const std::string& path); // throws std::runtime_error if the file cannot be created
+    ~KanataWriter() override; // finish()es
+    KanataWriter(const KanataWriter&) = delete;
+    KanataWriter& operator=(const KanataWriter&) = delete;
+
+    // Writes the header and attaches to sim. Micro-ops already in flight are left out of the diagram.
+    void begin(PipelineSimulator& sim);
+    // For replaying a recorded trace (TraceReader::replay): like begin(), without attaching. sim must
+    // have the trace's program loaded; it is only used for the instruction labels.
+    void beginReplay(const PipelineSimulator& sim, uint64_t cycle);
+    // Detaches, marks the rows still in flight as flushed and closes the file. Safe to call twice.
+    void finish();
+    uint64_t rows() const { return next_id_; }
+
+    void issue(uint64_t cycle, int rob, uint32_t uop, int station, int64_t v1, int q1, int64_t v2, int q2) override;
+    void executeStart(uint64_t cycle, int rob, uint32_t) override { stage(cycle, rob, "X"); }
+    void complete(uint64_t, int, uint32_t) override {}
+    void writeback(uint64_t cycle, int rob, uint32_t uop, int64_t value, int64_t address) override;
+    void commit(uint64_t cycle, int rob, uint32_t uop) override;
+    void flush(uint64_t cycle, int rob, uint32_t uop, int head) override;
+    void memoryAccess(uint64_t cycle, int rob, uint32_t uop, bool store, bool forwarded, int64_t address, int64_t value) override;
+
+private:
+    void start(const PipelineSimulator& sim, uint64_t cycle);
+    void advance(uint64_t cycle);
+    void stage(uint64_t cycle, int rob, const char* name);
+    void retire(int rob, bool flushed);
+    void line(char tag, uint64_t a, uint64_t b, uint64_t c);
+    void line(char tag, uint64_t id, int lane, const char* text);
+    void drain();
+
+    static constexpr size_t FLUSH_AT = size_t(1) << 20;
+    std::FILE* file_ = nullptr;
+    std::string buf_;
+    const PipelineSimulator* labels_ = nullptr;
+    PipelineSimulator* attached_ = nullptr;
+    uint64_t cycle_ = 0, next_id_ = 0, next_retire_ = 0;
+    std::vector<int64_t> row_of_rob_; // Konata row of each ROB entry in flight, -1 if none
+    // Stage changes that show from the next cycle: Is after dispatch, the end of a row after commit or flush.
+    std::vector<uint64_t> pending_issue_;
+    std::vector<std::pair<uint64_t, bool>> pending_retire_; // row, flushed
+};
+
+#endif // KANATAWRITER_H
@@ -0,0 +1,136 @@
+#include "machineconfig.h"
+#include "textutil.h"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+static const char* const PREDICTOR_NAMES[] = {"static", "bimodal", "gshare", "tage", nullptr};
+static const char* const RESOLUTION_NAMES[] = {"execute", "commit", nullptr};
+static const char* const WRITE_POLICY_NAMES[] = {"writeback", "writethrough", nullptr};
+static const char* const PREFETCHER_NAMES[] = {"none", "nextline", "stride", nullptr};
+static const char* const DEPENDENCE_NAMES[] = {"conservative", "speculative", "storeset", nullptr};
+static const char* const SELECT_NAMES[] = {"oldest", "random", "position", nullptr};
+
+const std::vector<MachineConfig::Field>& MachineConfig::fields() {
+    static const std::vector<Field> table = {
+        {"rob_size", "Reorder buffer entries", &MachineConfig::rob_size, 1, 65536},
+        {"alu_rs_size", "ALU/branch reservation station entries", &MachineConfig::alu_rs_size, 1, 65536},
+        {"mul_div_rs_size", "MUL/DIV reservation station entries", &MachineConfig::mul_div_rs_size, 1, 65536},
+        {"lsb_size", "Load/store buffer entries", &MachineConfig::lsb_size, 1, 65536},
+        {"alu_latency", "ALU and branch latency (cycles)", &MachineConfig::alu_latency, 1, 255},
+        {"mul_latency", "MUL latency (cycles)", &MachineConfig::mul_latency, 1, 255},
+        {"div_latency", "DIV latency (cycles)", &MachineConfig::div_latency, 1, 255},
+        {"issue_width", "Micro-ops fetched/renamed/dispatched per cycle", &MachineConfig::issue_width, 1, 64},
+        {"commit_width", "ROB entries retired per cycle", &MachineConfig::commit_width, 1, 64},
+        {"cdb_width", "Results broadcast on the CDB per cycle (0 = unlimited)", &MachineConfig::cdb_width, 0, 64},
+        {"alu_units", "ALU/branch units, pipelined (0 = one per RS entry)", &MachineConfig::alu_units, 0, 64},
+        {"mul_units", "Pipelined multipliers (0 = unlimited)", &MachineConfig::mul_units, 0, 64},
+        {"div_units", "Unpipelined dividers (0 = unlimited)", &MachineConfig::div_units, 0, 64},
+        {"agu_units", "Load/store address units per cycle (0 = unlimited)", &MachineConfig::agu_units, 0, 64},
+        {"load_ports", "Loads accessing the L1 per cycle (0 = unlimited)", &MachineConfig::load_ports, 0, 64},
+        {"store_ports", "Stores written into the store queue per cycle (0 = unlimited)", &MachineConfig::store_ports, 0, 64},
+        {"select_policy", "Which ready operations get a busy unit: oldest (ROB age), random, position (lowest entry)", &MachineConfig::select_policy, 0, 2, SELECT_NAMES},
+        {"predictor", "Branch direction predictor", &MachineConfig::predictor, 0, 3, PREDICTOR_NAMES},
+        {"bp_table_bits", "log2 of the predictor table size", &MachineConfig::bp_table_bits, 4, 24},
+        {"bp_history_bits", "Global history bits (gshare)", &MachineConfig::bp_history_bits, 1, 64},
+        {"btb_entries", "Branch target buffer entries, power of two (0 = ideal targets)", &MachineConfig::btb_entries, 0, 65536},
+        {"ras_entries", "Return-address stack entries (0 = none)", &MachineConfig::ras_entries, 0, 1024},
+        {"branch_resolution", "Where mispredicts are repaired: execute (selective squash) or commit (full flush)", &MachineConfig::branch_resolution, 0, 1, RESOLUTION_NAMES},
+        {"l1d_size", "L1 data cache size in KiB (0 = ideal memory)", &MachineConfig::l1d_size, 0, 65536},
+        {"l1d_assoc", "L1 data cache ways", &MachineConfig::l1d_assoc, 1, 64},
+        {"l1d_latency", "L1 hit latency (cycles)", &MachineConfig::l1d_latency, 1, 255},
+        {"l1d_mshrs", "Outstanding L1 misses (MSHRs)", &MachineConfig::l1d_mshrs, 1, 256},
+        {"l1d_write_policy", "L1 write policy", &MachineConfig::l1d_write_policy, 0, 1, WRITE_POLICY_NAMES},
+        {"l2_size", "L2 cache size in KiB (0 = none)", &MachineConfig::l2_size, 0, 65536},
+        {"l2_assoc", "L2 cache ways", &MachineConfig::l2_assoc, 1, 64},
+        {"l2_latency", "L2 hit latency added to an L1 miss (cycles)", &MachineConfig::l2_latency, 1, 1023},
+        {"l2_mshrs", "Outstanding L2 misses (MSHRs)", &MachineConfig::l2_mshrs, 1, 256},
+        {"l2_write_policy", "L2 write policy", &MachineConfig::l2_write_policy, 0, 1, WRITE_POLICY_NAMES},
+        {"line_size", "Cache line size in bytes, power of two", &MachineConfig::line_size, 8, 4096},
+        {"mem_latency", "Memory latency added to an L2 miss (cycles)", &MachineConfig::mem_latency, 1, 100000},
+        {"prefetcher", "L1 data prefetcher", &MachineConfig::prefetcher, 0, 2, PREFETCHER_NAMES},
+        {"prefetch_degree", "Lines prefetched per trigger", &MachineConfig::prefetch_degree, 1, 16},
+        {"memory_dependence", "Loads past unresolved older stores: conservative (wait), speculative (replay on violation), storeset (predicted)", &MachineConfig::memory_dependence, 0, 2, DEPENDENCE_NAMES},
+        {"store_set_entries", "Store-set id table entries, power of two", &MachineConfig::store_set_entries, 1, 65536},
+    };
+    return table;
+}
+
+const MachineConfig::Field* MachineConfig::find_field(const std::string& key) {
+    for (const auto& f : fields()) { if (key == f.key) return &f; }
+    return nullptr;
+}
+
+void MachineConfig::set(const std::string& key, const std::string& value) {
+    const Field* f = find_field(key);
+    if (!f) throw std::runtime_error("Unknown config key: " + key);
+    if (f->names) {
+        std::string all;
+        for (int i = 0; f->names[i]; ++i) {
+            if (value == f->names[i]) { this->*(f->member) = i; return; }
+            all += (i ? ", " : "") + std::string(f->names[i]);
+        }
+        throw std::runtime_error("Config value for " + key + " must be one of " + all + ": " + value);
+    }
+    long long v = 0; size_t used = 0;
+    try { v = std::stoll(value, &used); } catch (...) { used = 0; }
+    if (used == 0 || used != value.size()) throw std::runtime_error("Config value for " + key + " is not an integer: " + value);
+    if (v < f->min_value || v > f->max_value)
+        throw std::runtime_error("Config value for " + key + " out of range [" + std::to_string(f->min_value) + ", " + std::to_string(f->max_value) + "]: " + value);
+    this->*(f->member) = static_cast<int>(v);
+}
+
+void MachineConfig::set_assignment(const std::string& key_equals_value) {
+    size_t eq = key_equals_value.find('=');
+    if (eq == std::string::npos) throw std::runtime_error("Expected key=value, got: " + key_equals_value);
+    set(trim(key_equals_value.substr(0, eq)), trim(key_equals_value.substr(eq + 1)));
+}
+
+void MachineConfig::load_string(const std::string& text) {
+    std::stringstream ss(text); std::string line; int line_no = 0;
+    while (std::getline(ss, line)) {
+        line_no++;
+        size_t comment = line.find('#'); if (comment != std::string::npos) line = line.substr(0, comment);
+        line = trim(line);
+        if (line.empty()) continue;
+        try { set_assignment(line); }
+        catch (const std::exception& e) { throw std::runtime_error("line " + std::to_string(line_no) + ": " + e.what()); }
+    }
+    validate();
+}
+
+void MachineConfig::load_file(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Cannot open config file: " + path);
+    std::stringstream ss; ss << in.rdbuf();
+    try { load_string(ss.str()); }
+    catch (const std::exception& e) { throw std::runtime_error(path + ": " + e.what()); }
+}
+
+std::string MachineConfig::to_string() const {
+    std::string out;
+    for (const auto& f : fields()) { out += std::string(f.key) + " = " + value_string(f) + "\n"; }
+    return out;
+}
+
+std::string MachineConfig::value_string(const Field& f) const {
+    int v = this->*(f.member);
+    return f.names ? std::string(f.names[v]) : std::to_string(v);
+}
+
+void MachineConfig::validate() const {
+    for (const auto& f : fields()) {
+        int v = this->*(f.member);
+        if (v < f.min_value || v > f.max_value) throw std::runtime_error(std::string("Config value out of range: ") + f.key);
+    }
+    if (btb_entries & (btb_entries - 1)) throw std::runtime_error("btb_entries must be 0 or a power of two");
+    if (store_set_entries & (store_set_entries - 1)) throw std::runtime_error("store_set_entries must be a power of two");
+    if (line_size & (line_size - 1)) throw std::runtime_error("line_size must be a power of two");
+    if (l1d_size > 0 && l1d_size * 1024 < line_size) throw std::runtime_error("l1d_size is smaller than one line");
+    if (l2_size > 0 && l2_size * 1024 < line_size) throw std::runtime_error("l2_size is smaller than one line");
+}
+
+bool MachineConfig::operator==(const MachineConfig& o) const {
+    for (const auto& f : fields()) { if (this->*(f.member) != o.*(f.member)) return false; }
+    return true;
+}
@@ -0,0 +1,73 @@
+#ifndef MACHINECONFIG_H
+#define MACHINECONFIG_H
+
+#include <string>
+#include <vector>
+
+// Microarchitecture parameters of a PipelineSimulator instance. Loaded from a "key = value" file,
+// from --set key=value flags, or edited in the GUI through the fields() table.
+struct MachineConfig {
+    int rob_size = 32;
+    int alu_rs_size = 6;
+    int mul_div_rs_size = 3;
+    int lsb_size = 6;
+    int alu_latency = 2;
+    int mul_latency = 8;
+    int div_latency = 20;
+    int issue_width = 1;   // micro-ops fetched, renamed and dispatched per cycle
+    int commit_width = 1;  // ROB entries retired per cycle
+    int cdb_width = 0;     // results broadcast per cycle (writeback ports); 0 = unlimited
+    // Execution units; 0 = unlimited (every ready RS/LSB entry starts at once). Pipelined units accept one
+    // operation per cycle each, a divider is busy for the whole DIV.
+    int alu_units = 0;     // ALU/branch
+    int mul_units = 0;     // pipelined multipliers
+    int div_units = 0;     // unpipelined dividers
+    int agu_units = 0;     // load/store address generation
+    int load_ports = 0;    // loads reading the L1 or forwarding from a store
+    int store_ports = 0;   // stores writing address and data into the store queue
+    int select_policy = 0; // SelectPolicy: oldest, random, position - which ready operations get the units
+    int predictor = 3;          // PredictorKind: static, bimodal, gshare, tage
+    int bp_table_bits = 12;     // log2 of the direction predictor's counter table
+    int bp_history_bits = 12;   // global history length used by gshare
+    int btb_entries = 512;      // power of two; 0 = targets of direct branches are always known
+    int ras_entries = 16;       // 0 = no return-address stack
+    int branch_resolution = 0;  // execute: recover when the branch executes; commit: full flush at the ROB head
+    int l1d_size = 32;          // KiB; 0 = ideal memory (every load is ready in the cycle its address is)
+    int l1d_assoc = 8;
+    int l1d_latency = 3;        // load-to-use cycles on an L1 hit
+    int l1d_mshrs = 8;          // outstanding L1 misses
+    int l1d_write_policy = 0;   // WritePolicy: writeback (write-allocate), writethrough (no-write-allocate)
+    int l2_size = 256;          // KiB; 0 = no L2
+    int l2_assoc = 8;
+    int l2_latency = 12;        // added on an L1 miss
+    int l2_mshrs = 16;
+    int l2_write_policy = 0;
+    int line_size = 64;         // bytes, shared by both levels
+    int mem_latency = 100;      // added on an L2 miss
+    int prefetcher = 0;         // PrefetcherKind: none, nextline, stride (into L1)
+    int prefetch_degree = 1;    // lines requested per trigger
+    int memory_dependence = 2;  // loads vs older unresolved stores: conservative (wait), speculative, storeset
+    int store_set_entries = 1024; // store-set id table, power of two
+
+    struct Field {
+        const char* key; const char* help;
+        int MachineConfig::* member; int min_value, max_value;
+        const char* const* names = nullptr; // enumerated field: value i is spelled names[i]
+    };
+    static const std::vector<Field>& fields();
+    static const Field* find_field(const std::string& key);
+
+    // Throws std::runtime_error with a readable message on unknown keys or out-of-range values.
+    void set(const std::string& key, const std::string& value);
+    void set_assignment(const std::string& key_equals_value);
+    void load_file(const std::string& path);
+    void load_string(const std::string& text);
+    std::string to_string() const;
+    std::string value_string(const Field& f) const; // name for enumerated fields, number otherwise
+    void validate() const;
+
+    bool operator==(const MachineConfig& o) const;
+    bool operator!=(const MachineConfig& o) const { return !(*this == o); }
+};
+
+#endif // MACHINECONFIG_H
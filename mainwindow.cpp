@@ -1,4 +1,5 @@
 #include "mainwindow.h"
+#include "checkpoint.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGroupBox>
@@ -6,21 +7,42 @@
 #include <QFont>
 #include <QSplitter>
 #include <QApplication>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFileDialog>
+#include <QFormLayout>
+#include <QMessageBox>
+#include <QSpinBox>
+#include <QComboBox>
+#include <QSignalBlocker>
+#include <QTextCursor>
+#include <algorithm>
+#include <climits>
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(nullptr) {
     simulator = new PipelineSimulator();
-    run_timer = new QTimer(this);
+    runner = new SimulationRunner(*simulator);
+    history = new StateHistory();
+    history->start(*simulator); runner->setHistory(history);
+    refresh_timer = new QTimer(this);
     setupUI();
     updateUI();
     connect(next_cycle_button, &QPushButton::clicked, this, &MainWindow::onNextCycleClicked);
+    connect(prev_cycle_button, &QPushButton::clicked, this, &MainWindow::onPrevCycleClicked);
+    connect(history_slider, &QSlider::valueChanged, this, &MainWindow::onHistorySliderMoved);
     connect(reset_button, &QPushButton::clicked, this, &MainWindow::onResetClicked);
     connect(load_program_button, &QPushButton::clicked, this, &MainWindow::onLoadProgramClicked);
+    connect(open_trace_button, &QPushButton::clicked, this, &MainWindow::onOpenTraceClicked);
+    connect(save_checkpoint_button, &QPushButton::clicked, this, &MainWindow::onSaveCheckpointClicked);
+    connect(load_checkpoint_button, &QPushButton::clicked, this, &MainWindow::onLoadCheckpointClicked);
+    connect(diagram_button, &QPushButton::clicked, this, &MainWindow::onDiagramClicked);
     connect(run_button, &QPushButton::clicked, this, &MainWindow::onRunClicked);
     connect(pause_button, &QPushButton::clicked, this, &MainWindow::onPauseClicked);
-    connect(run_timer, &QTimer::timeout, this, &MainWindow::onNextCycleClicked);
+    connect(config_button, &QPushButton::clicked, this, &MainWindow::onConfigureClicked);
+    connect(refresh_timer, &QTimer::timeout, this, &MainWindow::onRefreshTick);
 }
 
-MainWindow::~MainWindow() { delete simulator; }
+MainWindow::~MainWindow() { delete runner; delete diagram; delete trace_view; delete trace_reader; delete history_view; delete history; delete simulator; }
 
 void MainWindow::setupUI() {
     QWidget *centralWidget = new QWidget;
@@ -32,15 +54,45 @@ void MainWindow::setupUI() {
     QHBoxLayout *controlsLayout = new QHBoxLayout();
     cycle_label = new QLabel("Cycle: 0");
     next_cycle_button = new QPushButton("Next Cycle");
+    prev_cycle_button = new QPushButton("Previous Cycle");
+    prev_cycle_button->setEnabled(false);
+    // Rewind slider: moves through the recorded states; the rightmost is the live simulator.
+    history_slider = new QSlider(Qt::Horizontal); history_slider->setMinimumWidth(200); history_slider->setRange(0, 0);
+    history_slider->setToolTip("Scrub through the recorded cycles; the right end is the live simulation");
     run_button = new QPushButton("Run");
     pause_button = new QPushButton("Pause");
     reset_button = new QPushButton("Reset");
     load_program_button = new QPushButton("Load");
+    open_trace_button = new QPushButton("Open Trace...");
+    open_trace_button->setToolTip("Replay an event trace recorded with pipelight-cli --trace");
+    open_trace_button->setEnabled(trace_supported());
+    save_checkpoint_button = new QPushButton("Save Checkpoint...");
+    save_checkpoint_button->setToolTip("Save the complete state of the live simulation, to continue from it later");
+    load_checkpoint_button = new QPushButton("Load Checkpoint...");
+    load_checkpoint_button->setToolTip("Continue from a checkpoint saved here or with pipelight-cli --save-checkpoint");
+    diagram_button = new QPushButton("Record Diagram...");
+    diagram_button->setToolTip("Write a Konata pipeline diagram of the following cycles (or of the open trace)");
+    diagram_button->setEnabled(trace_supported());
+    config_button = new QPushButton("Machine...");
     pause_button->setEnabled(false);
+    // Run target: an empty value runs to the end of the program.
+    run_until_kind = new QComboBox(); run_until_kind->addItems({"Run until cycle", "Run until instruction address", "Run until commit count"});
+    run_until_value = new QLineEdit(); run_until_value->setPlaceholderText("(end)"); run_until_value->setMaximumWidth(110);
+    refresh_rate = new QSpinBox(); refresh_rate->setRange(1, 120); refresh_rate->setValue(30); refresh_rate->setSuffix(" Hz");
+    refresh_rate->setToolTip("How often the view shows the running simulation");
 
     controlsLayout->addWidget(cycle_label);
-    controlsLayout->addStretch();
+    controlsLayout->addWidget(history_slider, 1);
+    controlsLayout->addWidget(run_until_kind);
+    controlsLayout->addWidget(run_until_value);
+    controlsLayout->addWidget(refresh_rate);
+    controlsLayout->addWidget(config_button);
     controlsLayout->addWidget(load_program_button);
+    controlsLayout->addWidget(open_trace_button);
+    controlsLayout->addWidget(save_checkpoint_button);
+    controlsLayout->addWidget(load_checkpoint_button);
+    controlsLayout->addWidget(diagram_button);
+    controlsLayout->addWidget(prev_cycle_button);
     controlsLayout->addWidget(next_cycle_button);
     controlsLayout->addWidget(run_button);
     controlsLayout->addWidget(pause_button);
@@ -57,13 +109,22 @@ void MainWindow::setupUI() {
     program_editor = new QTextEdit();
     program_editor->setFont(QFont("Consolas", 10));
     program_editor->setPlainText("");
-    editorLayout->addWidget(program_editor);
-
-    reg_file_table = new QTableWidget(0, 2);
-    reg_file_table->setHorizontalHeaderLabels({"Register", "Value"});
-    reg_file_table->verticalHeader()->setVisible(false);
-    reg_file_table->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
-    reg_file_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    profile_gutter = new ProfileGutter(program_editor);
+    QHBoxLayout *editorRow = new QHBoxLayout(); editorRow->setSpacing(0);
+    editorRow->addWidget(profile_gutter); editorRow->addWidget(program_editor);
+    editorLayout->addLayout(editorRow);
+
+    // The tables are model-backed views; cells are formatted only when painted.
+    auto make_view = [](QAbstractItemModel* model, int stretch_column) {
+        QTableView* view = new QTableView(); view->setModel(model);
+        view->verticalHeader()->setVisible(false); view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        // Fixed row height: rows of a memory view with millions of rows are not measured one by one.
+        view->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed); view->verticalHeader()->setDefaultSectionSize(20);
+        if (stretch_column >= 0) view->horizontalHeader()->setSectionResizeMode(stretch_column, QHeaderView::Stretch);
+        return view;
+    };
+    reg_file_model = new RegisterModel(this);
+    reg_file_table = make_view(reg_file_model, 1);
     QGroupBox *regBox = new QGroupBox("Architectural Registers (ARF)");
     regBox->setFont(titleFont);
     QVBoxLayout* regLayout = new QVBoxLayout(regBox);
@@ -78,41 +139,37 @@ void MainWindow::setupUI() {
     QWidget *topRightPane = new QWidget;
     QVBoxLayout *topRightLayout = new QVBoxLayout(topRightPane);
 
-    rob_table = new QTableWidget();
-    rob_table->setColumnCount(5);
-    rob_table->setHorizontalHeaderLabels({"Entry", "Busy", "Instruction", "State", "Value/Address"});
-    rob_table->verticalHeader()->setVisible(false);
-    rob_table->horizontalHeader()->setSectionResizeMode(2, QHeaderView::Stretch);
-    rob_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    rob_model = new RobModel(this);
+    rob_table = make_view(rob_model, 2);
     QGroupBox* robBox = new QGroupBox("Reorder Buffer (ROB)"); robBox->setFont(titleFont);
     QVBoxLayout* robLayout = new QVBoxLayout(robBox); robLayout->addWidget(rob_table);
     topRightLayout->addWidget(robBox, 3);
 
     QHBoxLayout* rsLayout = new QHBoxLayout();
-    alu_rs_table = new QTableWidget(0, 7); alu_rs_table->setHorizontalHeaderLabels({"Name", "Busy", "Op", "Vj", "Vk", "Qj", "Qk"});
-    alu_rs_table->verticalHeader()->setVisible(false); alu_rs_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    alu_rs_model = new RsModel("ALU", false, this);
+    alu_rs_table = make_view(alu_rs_model, -1); alu_rs_table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
     QGroupBox* aluBox = new QGroupBox("ALU/Branch RS"); aluBox->setFont(titleFont); QVBoxLayout* aluLayout = new QVBoxLayout(aluBox); aluLayout->addWidget(alu_rs_table); rsLayout->addWidget(aluBox);
 
     // --- DÜZELTME 1: QGroupBox Başlığı ---
-    mul_rs_table = new QTableWidget(0, 7); mul_rs_table->setHorizontalHeaderLabels({"Name", "Busy", "Op", "Vj", "Vk", "Qj", "Qk"});
-    mul_rs_table->verticalHeader()->setVisible(false); mul_rs_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    mul_rs_model = new RsModel("MD", true, this);
+    mul_rs_table = make_view(mul_rs_model, -1); mul_rs_table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
     QGroupBox* mulBox = new QGroupBox("MUL/DIV RS"); mulBox->setFont(titleFont); // Başlık "MUL RS" -> "MUL/DIV RS" olarak düzeltildi
     QVBoxLayout* mulLayout = new QVBoxLayout(mulBox); mulLayout->addWidget(mul_rs_table); rsLayout->addWidget(mulBox);
 
-    lsb_table = new QTableWidget(0, 6); lsb_table->setHorizontalHeaderLabels({"Name", "Busy", "Op", "Addr Rdy", "Address", "Value Rdy"});
-    lsb_table->verticalHeader()->setVisible(false); lsb_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    lsb_model = new LsbModel(this);
+    lsb_table = make_view(lsb_model, -1);
     QGroupBox* lsbBox = new QGroupBox("Load-Store Buffer (LSB)"); lsbBox->setFont(titleFont); QVBoxLayout* lsbLayout = new QVBoxLayout(lsbBox); lsbLayout->addWidget(lsb_table); rsLayout->addWidget(lsbBox);
     topRightLayout->addLayout(rsLayout, 2);
 
     QWidget *bottomRightPane = new QWidget;
     QHBoxLayout *bottomRightLayout = new QHBoxLayout(bottomRightPane);
 
-    rat_table = new QTableWidget(0, 2); rat_table->setHorizontalHeaderLabels({"Register", "Destination"});
-    rat_table->verticalHeader()->setVisible(false); rat_table->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch); rat_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    rat_model = new RatModel(this);
+    rat_table = make_view(rat_model, 1);
     QGroupBox* ratBox = new QGroupBox("Register Alias Table (RAT)"); ratBox->setFont(titleFont); QVBoxLayout* ratLayout = new QVBoxLayout(ratBox); ratLayout->addWidget(rat_table); bottomRightLayout->addWidget(ratBox);
 
-    memory_table = new QTableWidget(0, 2); memory_table->setHorizontalHeaderLabels({"Address", "Value (Decimal)"});
-    memory_table->verticalHeader()->setVisible(false); memory_table->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch); memory_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    memory_model = new MemoryModel(this);
+    memory_table = make_view(memory_model, 1);
     QGroupBox* memBox = new QGroupBox("Data Memory"); memBox->setFont(titleFont); QVBoxLayout* memLayout = new QVBoxLayout(memBox); memLayout->addWidget(memory_table); bottomRightLayout->addWidget(memBox);
 
     QGroupBox* statsBox = new QGroupBox("Statistics"); statsBox->setFont(titleFont);
@@ -120,7 +177,19 @@ void MainWindow::setupUI() {
     ipc_label = new QLabel("IPC: 0.00");
     flush_label = new QLabel("Mispredicts: 0");
     committed_label = new QLabel("Committed Instr: 0");
-    statsLayout->addWidget(ipc_label); statsLayout->addWidget(flush_label); statsLayout->addWidget(committed_label); statsLayout->addStretch();
+    width_label = new QLabel("Issue/Commit slots used: -");
+    cache_label = new QLabel("L1D/L2: -");
+    lsq_label = new QLabel("Forwards: 0");
+    statsLayout->addWidget(ipc_label); statsLayout->addWidget(flush_label); statsLayout->addWidget(committed_label); statsLayout->addWidget(width_label);
+    statsLayout->addWidget(cache_label); statsLayout->addWidget(lsq_label);
+    const QStringList counter_rows = {"Retiring", "Bad speculation", "Frontend bound", "Backend bound (memory)", "Backend bound (core)",
+                                      "ROB occupancy", "ALU RS occupancy", "MUL/DIV RS occupancy", "LSB occupancy",
+                                      "ALU busy", "MUL/DIV busy", "Loads in flight", "CDB results/cycle",
+                                      "ALU ports", "MUL ports", "Dividers", "AGUs", "Load ports", "Store ports", "Writeback ports"};
+    counters_table = new QTableWidget(counter_rows.size(), 2); counters_table->setHorizontalHeaderLabels({"Counter", "Value"});
+    counters_table->verticalHeader()->setVisible(false); counters_table->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch); counters_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    for (int i = 0; i < counter_rows.size(); ++i) { counters_table->setItem(i, 0, new QTableWidgetItem(counter_rows[i])); counters_table->setItem(i, 1, new QTableWidgetItem("-")); }
+    statsLayout->addWidget(counters_table);
     bottomRightLayout->addWidget(statsBox);
 
     rightSplitter->addWidget(topRightPane); rightSplitter->addWidget(bottomRightPane);
@@ -133,151 +202,368 @@ void MainWindow::setupUI() {
     resize(1600, 900);
 }
 
-void MainWindow::updateUI(){
-    cycle_label->setText("Cycle: " + QString::number(simulator->cycle_count));
-
-    QColor issueColor("#fff3cd"), execColor("#d4edda"), writeColor("#cce5ff"), commitColor("#f8d7da");
-    auto colorize_row = [&](QTableWidget* table, int r, const QString& state) {
-        QColor color = table->palette().base().color();
-        if(state == "Execute") color = execColor; else if(state == "Write") color = writeColor;
-        else if(state == "Commit") color = commitColor; else if(state == "Issue") color = issueColor;
-        for(int c=0; c < table->columnCount(); ++c) {
-            if(!table->item(r, c)) table->setItem(r, c, new QTableWidgetItem(""));
-            table->item(r,c)->setBackground(color);
-        }
-    };
+void MainWindow::updateUI() {
+    const PipelineSimulator& sim = trace_view ? *trace_view : history_view ? *history_view : *simulator;
+    renderState(SimulationSnapshot::capture(sim, UINT64_MAX), sim.getMemory());
+}
 
-    // ARF
-    const auto& regs = simulator->getArchRegs();
-    reg_file_table->setRowCount(regs.gpr.size() + 1);
-    int row=0;
-    for(const auto& pair : regs.gpr) {
-        reg_file_table->setItem(row, 0, new QTableWidgetItem(QString::fromStdString(pair.first)));
-        reg_file_table->setItem(row, 1, new QTableWidgetItem(QString::number(pair.second)));
-        row++;
-    }
-    QString flags = QString("Z:%1 S:%2 O:%3").arg(regs.ZF).arg(regs.SF).arg(regs.OF);
-    reg_file_table->setItem(row, 0, new QTableWidgetItem("FLAGS"));
-    reg_file_table->setItem(row, 1, new QTableWidgetItem(flags));
-
-    const auto& rob = simulator->getROB();
-    rob_table->setRowCount(rob.size());
-    for(size_t i = 0; i < rob.size(); ++i) {
-        QString entry = "ROB" + QString::number(i);
-        if(i == simulator->rob_head_q) entry.append(" (H)");
-        if(i == simulator->rob_tail_q && rob[i].busy) entry.append(" (T)");
-
-        rob_table->setItem(i, 0, new QTableWidgetItem(entry));
-        rob_table->setItem(i, 1, new QTableWidgetItem(rob[i].busy ? "Yes" : ""));
-
-        if (rob[i].busy) {
-            rob_table->setItem(i, 2, new QTableWidgetItem(QString::fromStdString(rob[i].instruction.original_text)));
-            rob_table->setItem(i, 3, new QTableWidgetItem(QString::fromStdString(rob[i].state)));
-            QString value_str = rob[i].ready ? ((rob[i].instruction.mnemonic == "STORE") ? "Addr:" + QString::number(rob[i].address_result) : QString::number(rob[i].value)) : "";
-            rob_table->setItem(i, 4, new QTableWidgetItem(value_str));
-            colorize_row(rob_table, i, QString::fromStdString(rob[i].state));
-        } else {
-            for (int j = 2; j < rob_table->columnCount(); ++j) rob_table->setItem(i, j, new QTableWidgetItem(""));
-            colorize_row(rob_table, i, "Empty");
-        }
-    }
+void MainWindow::renderState(const SimulationSnapshot& s, const PagedMemory& memory) {
+    cycle_label->setText("Cycle: " + QString::number(s.cycle_count) + run_status);
 
-    auto update_rs_table = [&](QTableWidget* table, const auto& rs_vector, const QString& prefix){
-        table->setRowCount(rs_vector.size());
-        for(size_t i = 0; i < rs_vector.size(); ++i) {
-            const auto& rs = rs_vector[i];
-            table->setItem(i, 0, new QTableWidgetItem(prefix + QString::number(i)));
-            table->setItem(i, 1, new QTableWidgetItem(rs.busy ? "Yes" : ""));
-            if (rs.busy) {
-                table->setItem(i, 2, new QTableWidgetItem(QString::fromStdString(rs.op)));
-                table->setItem(i, 3, new QTableWidgetItem(rs.Qj == -1 ? QString::number(rs.Vj) : ""));
-                table->setItem(i, 4, new QTableWidgetItem(rs.Qk == -1 ? QString::number(rs.Vk) : ""));
-                table->setItem(i, 5, new QTableWidgetItem(rs.Qj != -1 ? "ROB" + QString::number(rs.Qj) : ""));
-                table->setItem(i, 6, new QTableWidgetItem(rs.Qk != -1 ? "ROB" + QString::number(rs.Qk) : ""));
-                if(rob[rs.dest_rob_index].state == "Execute") colorize_row(table, i, "Execute"); else colorize_row(table, i, "Issue");
-            } else { for (int j = 2; j < table->columnCount(); ++j) table->setItem(i, j, new QTableWidgetItem("")); colorize_row(table, i, "Empty"); }
-        }
-        table->resizeColumnsToContents();
-    };
-    update_rs_table(alu_rs_table, simulator->getAluRS(), "ALU");
-
-    update_rs_table(mul_rs_table, simulator->getMulDivRS(), "MD"); // 'getMulRS' -> 'getMulDivRS' olarak düzeltildi
-
-    // LSB
-    const auto& lsb = simulator->getLSB();
-    lsb_table->setRowCount(lsb.size());
-    for(size_t i=0; i < lsb.size(); ++i) {
-        lsb_table->setItem(i, 0, new QTableWidgetItem("LSB"+QString::number(i)));
-        lsb_table->setItem(i, 1, new QTableWidgetItem(lsb[i].busy ? "Yes" : ""));
-        if(lsb[i].busy) {
-            lsb_table->setItem(i, 2, new QTableWidgetItem(QString::fromStdString(lsb[i].op)));
-            bool addr_rdy = lsb[i].address_ready;
-            lsb_table->setItem(i, 3, new QTableWidgetItem(addr_rdy ? "Rdy":"No"));
-            lsb_table->setItem(i, 4, new QTableWidgetItem(addr_rdy ? QString::number(lsb[i].address):""));
-            lsb_table->setItem(i, 5, new QTableWidgetItem(lsb[i].Qs == -1 ? "Rdy" : "ROB"+QString::number(lsb[i].Qs)));
-            if(rob[lsb[i].dest_rob_index].state == "Execute") colorize_row(lsb_table, i, "Execute"); else colorize_row(lsb_table, i, "Issue");
-        } else { for (int j = 2; j < lsb_table->columnCount(); ++j) lsb_table->setItem(i, j, new QTableWidgetItem("")); colorize_row(lsb_table, i, "Empty"); }
+    // The models report the rows changed since the previous refresh; the views repaint only those.
+    reg_file_model->refresh(s);
+    rob_model->refresh(s);
+    alu_rs_model->refresh(s); mul_rs_model->refresh(s);
+    lsb_model->refresh(s);
+    rat_model->refresh(s);
+    memory_model->refresh(memory);
+
+    // Stats
+    double ipc = (s.cycle_count > 0) ? (double)s.committed_ins_count / s.cycle_count : 0.0;
+    ipc_label->setText(QString("IPC: %1").arg(ipc, 0, 'f', 2));
+    committed_label->setText("Committed Instr: " + QString::number(s.committed_ins_count));
+    flush_label->setText(QString("Mispredicts: %1 (%2, %3% correct, avg penalty %4 cycles)").arg(s.mispredict_count)
+                         .arg(s.predictor).arg(100.0 * s.predictor_accuracy, 0, 'f', 1).arg(s.mispredict_penalty, 0, 'f', 1));
+    const WidthStats& ws = s.width; const MachineConfig& mc = s.program->getConfig();
+    if (s.cycle_count > 0) {
+        double issue_util = 100.0 * ws.issue_slots_used / (double(s.cycle_count) * mc.issue_width);
+        double commit_util = 100.0 * ws.commit_slots_used / (double(s.cycle_count) * mc.commit_width);
+        width_label->setText(QString("Issue/Commit slots used: %1% / %2%").arg(issue_util, 0, 'f', 1).arg(commit_util, 0, 'f', 1));
+    } else { width_label->setText("Issue/Commit slots used: -"); }
+    if (s.caches) {
+        cache_label->setText(QString("L1D hits %1/%2, L2 hits %3/%4, prefetch %5 (%6% accurate)").arg(s.l1d.hits).arg(s.l1d.accesses)
+                             .arg(s.l2.hits).arg(s.l2.accesses).arg(s.prefetcher).arg(100.0 * s.prefetch_accuracy, 0, 'f', 1));
+    } else { cache_label->setText("L1D/L2: ideal memory"); }
+    const LsqStats& q = s.lsq;
+    lsq_label->setText(QString("Forwards: %1, violations: %2 (%3 uops replayed)").arg(q.forwards).arg(q.violations).arg(q.replayed_uops));
+    // Counter table: the rows are fixed, only the value column is updated.
+    const TopDown& td = s.top_down; const PipelineStats& ps = s.pipeline;
+    const double cycles = s.cycle_count ? double(s.cycle_count) : 1.0;
+    auto percent = [](double f) { return QString("%1%").arg(100.0 * f, 0, 'f', 1); };
+    auto occupancy = [&](Structure s) { const OccupancyHistogram& h = ps.of(s);
+        return QString("%1 / %2 (full %3)").arg(h.mean(), 0, 'f', 2).arg(h.cycles.size() - 1).arg(percent(h.full_fraction())); };
+    auto busy = [&](FuClass c) { const FuUsage& u = ps.of(c);
+        return QString("%1 (avg %2 ops)").arg(percent(u.busy_cycles / cycles)).arg(u.busy_cycles ? double(u.op_cycles) / u.busy_cycles : 0.0, 0, 'f', 2); };
+    auto port = [&](Port p) { const PortUsage& u = ps.of(p);
+        if (!u.units) return QString("unlimited (avg %1 busy)").arg(u.busy.mean(), 0, 'f', 2);
+        return QString("%1 of %2 (saturated %3, %4 waits)").arg(percent(u.mean_utilization())).arg(u.units).arg(percent(u.saturated_fraction())).arg(u.waits); };
+    QStringList counter_values = {percent(td.fraction(td.retiring)), percent(td.fraction(td.bad_speculation)), percent(td.fraction(td.frontend_bound)),
+                                        percent(td.fraction(td.backend_memory)), percent(td.fraction(td.backend_core)),
+                                        occupancy(Structure::Rob), occupancy(Structure::AluRs), occupancy(Structure::MulDivRs), occupancy(Structure::Lsb),
+                                        busy(FuClass::Alu), busy(FuClass::MulDiv), busy(FuClass::Memory),
+                                        QString::number(ws.cdb_results / cycles, 'f', 2)};
+    for (int i = 0; i < static_cast<int>(Port::Count); ++i) counter_values << port(static_cast<Port>(i));
+    for (int i = 0; i < counter_values.size(); ++i) counters_table->item(i, 1)->setText(counter_values[i]);
+    profile_gutter->setProfile(s);
+    if (s.finished && !runner->running() && !history_view) { run_button->setEnabled(false); next_cycle_button->setEnabled(false); pause_button->setEnabled(false); }
+}
+
+
+void MainWindow::onNextCycleClicked() {
+    if (runner->running()) return;
+    if (trace_view) { showTraceCycle(trace_view->cycle_count + 1); return; }
+    if (history_view) { showHistoryState(history_position + 1); return; }
+    if (simulator->is_finished()) return;
+    simulator->step(); history->record(*simulator);
+    run_status.clear(); syncHistorySlider(); updateUI();
+}
+
+void MainWindow::onPrevCycleClicked() {
+    if (runner->running()) return;
+    if (trace_view) { if (trace_view->cycle_count > trace_reader->firstCycle()) showTraceCycle(trace_view->cycle_count - 1); return; }
+    size_t current = history_view ? history_position : history->states() - 1;
+    if (current > 0) showHistoryState(current - 1);
+}
+
+void MainWindow::onHistorySliderMoved(int state) {
+    if (trace_view) showTraceCycle(trace_reader->firstCycle() + static_cast<uint64_t>(state));
+    else if (!runner->running()) showHistoryState(static_cast<size_t>(state));
+}
+
+// Shows recorded state `state` in a rewound copy of the simulator; the newest state is the live one.
+void MainWindow::showHistoryState(size_t state) {
+    const size_t newest = history->states() - 1;
+    if (state >= newest) { leaveHistory(); syncHistorySlider(); updateUI(); return; }
+    if (!history_view) {
+        history_view = new PipelineSimulator(*simulator); history_position = newest;
+        memory_model->invalidate(); // the copy's memory versions continue independently
     }
+    history->seek(*history_view, history_position, state);
+    run_status = QString(" (rewound, newest cycle %1)").arg(history->cycleOf(newest));
+    syncHistorySlider(); updateUI();
+    next_cycle_button->setEnabled(true);
+}
+
+void MainWindow::leaveHistory() {
+    if (!history_view) return;
+    PipelineSimulator* view = history_view; history_view = nullptr;
+    memory_model->invalidate(); run_status.clear();
+    updateUI(); // models let go of the view before it is deleted
+    delete view;
+    bool done = simulator->is_finished();
+    next_cycle_button->setEnabled(!done); run_button->setEnabled(!done);
+}
+
+// After the simulator was reloaded, reset or reconfigured: the old states no longer apply.
+void MainWindow::restartHistory() {
+    leaveHistory();
+    history->start(*simulator); syncHistorySlider();
+}
 
-    // RAT
-    const auto& rat = simulator->getRAT();
-    rat_table->setRowCount(rat.size()); row=0;
-    for(const auto& pair : rat) {
-        rat_table->setItem(row, 0, new QTableWidgetItem(QString::fromStdString(pair.first)));
-        QString dest = pair.second.is_rob ? "ROB" + QString::number(pair.second.rob_index) : "ARF";
-        rat_table->setItem(row, 1, new QTableWidgetItem(dest)); row++;
+void MainWindow::syncHistorySlider() {
+    QSignalBlocker block(history_slider);
+    if (trace_view) { // the slider shows the cycles in the trace
+        const uint64_t first = trace_reader->firstCycle(), span = trace_reader->lastCycle() - first;
+        history_slider->setRange(0, static_cast<int>(std::min<uint64_t>(span, INT_MAX)));
+        history_slider->setValue(static_cast<int>(std::min<uint64_t>(trace_view->cycle_count - first, INT_MAX)));
+        prev_cycle_button->setEnabled(trace_view->cycle_count > first);
+        return;
     }
+    const size_t newest = history->states() - 1;
+    history_slider->setRange(0, static_cast<int>(newest));
+    history_slider->setValue(static_cast<int>(history_view ? history_position : newest));
+    prev_cycle_button->setEnabled(!runner->running() && (history_view ? history_position : newest) > 0);
+}
+
+// Replays a trace file: the tables show the recorded run at any cycle, rebuilt from the nearest keyframe.
+void MainWindow::onOpenTraceClicked() {
+    if (runner->running()) return;
+    QString path = QFileDialog::getOpenFileName(this, "Open Event Trace");
+    if (path.isEmpty()) return;
+    TraceReader* reader = nullptr; PipelineSimulator* view = nullptr;
+    try { reader = new TraceReader(path.toStdString()); view = reader->makeView().release(); }
+    catch (const std::exception& e) { delete reader; QMessageBox::warning(this, "Open Trace", e.what()); return; }
+    leaveHistory(); closeTrace(); stopDiagram();
+    trace_reader = reader; trace_view = view;
+    memory_model->invalidate();
+    program_editor->setPlainText(QString::fromStdString(reader->program()));
+    run_status = QString(" (trace, cycles %1-%2)").arg(reader->firstCycle()).arg(reader->lastCycle());
+    next_cycle_button->setEnabled(true); run_button->setEnabled(true); config_button->setEnabled(false);
+    save_checkpoint_button->setEnabled(false); // a replayed cycle has only what the tables show
+    syncHistorySlider(); updateUI();
+}
 
-    // Memory
-    const auto& mem = simulator->getMemory();
-    memory_table->setRowCount(mem.size()); row = 0;
-    std::vector<std::pair<int64_t, int64_t>> sorted_mem(mem.begin(), mem.end());
-    std::sort(sorted_mem.begin(), sorted_mem.end());
-    for(const auto& pair : sorted_mem) {
-        memory_table->setItem(row, 0, new QTableWidgetItem(QString::number(pair.first)));
-        memory_table->setItem(row, 1, new QTableWidgetItem(QString::number(pair.second))); row++;
+// Saves the live simulator; a rewound copy lacks the predictor, cache and statistics state, so the view
+// returns to the newest cycle first.
+void MainWindow::onSaveCheckpointClicked() {
+    if (runner->running() || trace_view) return;
+    QString path = QFileDialog::getSaveFileName(this, "Save Checkpoint", QString(), "Checkpoints (*.ckpt);;All files (*)");
+    if (path.isEmpty()) return;
+    leaveHistory(); syncHistorySlider();
+    try { save_checkpoint(*simulator, path.toStdString()); }
+    catch (const std::exception& e) { QMessageBox::warning(this, "Save Checkpoint", e.what()); }
+}
+
+// Replaces the machine configuration, program and state with the checkpoint's; stepping on is identical
+// to continuing the run that saved it.
+void MainWindow::onLoadCheckpointClicked() {
+    if (runner->running()) return;
+    QString path = QFileDialog::getOpenFileName(this, "Load Checkpoint", QString(), "Checkpoints (*.ckpt);;All files (*)");
+    if (path.isEmpty()) return;
+    leaveHistory(); closeTrace(); stopDiagram();
+    memory_model->invalidate();
+    try { load_checkpoint(*simulator, path.toStdString()); program_editor->setPlainText(QString::fromStdString(simulator->programSource())); }
+    catch (const std::exception& e) { QMessageBox::warning(this, "Load Checkpoint", e.what()); }
+    restartHistory();
+    run_status.clear(); updateUI();
+    bool done = simulator->is_finished();
+    next_cycle_button->setEnabled(!done); run_button->setEnabled(!done); pause_button->setEnabled(false);
+}
+
+// Live: starts or stops streaming the simulator's cycles to a Kanata log. With a trace open: converts
+// the whole trace.
+void MainWindow::onDiagramClicked() {
+    if (runner->running()) return;
+    if (diagram) { stopDiagram(); return; }
+    QString path = QFileDialog::getSaveFileName(this, "Pipeline Diagram (Kanata Log)", QString(), "Kanata logs (*.log);;All files (*)");
+    if (path.isEmpty()) return;
+    try {
+        if (trace_view) {
+            KanataWriter writer(path.toStdString());
+            writer.beginReplay(*trace_view, trace_reader->firstCycle()); trace_reader->replay(writer); writer.finish();
+            QMessageBox::information(this, "Pipeline Diagram", QString("Wrote %1 micro-ops.").arg(writer.rows()));
+            return;
+        }
+        leaveHistory();
+        diagram = new KanataWriter(path.toStdString()); diagram->begin(*simulator);
     }
+    catch (const std::exception& e) { QMessageBox::warning(this, "Pipeline Diagram", e.what()); return; }
+    diagram_button->setText("Stop Diagram");
+}
 
-    // Stats
-    double ipc = (simulator->cycle_count > 0) ? (double)simulator->committed_ins_count / simulator->cycle_count : 0.0;
-    ipc_label->setText(QString("IPC: %1").arg(ipc, 0, 'f', 2));
-    committed_label->setText("Committed Instr: " + QString::number(simulator->committed_ins_count));
-    flush_label->setText("Mispredicts: " + QString::number(simulator->mispredict_count));
-    if(simulator->is_finished()) { run_timer->stop(); run_button->setEnabled(false); next_cycle_button->setEnabled(false); pause_button->setEnabled(false); }
-    qApp->processEvents();
+void MainWindow::stopDiagram() {
+    if (!diagram) return;
+    delete diagram; diagram = nullptr; // finish()es the file
+    diagram_button->setText("Record Diagram...");
 }
 
+void MainWindow::showTraceCycle(uint64_t cycle) {
+    cycle = std::min(std::max(cycle, trace_reader->firstCycle()), trace_reader->lastCycle());
+    trace_reader->seek(*trace_view, cycle);
+    next_cycle_button->setEnabled(cycle < trace_reader->lastCycle());
+    syncHistorySlider(); updateUI();
+}
 
-void MainWindow::onNextCycleClicked() {
-    if (simulator->is_finished()) return; simulator->step(); updateUI();
+void MainWindow::closeTrace() {
+    if (!trace_view) return;
+    PipelineSimulator* view = trace_view; trace_view = nullptr;
+    memory_model->invalidate(); run_status.clear();
+    updateUI(); // models let go of the view before it is deleted
+    delete view; delete trace_reader; trace_reader = nullptr;
+    config_button->setEnabled(true); save_checkpoint_button->setEnabled(true);
+    syncHistorySlider();
 }
 
 void MainWindow::onLoadProgramClicked() {
-    run_timer->stop();
+    stopRunner(); leaveHistory(); closeTrace(); stopDiagram();
+    memory_model->invalidate();
+    program_editor->setExtraSelections({});
     try { simulator->parse_and_load_program(program_editor->toPlainText().toStdString()); }
-    catch (const std::exception& e) { program_editor->setPlainText(QString("PARSING ERROR:\n") + e.what()); }
-    updateUI(); next_cycle_button->setEnabled(true); run_button->setEnabled(true);
+    catch (const AssemblyError& e) { showAssemblyErrors(e); }
+    restartHistory();
+    run_status.clear(); updateUI(); next_cycle_button->setEnabled(true); run_button->setEnabled(true);
     pause_button->setEnabled(false); load_program_button->setEnabled(true); reset_button->setEnabled(true);
 }
 
+// Marks every line with an error (the message is its tooltip) and puts the cursor on the first one;
+// the program text stays as the user wrote it.
+void MainWindow::showAssemblyErrors(const AssemblyError& e) {
+    QList<QTextEdit::ExtraSelection> marks;
+    for (const AssemblyDiagnostic& d : e.diagnostics()) {
+        QTextEdit::ExtraSelection mark; mark.cursor = QTextCursor(program_editor->document()->findBlockByNumber(d.line - 1));
+        mark.format.setBackground(QColor(255, 215, 215)); mark.format.setProperty(QTextFormat::FullWidthSelection, true);
+        mark.format.setToolTip(QString::fromStdString(d.message));
+        marks.append(mark);
+    }
+    program_editor->setExtraSelections(marks);
+    const AssemblyDiagnostic& first = e.diagnostics().front();
+    QTextCursor cursor(program_editor->document()->findBlockByNumber(first.line - 1));
+    cursor.movePosition(QTextCursor::Right, QTextCursor::MoveAnchor, first.column - 1);
+    program_editor->setTextCursor(cursor); program_editor->setFocus();
+    QMessageBox::warning(this, QString("Assembly: %1 error(s)").arg(e.diagnostics().size()), e.what());
+}
+
 void MainWindow::onResetClicked() {
-    run_timer->stop();
-    simulator->reset();
-    program_editor->setPlainText("");
-    updateUI();
+    stopRunner(); leaveHistory(); closeTrace(); stopDiagram();
+    simulator->reset(); memory_model->invalidate(); restartHistory();
+    program_editor->setPlainText(""); program_editor->setExtraSelections({});
+    run_status.clear(); updateUI();
     next_cycle_button->setEnabled(true); run_button->setEnabled(true); pause_button->setEnabled(false);
 }
 
 void MainWindow::onRunClicked() {
+    if (runner->running()) return;
+    QString text = run_until_value->text().trimmed();
+    bool ok = false; qlonglong v = text.toLongLong(&ok, 0);
+    if (!text.isEmpty() && (!ok || v < 0)) { QMessageBox::warning(this, "Run", "Not a valid number: " + text); return; }
+    if (trace_view) { // in a trace, "run" jumps to the target cycle (or the end)
+        showTraceCycle(!text.isEmpty() && run_until_kind->currentIndex() == 0 ? static_cast<uint64_t>(v) : trace_reader->lastCycle());
+        return;
+    }
+    leaveHistory(); // a run always continues from the newest state
     if (simulator->is_finished()) return;
+    RunBreakpoints bp;
+    if (!text.isEmpty()) {
+        switch (run_until_kind->currentIndex()) {
+        case 0: bp.cycle = static_cast<uint64_t>(v); break;
+        case 1: bp.address = v; break;
+        default: bp.commits = static_cast<uint64_t>(v); break;
+        }
+    }
     run_button->setEnabled(false); pause_button->setEnabled(true);
     next_cycle_button->setEnabled(false); reset_button->setEnabled(false);
-    load_program_button->setEnabled(false); run_timer->start(50); // Hız artırıldı
+    load_program_button->setEnabled(false); open_trace_button->setEnabled(false); config_button->setEnabled(false);
+    diagram_button->setEnabled(false); save_checkpoint_button->setEnabled(false); load_checkpoint_button->setEnabled(false);
+    prev_cycle_button->setEnabled(false); history_slider->setEnabled(false);
+    runner->setSnapshotRate(refresh_rate->value());
+    runner->run(bp);
+    refresh_timer->start(1000 / refresh_rate->value());
 }
 
 void MainWindow::onPauseClicked() {
-    run_timer->stop();
-    run_button->setEnabled(true); pause_button->setEnabled(false);
-    if (!simulator->is_finished()) { next_cycle_button->setEnabled(true); }
-    reset_button->setEnabled(true); load_program_button->setEnabled(true);
+    runner->pause(); // the worker stops; its last snapshot is rendered in onRefreshTick
+    onRefreshTick();
+}
+
+// Renders the newest snapshot, if any; once the worker has stopped, switches back to the live simulator.
+void MainWindow::onRefreshTick() {
+    if (auto snap = runner->latest(snapshot_seen)) {
+        snapshot_seen = snap->serial;
+        run_status = QString(" (%1 Mcycles/s)").arg(snap->cycles_per_second / 1e6, 0, 'f', 2);
+        if (snap->stop == StopReason::None) {
+            if (snap->memory_since == 0) shown_memory.clear(); // the run's first snapshot carries every page
+            shown_memory.apply_pages(snap->pages, snap->memory_version);
+            renderState(*snap, shown_memory);
+        }
+        else { refresh_timer->stop(); runStopped(snap->stop); }
+    }
+}
+
+// Stops the worker without rendering its last snapshot (the caller is about to replace the state).
+void MainWindow::stopRunner() {
+    runner->pause(); refresh_timer->stop();
+    if (auto snap = runner->latest(snapshot_seen)) snapshot_seen = snap->serial;
+}
+
+void MainWindow::runStopped(StopReason reason) {
+    runner->pause(); // the worker is past its last snapshot; join it before reading the history it recorded
+    run_status = QString(" (%1)").arg(stop_reason_name(reason));
+    history_slider->setEnabled(true); syncHistorySlider();
+    updateUI(); shown_memory.clear(); // the views show the simulator's own memory again
+    bool done = simulator->is_finished();
+    run_button->setEnabled(!done); next_cycle_button->setEnabled(!done); pause_button->setEnabled(false);
+    reset_button->setEnabled(true); load_program_button->setEnabled(true); open_trace_button->setEnabled(trace_supported()); config_button->setEnabled(true);
+    diagram_button->setEnabled(trace_supported()); save_checkpoint_button->setEnabled(true); load_checkpoint_button->setEnabled(true);
+}
+
+void MainWindow::onConfigureClicked() {
+    if (runner->running()) return;
+    leaveHistory();
+    QDialog dialog(this);
+    dialog.setWindowTitle("Machine Configuration");
+    QFormLayout* form = new QFormLayout(&dialog);
+    const auto& fields = MachineConfig::fields();
+    // Numeric fields are edited with a QSpinBox, named ones (e.g. predictor) with a QComboBox; in both, value = index.
+    std::vector<QSpinBox*> boxes; std::vector<QComboBox*> combos;
+    auto show_config = [&](const MachineConfig& cfg) {
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (combos[i]) combos[i]->setCurrentIndex(cfg.*(fields[i].member)); else boxes[i]->setValue(cfg.*(fields[i].member));
+        }
+    };
+    for (const auto& f : fields) {
+        QSpinBox* box = nullptr; QComboBox* combo = nullptr;
+        if (f.names) {
+            combo = new QComboBox(&dialog);
+            for (int v = 0; f.names[v]; ++v) combo->addItem(f.names[v]);
+            combo->setToolTip(f.help); form->addRow(f.key, combo);
+        } else {
+            box = new QSpinBox(&dialog);
+            box->setRange(f.min_value, f.max_value); box->setToolTip(f.help);
+            form->addRow(f.key, box);
+        }
+        boxes.push_back(box); combos.push_back(combo);
+    }
+    show_config(simulator->getConfig());
+
+    QPushButton* load_file_button = new QPushButton("Load File...", &dialog);
+    form->addRow(load_file_button);
+    connect(load_file_button, &QPushButton::clicked, &dialog, [&]() {
+        QString path = QFileDialog::getOpenFileName(&dialog, "Load Machine Configuration");
+        if (path.isEmpty()) return;
+        MachineConfig cfg;
+        try { cfg.load_file(path.toStdString()); show_config(cfg); }
+        catch (const std::exception& e) { QMessageBox::warning(&dialog, "Configuration Error", e.what()); }
+    });
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    form->addRow(buttons);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    if (dialog.exec() != QDialog::Accepted) return;
+
+    MachineConfig cfg = simulator->getConfig();
+    for (size_t i = 0; i < fields.size(); ++i) cfg.*(fields[i].member) = combos[i] ? combos[i]->currentIndex() : boxes[i]->value();
+    memory_model->invalidate(); stopDiagram();
+    try { simulator->setConfig(cfg); }
+    catch (const std::exception& e) { QMessageBox::warning(this, "Configuration Error", e.what()); return; }
+    onLoadProgramClicked(); // Reload the program with the new configuration
 }
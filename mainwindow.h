@@ -4,10 +4,23 @@
 #include <QMainWindow>
 #include <QLabel>
 #include <QPushButton>
+#include <QTableView>
 #include <QTableWidget>
 #include <QTimer>
+#include <QComboBox>
+#include <QLineEdit>
+#include <QSpinBox>
+#include <QSlider>
+#include <memory>
 #include <QTextEdit>
 #include "pipelinesimulator.h"
+#include "profilegutter.h"
+#include "pipelinemodels.h"
+#include "simulationrunner.h"
+#include "statehistory.h"
+#include "eventtrace.h"
+#include "kanatawriter.h"
+#include "assembler.h"
 #include <map>
 #include <string>
 
@@ -25,39 +38,90 @@ public:
 
 private slots:
     void onNextCycleClicked();
+    void onPrevCycleClicked();
+    void onHistorySliderMoved(int state);
     void onRunClicked();
     void onPauseClicked();
     void onResetClicked();
     void onLoadProgramClicked();
+    void onOpenTraceClicked();
+    void onSaveCheckpointClicked();
+    void onLoadCheckpointClicked();
+    void onDiagramClicked();
+    void onConfigureClicked();
+    void onRefreshTick();
 
 private:
     void setupUI();
-    void updateUI();
+    void updateUI(); // from the live simulator (or the rewound view); only while the runner is stopped
+    void renderState(const SimulationSnapshot& s, const PagedMemory& memory);
+    void runStopped(StopReason reason);
+    void stopRunner();
+    void showHistoryState(size_t state);
+    void leaveHistory();
+    void restartHistory();
+    void syncHistorySlider();
+    void showTraceCycle(uint64_t cycle);
+    void closeTrace();
+    void stopDiagram();
+    void showAssemblyErrors(const AssemblyError& e);
 
     Ui::MainWindow *ui;
     PipelineSimulator* simulator;
+    SimulationRunner* runner;
+    StateHistory* history;
+    PipelineSimulator* history_view = nullptr; // rewound copy shown instead of the simulator, null when live
+    size_t history_position = 0;
+    TraceReader* trace_reader = nullptr;   // open event trace; while set the views replay it instead of simulating
+    PipelineSimulator* trace_view = nullptr;
+    KanataWriter* diagram = nullptr;       // Konata pipeline diagram being recorded from the live simulator
+    PagedMemory shown_memory; // the running machine's memory, rebuilt from the snapshots' dirty pages
+    uint64_t snapshot_seen = 0;
+    QString run_status;
 
     QLabel* cycle_label;
     QPushButton* next_cycle_button;
+    QPushButton* prev_cycle_button;
+    QSlider* history_slider; // cycle scrubber over the recorded states
     QPushButton* run_button;
     QPushButton* pause_button;
     QPushButton* reset_button;
     QPushButton* load_program_button;
+    QPushButton* open_trace_button;
+    QPushButton* save_checkpoint_button;
+    QPushButton* load_checkpoint_button;
+    QPushButton* diagram_button;
+    QPushButton* config_button;
+    QComboBox* run_until_kind;
+    QLineEdit* run_until_value;
+    QSpinBox* refresh_rate;
 
     QTextEdit* program_editor;
+    ProfileGutter* profile_gutter;
 
-    QTableWidget* rob_table;
-    QTableWidget* alu_rs_table;
-    QTableWidget* mul_rs_table;
-    QTableWidget* lsb_table;
-    QTableWidget* rat_table;
-    QTableWidget* reg_file_table;
-    QTableWidget* memory_table;
+    QTableView* rob_table;
+    QTableView* alu_rs_table;
+    QTableView* mul_rs_table;
+    QTableView* lsb_table;
+    QTableView* rat_table;
+    QTableView* reg_file_table;
+    QTableView* memory_table;
+    RobModel* rob_model;
+    RsModel* alu_rs_model;
+    RsModel* mul_rs_model;
+    LsbModel* lsb_model;
+    RatModel* rat_model;
+    RegisterModel* reg_file_model;
+    MemoryModel* memory_model;
 
     QLabel* ipc_label;
     QLabel* flush_label;
     QLabel* committed_label;
+    QLabel* width_label;
+    QLabel* cache_label;
+    QLabel* lsq_label;
+    QTableWidget* counters_table; // top-down breakdown and utilization counters, fixed rows
 
-    QTimer* run_timer;
+    QTimer* refresh_timer; // polls the runner's snapshots while it runs
 };
 #endif // MAINWINDOW_H
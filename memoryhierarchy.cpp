@@ -0,0 +1,219 @@
+#include "memoryhierarchy.h"
+#include "checkpoint.h"
+#include <algorithm>
+
+CacheLevel::CacheLevel(int size_bytes, int assoc, int line_bytes, int latency, int mshrs, WritePolicy policy)
+    : latency_(latency), policy_(policy) {
+    uint64_t lines = static_cast<uint64_t>(size_bytes) / line_bytes;
+    ways_ = static_cast<int>(std::min<uint64_t>(assoc, lines));
+    sets_ = lines / ways_;
+    lines_.assign(sets_ * ways_, Line());
+    mshrs_.assign(mshrs, Mshr());
+}
+
+CacheLevel::Line* CacheLevel::find(uint64_t line) {
+    Line* set = &lines_[(line % sets_) * ways_];
+    for (int w = 0; w < ways_; ++w) if (set[w].valid && set[w].line == line) return &set[w];
+    return nullptr;
+}
+
+bool CacheLevel::fill(uint64_t line, bool dirty, bool prefetched, uint64_t& victim) {
+    Line* set = &lines_[(line % sets_) * ways_]; Line* v = set;
+    for (int w = 0; w < ways_; ++w) {
+        if (!set[w].valid) { v = &set[w]; break; }
+        if (set[w].lru < v->lru) v = &set[w];
+    }
+    bool writeback = v->valid && v->dirty; victim = v->line;
+    *v = {line, ++clock_, true, dirty, prefetched};
+    return writeback;
+}
+
+// An MSHR is busy up to and including its ready cycle; it is free once ready < now.
+CacheLevel::Mshr* CacheLevel::find_mshr(uint64_t line, uint64_t now) {
+    for (auto& m : mshrs_) if (m.ready >= now && m.line == line) return &m;
+    return nullptr;
+}
+
+bool CacheLevel::mshr_available(uint64_t now) const {
+    for (const auto& m : mshrs_) if (m.ready < now) return true;
+    return false;
+}
+
+void CacheLevel::allocate_mshr(uint64_t line, uint64_t ready, bool prefetch, uint64_t now) {
+    for (auto& m : mshrs_) if (m.ready < now) { m = {line, ready, prefetch}; return; }
+    // Posted stores may find every MSHR busy; their fill is then simply not tracked.
+}
+
+uint64_t CacheLevel::next_mshr_free(uint64_t now) const {
+    uint64_t t = UINT64_MAX;
+    for (const auto& m : mshrs_) if (m.ready >= now) t = std::min(t, m.ready + 1);
+    return t;
+}
+
+void CacheLevel::checkpoint(CheckpointIO& io) { io.vec(lines_, true); io.vec(mshrs_, true); io.pod(clock_); io.pod(counters); }
+
+MemoryHierarchy::MemoryHierarchy(const MachineConfig& c)
+    : mem_latency_(c.mem_latency), prefetch_degree_(c.prefetch_degree), prefetcher_(static_cast<PrefetcherKind>(c.prefetcher)) {
+    line_shift_ = 0; while ((1 << line_shift_) < c.line_size) line_shift_++;
+    if (c.l1d_size > 0) l1_ = CacheLevel(c.l1d_size * 1024, c.l1d_assoc, c.line_size, c.l1d_latency, c.l1d_mshrs, static_cast<WritePolicy>(c.l1d_write_policy));
+    if (c.l1d_size > 0 && c.l2_size > 0) l2_ = CacheLevel(c.l2_size * 1024, c.l2_assoc, c.line_size, c.l2_latency, c.l2_mshrs, static_cast<WritePolicy>(c.l2_write_policy));
+    if (prefetcher_ == PrefetcherKind::Stride) stride_table_.assign(256, StrideEntry());
+}
+
+void MemoryHierarchy::checkpoint(CheckpointIO& io) {
+    l1_.checkpoint(io); l2_.checkpoint(io);
+    io.vec(stride_table_, true); io.pod(prefetch_); io.pod(mem_reads_); io.pod(mem_writes_);
+}
+
+const char* MemoryHierarchy::prefetcher_name() const {
+    switch (prefetcher_) {
+    case PrefetcherKind::NextLine: return "nextline";
+    case PrefetcherKind::Stride: return "stride";
+    default: return "none";
+    }
+}
+
+bool MemoryHierarchy::load(uint64_t pc, int64_t address, uint64_t now, uint64_t& ready_cycle, bool count_reject) {
+    if (!enabled()) { ready_cycle = now; return true; }
+    const uint64_t line = line_of(address); auto& c = l1_.counters;
+    if (CacheLevel::Mshr* m = l1_.find_mshr(line, now)) {
+        c.accesses++; c.mshr_merges++;
+        bool was_prefetch = m->prefetch;
+        if (was_prefetch) {
+            prefetch_.useful++; prefetch_.late++; m->prefetch = false;
+            if (CacheLevel::Line* l = l1_.find(line)) l->prefetched = false;
+        }
+        ready_cycle = std::max(m->ready, now + l1_.latency() - 1);
+        train_prefetcher(pc, address, was_prefetch, now);
+        return true;
+    }
+    if (CacheLevel::Line* l = l1_.find(line)) {
+        c.accesses++; c.hits++; l1_.touch(l);
+        bool was_prefetch = l->prefetched;
+        if (was_prefetch) { prefetch_.useful++; l->prefetched = false; }
+        ready_cycle = now + l1_.latency() - 1;
+        train_prefetcher(pc, address, was_prefetch, now); // tagged: the first hit on a prefetched line keeps the stream going
+        return true;
+    }
+    if (!l1_.mshr_available(now)) { if (count_reject) c.mshr_full++; return false; }
+    if (!can_fetch_below_l1(line, now)) { if (count_reject) l2_.counters.mshr_full++; return false; }
+    c.accesses++; c.misses++;
+    ready_cycle = fetch_below_l1(line, now + l1_.latency(), false);
+    uint64_t victim;
+    if (l1_.fill(line, false, false, victim)) { c.writebacks++; write_below_l1(victim, true); }
+    l1_.allocate_mshr(line, ready_cycle, false, now);
+    train_prefetcher(pc, address, true, now);
+    return true;
+}
+
+void MemoryHierarchy::store(int64_t address, uint64_t now) {
+    if (!enabled()) return;
+    const uint64_t line = line_of(address); auto& c = l1_.counters;
+    c.writes++;
+    if (CacheLevel::Line* l = l1_.find(line)) {
+        c.write_hits++; l1_.touch(l);
+        if (l1_.policy() == WritePolicy::WriteBack) l->dirty = true; else write_below_l1(line, false);
+        return;
+    }
+    if (l1_.policy() == WritePolicy::WriteThrough) { write_below_l1(line, false); return; } // no write-allocate
+    // Write-allocate: the rest of the line comes from below. Stores are posted, so only tags and traffic change.
+    uint64_t ready = fetch_below_l1(line, now + l1_.latency(), false), victim;
+    if (l1_.fill(line, true, false, victim)) { c.writebacks++; write_below_l1(victim, true); }
+    l1_.allocate_mshr(line, ready, false, now);
+}
+
+void MemoryHierarchy::warm(int64_t address, bool store) {
+    if (!enabled()) return;
+    const uint64_t line = line_of(address); const bool write_through = l1_.policy() == WritePolicy::WriteThrough;
+    if (CacheLevel::Line* l = l1_.find(line)) {
+        l1_.touch(l); l->prefetched = false;
+        if (store) { if (write_through) warm_below_l1(line, true); else l->dirty = true; }
+        return;
+    }
+    if (store && write_through) { warm_below_l1(line, true); return; }
+    warm_below_l1(line, false);
+    uint64_t victim;
+    if (l1_.fill(line, store, false, victim)) warm_below_l1(victim, true);
+}
+
+void MemoryHierarchy::warm_below_l1(uint64_t line, bool write) {
+    if (!l2_.enabled()) return;
+    if (CacheLevel::Line* l = l2_.find(line)) { l2_.touch(l); if (write && l2_.policy() == WritePolicy::WriteBack) l->dirty = true; return; }
+    if (write && l2_.policy() == WritePolicy::WriteThrough) return;
+    uint64_t victim; l2_.fill(line, write, false, victim);
+}
+
+uint64_t MemoryHierarchy::next_mshr_free(uint64_t now) const {
+    uint64_t t = l1_.next_mshr_free(now);
+    if (l2_.enabled()) {
+        const uint64_t l1_lat = static_cast<uint64_t>(l1_.latency());
+        uint64_t t2 = l2_.next_mshr_free(now + l1_lat);
+        if (t2 != UINT64_MAX) t = std::min(t, t2 - l1_lat);
+    }
+    return t;
+}
+
+bool MemoryHierarchy::can_fetch_below_l1(uint64_t line, uint64_t now) {
+    if (!l2_.enabled()) return true; // main memory accepts any number of requests
+    const uint64_t start = now + l1_.latency();
+    return l2_.find_mshr(line, start) || l2_.find(line) || l2_.mshr_available(start);
+}
+
+uint64_t MemoryHierarchy::fetch_below_l1(uint64_t line, uint64_t start, bool prefetch) {
+    if (!l2_.enabled()) { mem_reads_++; return start + mem_latency_ - 1; }
+    auto& c = l2_.counters; c.accesses++;
+    if (CacheLevel::Mshr* m = l2_.find_mshr(line, start)) { c.mshr_merges++; return std::max(m->ready, start + l2_.latency() - 1); }
+    if (CacheLevel::Line* l = l2_.find(line)) { c.hits++; l2_.touch(l); return start + l2_.latency() - 1; }
+    c.misses++; mem_reads_++;
+    uint64_t ready = start + l2_.latency() + mem_latency_ - 1, victim;
+    if (l2_.fill(line, false, false, victim)) { c.writebacks++; mem_writes_++; }
+    l2_.allocate_mshr(line, ready, prefetch, start);
+    return ready;
+}
+
+// A write arriving from L1: a dirty eviction (whole line) or a write-through store (one word).
+void MemoryHierarchy::write_below_l1(uint64_t line, bool writeback) {
+    if (!l2_.enabled()) { mem_writes_++; return; }
+    auto& c = l2_.counters; c.writes++;
+    if (CacheLevel::Line* l = l2_.find(line)) {
+        c.write_hits++; l2_.touch(l);
+        if (l2_.policy() == WritePolicy::WriteBack) l->dirty = true; else mem_writes_++;
+        return;
+    }
+    if (l2_.policy() == WritePolicy::WriteThrough) { mem_writes_++; return; }
+    if (!writeback) mem_reads_++; // a partial write has to fetch the rest of the line
+    uint64_t victim;
+    if (l2_.fill(line, true, false, victim)) { c.writebacks++; mem_writes_++; }
+}
+
+void MemoryHierarchy::train_prefetcher(uint64_t pc, int64_t address, bool trigger, uint64_t now) {
+    const uint64_t line = line_of(address);
+    if (prefetcher_ == PrefetcherKind::NextLine) {
+        if (trigger) for (int d = 1; d <= prefetch_degree_; ++d) issue_prefetch(line + d, now);
+        return;
+    }
+    if (prefetcher_ != PrefetcherKind::Stride) return;
+    StrideEntry& e = stride_table_[pc & (stride_table_.size() - 1)];
+    if (!e.valid || e.pc != pc) { e = {pc, address, 0, 0, true}; return; }
+    int64_t delta = address - e.last; e.last = address;
+    if (delta != 0 && delta == e.stride) { if (e.confidence < 3) e.confidence++; }
+    else if (e.confidence > 0) e.confidence--;
+    else e.stride = delta;
+    if (e.confidence < 2) return;
+    // Small strides (e.g. 8 bytes) stay inside a line: scale them to jump at least one line ahead.
+    const int64_t line_bytes = int64_t(1) << line_shift_;
+    const int64_t step = e.stride * std::max<int64_t>(1, line_bytes / std::max<int64_t>(1, e.stride < 0 ? -e.stride : e.stride));
+    for (int d = 1; d <= prefetch_degree_; ++d) {
+        uint64_t target = line_of(address + step * d);
+        if (target != line) issue_prefetch(target, now);
+    }
+}
+
+void MemoryHierarchy::issue_prefetch(uint64_t line, uint64_t now) {
+    if (l1_.find_mshr(line, now) || l1_.find(line)) return;
+    if (!l1_.mshr_available(now) || !can_fetch_below_l1(line, now)) { prefetch_.dropped++; return; }
+    prefetch_.issued++;
+    uint64_t ready = fetch_below_l1(line, now + l1_.latency(), true), victim;
+    if (l1_.fill(line, false, true, victim)) { l1_.counters.writebacks++; write_below_l1(victim, true); }
+    l1_.allocate_mshr(line, ready, true, now);
+}
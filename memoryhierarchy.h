@@ -0,0 +1,117 @@
+#ifndef MEMORYHIERARCHY_H
+#define MEMORYHIERARCHY_H
+
+#include <cstdint>
+#include <vector>
+#include "machineconfig.h"
+
+class CheckpointIO;
+
+// Timing model of the data side: L1D, optional L2 and main memory in front of PagedMemory. Only tags,
+// LRU state and miss-status holding registers are modelled; the data itself always lives in PagedMemory.
+// Addresses are treated as byte addresses (programs step words by 8), so a 64-byte line holds 8 words.
+//
+// Times are cycle numbers. A load accepted in cycle `now` is ready (may go on the CDB) in cycle
+// now + latency - 1, where latency sums the levels it had to visit; a 1-cycle L1 hit is ready at once.
+
+enum class WritePolicy : int { WriteBack, WriteThrough }; // write-back allocates on a write miss, write-through does not
+enum class PrefetcherKind : int { None, NextLine, Stride };
+
+struct CacheCounters {
+    uint64_t accesses = 0, hits = 0, misses = 0;  // misses = primary misses that allocated an MSHR (or went below)
+    uint64_t mshr_merges = 0;   // secondary misses folded into an outstanding MSHR
+    uint64_t mshr_full = 0;     // demand loads that had to wait because every MSHR was busy
+    uint64_t writes = 0, write_hits = 0, writebacks = 0; // stores / dirty evictions sent to the next level
+    double hit_rate() const { return accesses ? (double)hits / accesses : 0.0; }
+};
+
+struct PrefetchCounters {
+    uint64_t issued = 0;    // prefetches that allocated a line
+    uint64_t useful = 0;    // prefetched lines later hit (or merged into) by a demand load
+    uint64_t late = 0;      // ...of which the demand arrived while the prefetch was still in flight
+    uint64_t dropped = 0;   // no free MSHR
+    // accuracy: useful / issued; coverage: share of would-be L1 misses that a prefetch removed.
+    double accuracy() const { return issued ? (double)useful / issued : 0.0; }
+    double coverage(uint64_t demand_misses) const { return useful + demand_misses ? (double)useful / (useful + demand_misses) : 0.0; }
+};
+
+// One set-associative, LRU cache level with its MSHR file.
+class CacheLevel {
+public:
+    struct Line { uint64_t line = 0, lru = 0; bool valid = false, dirty = false, prefetched = false; };
+    struct Mshr { uint64_t line = 0, ready = 0; bool prefetch = false; };
+
+    CacheLevel() = default;
+    CacheLevel(int size_bytes, int assoc, int line_bytes, int latency, int mshrs, WritePolicy policy);
+    bool enabled() const { return !lines_.empty(); }
+    int latency() const { return latency_; }
+    WritePolicy policy() const { return policy_; }
+
+    Line* find(uint64_t line);
+    // Installs line (must be absent). Returns the evicted line if it was valid and dirty.
+    bool fill(uint64_t line, bool dirty, bool prefetched, uint64_t& victim);
+    void touch(Line* l) { l->lru = ++clock_; }
+
+    Mshr* find_mshr(uint64_t line, uint64_t now);
+    bool mshr_available(uint64_t now) const;
+    void allocate_mshr(uint64_t line, uint64_t ready, bool prefetch, uint64_t now);
+    uint64_t next_mshr_free(uint64_t now) const; // first cycle after `now` an MSHR frees up, UINT64_MAX if none is busy
+    void checkpoint(CheckpointIO& io); // tags, LRU, MSHRs and counters (see checkpoint.h)
+
+    CacheCounters counters;
+
+private:
+    std::vector<Line> lines_; // sets * ways, way-major within a set
+    std::vector<Mshr> mshrs_;
+    uint64_t sets_ = 0, clock_ = 0; int ways_ = 0, latency_ = 1;
+    WritePolicy policy_ = WritePolicy::WriteBack;
+};
+
+class MemoryHierarchy {
+public:
+    explicit MemoryHierarchy(const MachineConfig& config = MachineConfig());
+    // l1d_size = 0: ideal memory, every access is ready in the cycle it is made.
+    bool enabled() const { return l1_.enabled(); }
+
+    // Demand load from micro-op pc. Returns false if the miss cannot get an MSHR this cycle (nothing
+    // changes except mshr_full, counted once per load: pass count_reject = false on retries);
+    // otherwise sets ready_cycle and trains the prefetcher.
+    bool load(uint64_t pc, int64_t address, uint64_t now, uint64_t& ready_cycle, bool count_reject = true);
+    // Retiring store. Stores are posted: they update tags and traffic counters but never stall commit.
+    void store(int64_t address, uint64_t now);
+    // Functional warming (fast-forward): the tag, LRU and dirty state an in-order access would leave,
+    // without timing, MSHRs, prefetches or counters.
+    void warm(int64_t address, bool store);
+    // Lower bound on the cycle after `now` in which a load rejected for lack of MSHRs could be accepted.
+    uint64_t next_mshr_free(uint64_t now) const;
+
+    const CacheLevel& l1d() const { return l1_; }
+    const CacheLevel& l2() const { return l2_; }
+    PrefetcherKind prefetcher() const { return prefetcher_; }
+    const char* prefetcher_name() const;
+    const PrefetchCounters& prefetch() const { return prefetch_; }
+    uint64_t memory_reads() const { return mem_reads_; }
+    uint64_t memory_writes() const { return mem_writes_; }
+    void checkpoint(CheckpointIO& io); // both levels, prefetcher and traffic counters (see checkpoint.h)
+
+private:
+    struct StrideEntry { uint64_t pc = 0; int64_t last = 0, stride = 0; int confidence = 0; bool valid = false; };
+
+    uint64_t line_of(int64_t address) const { return static_cast<uint64_t>(address) >> line_shift_; }
+    bool can_fetch_below_l1(uint64_t line, uint64_t now);
+    uint64_t fetch_below_l1(uint64_t line, uint64_t start, bool prefetch);
+    void write_below_l1(uint64_t line, bool writeback);
+    void warm_below_l1(uint64_t line, bool write);
+    // trigger: the access missed, or was the first demand use of a prefetched line (next-line only).
+    void train_prefetcher(uint64_t pc, int64_t address, bool trigger, uint64_t now);
+    void issue_prefetch(uint64_t line, uint64_t now);
+
+    CacheLevel l1_, l2_;
+    int line_shift_ = 6, mem_latency_ = 100, prefetch_degree_ = 1;
+    PrefetcherKind prefetcher_ = PrefetcherKind::None;
+    std::vector<StrideEntry> stride_table_;
+    PrefetchCounters prefetch_;
+    uint64_t mem_reads_ = 0, mem_writes_ = 0;
+};
+
+#endif // MEMORYHIERARCHY_H
@@ -0,0 +1,94 @@
+#include "pagedmemory.h"
+#include "checkpoint.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+PagedMemory& PagedMemory::operator=(const PagedMemory& o) {
+    if (this == &o) return *this;
+    clear();
+    if (!o.sorted_pages_.empty()) add_chunk(o.sorted_pages_.size()); // a copy needs no growth steps: one exact chunk
+    for (const Page* src : o.sorted_pages_) *allocate_page(src->number) = *src;
+    version_ = o.version_;
+    return *this;
+}
+
+void PagedMemory::apply_pages(const std::vector<Page>& pages, uint64_t version) {
+    for (const Page& src : pages) *page_for_write(src.number) = src;
+    version_ = version;
+}
+
+void PagedMemory::add_chunk(size_t pages) {
+    chunks_.emplace_back(new Page[pages]);
+    last_chunk_size_ = pages; used_in_last_chunk_ = 0; pages_allocated_ += pages;
+}
+
+// Chunks grow 1, 2, 4, ... pages: a small program allocates one page, a large one few chunks.
+PagedMemory::Page* PagedMemory::allocate_page(int64_t number) {
+    if (used_in_last_chunk_ == last_chunk_size_)
+        add_chunk(std::min(std::max<size_t>(1, 2 * last_chunk_size_), static_cast<size_t>(MAX_PAGES_PER_CHUNK)));
+    Page* p = &chunks_.back()[used_in_last_chunk_++];
+    p->number = number; p->stamp = 0;
+    std::memset(p->words, 0, sizeof(p->words)); std::memset(p->written, 0, sizeof(p->written));
+    table_.emplace(number, p);
+    // Adding a page is rare; keeping the list sorted keeps scans in address order.
+    sorted_pages_.insert(std::upper_bound(sorted_pages_.begin(), sorted_pages_.end(), number,
+                                          [](int64_t n, const Page* q) { return n < q->number; }), p);
+    return p;
+}
+
+void PagedMemory::clear() {
+    chunks_.clear(); last_chunk_size_ = 0; used_in_last_chunk_ = 0; pages_allocated_ = 0;
+    table_.clear(); sorted_pages_.clear(); last_page_ = nullptr;
+    version_ = 0;
+}
+
+void PagedMemory::checkpoint(CheckpointIO& io) {
+    uint64_t pages = sorted_pages_.size(); io.pod(pages);
+    if (!io.loading()) { for (Page* p : sorted_pages_) io.raw(p, sizeof(Page)); }
+    else {
+        clear();
+        std::unique_ptr<Page> page(new Page);
+        for (uint64_t i = 0; i < pages; ++i) {
+            io.raw(page.get(), sizeof(Page));
+            if (table_.count(page->number)) throw std::runtime_error("Checkpoint has a duplicate memory page");
+            *allocate_page(page->number) = *page;
+        }
+    }
+    io.pod(version_);
+}
+
+void PagedMemory::restore(int64_t address, int64_t value, bool written) {
+    Page* p = page_for_write(page_key(address));
+    int64_t off = slot(address);
+    uint64_t bit = uint64_t(1) << (off & 63);
+    p->words[off] = value; p->written[off >> 6] = written ? p->written[off >> 6] | bit : p->written[off >> 6] & ~bit;
+    p->stamp = ++version_;
+}
+
+size_t PagedMemory::word_count() const {
+    size_t n = 0;
+    for (const Page* p : sorted_pages_) for (uint64_t w : p->written) n += popcount64(w);
+    return n;
+}
+
+void PagedMemory::load_words(int64_t base, const int64_t* words, size_t n, int64_t stride) {
+    for (size_t i = 0; i < n; ++i) write(base + static_cast<int64_t>(i) * stride, words[i]);
+}
+
+std::vector<int64_t> PagedMemory::read_image_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) throw std::runtime_error("Cannot open data image: " + path);
+    std::streamsize bytes = in.tellg(); in.seekg(0);
+    if (bytes % static_cast<std::streamsize>(sizeof(int64_t)) != 0) throw std::runtime_error("Data image size is not a multiple of 8 bytes: " + path);
+    std::vector<int64_t> words(static_cast<size_t>(bytes) / sizeof(int64_t));
+    if (!in.read(reinterpret_cast<char*>(words.data()), bytes)) throw std::runtime_error("Cannot read data image: " + path);
+    return words;
+}
+
+size_t PagedMemory::load_image_file(int64_t base, const std::string& path, int64_t stride) {
+    std::vector<int64_t> words = read_image_file(path);
+    load_words(base, words.data(), words.size(), stride);
+    return words.size();
+}
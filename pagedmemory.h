@@ -0,0 +1,145 @@
+#ifndef PAGEDMEMORY_H
+#define PAGEDMEMORY_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+class CheckpointIO;
+
+// Bit scans over the pages' `written` masks. MSVC has no __builtin_popcountll/__builtin_ctzll.
+inline int popcount64(uint64_t x) {
+#ifdef _MSC_VER
+    return static_cast<int>(__popcnt64(x));
+#else
+    return __builtin_popcountll(x);
+#endif
+}
+inline int lowest_set_bit64(uint64_t x) { // x != 0
+#ifdef _MSC_VER
+    unsigned long index; _BitScanForward64(&index, x); return static_cast<int>(index);
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+// Sparse simulated data memory. Every address holds one 64-bit word (the ISA has no byte accesses) and
+// programs step through memory by 8, so a page keeps one slot per 8 addresses: WORDS slots covering
+// PAGE_BYTES addresses. A misaligned address still is a word of its own; it lives in a separate page of
+// its lane (address & 7), so only programs that use such addresses pay for them. Pages are allocated on
+// first write from an arena of chunks that double in size up to MAX_PAGES_PER_CHUNK, and found through a
+// hash of the page key plus a one-entry lookup cache; reading an unwritten address returns 0 without
+// allocating.
+class PagedMemory {
+public:
+    static constexpr int PAGE_BITS = 9;
+    static constexpr int64_t WORDS = int64_t(1) << PAGE_BITS; // slots per page
+    static constexpr int64_t PAGE_BYTES = WORDS * 8;          // addresses per page
+    static constexpr int MAX_PAGES_PER_CHUNK = 64;
+
+    // Page key: the PAGE_BYTES range times 8 plus the lane, so keys sort by range, then lane.
+    static int64_t page_key(int64_t address) { return (address >> (PAGE_BITS + 3)) * 8 + (address & 7); }
+    static int64_t slot(int64_t address) { return (address >> 3) & (WORDS - 1); }
+
+    struct Page {
+        int64_t number = 0;       // page_key()
+        uint64_t stamp = 0;       // version() of the last write into this page
+        int64_t words[WORDS];
+        uint64_t written[WORDS / 64]; // which words were ever stored (for listings)
+        bool is_written(int64_t offset) const { return (written[offset >> 6] >> (offset & 63)) & 1; }
+        int64_t address(int64_t offset) const { return (number >> 3) * PAGE_BYTES + offset * 8 + (number & 7); }
+    };
+
+    PagedMemory() = default;
+    PagedMemory(const PagedMemory& o) { *this = o; }
+    PagedMemory& operator=(const PagedMemory& o);
+    PagedMemory(PagedMemory&&) = default;
+    PagedMemory& operator=(PagedMemory&&) = default;
+
+    int64_t read(int64_t address) const {
+        const Page* p = find_page(page_key(address));
+        return p ? p->words[slot(address)] : 0;
+    }
+    void write(int64_t address, int64_t value) {
+        Page* p = page_for_write(page_key(address));
+        int64_t off = slot(address);
+        if (undo_log_) undo_log_->push_back({address, p->words[off], p->is_written(off)});
+        p->words[off] = value; p->written[off >> 6] |= uint64_t(1) << (off & 63);
+        p->stamp = ++version_;
+    }
+    bool contains(int64_t address) const {
+        const Page* p = find_page(page_key(address));
+        return p && p->is_written(slot(address));
+    }
+
+    // Writes n consecutive words to base, base+stride, ... (stride 8 matches [REG+8*i] addressing).
+    void load_words(int64_t base, const int64_t* words, size_t n, int64_t stride = 8);
+    // Raw image of int64 words in host (little-endian) byte order; throws std::runtime_error if unreadable.
+    static std::vector<int64_t> read_image_file(const std::string& path);
+    size_t load_image_file(int64_t base, const std::string& path, int64_t stride = 8);
+    void clear();
+    void checkpoint(CheckpointIO& io); // written pages and version (see checkpoint.h)
+
+    // Reverse stepping (see StateHistory): while a log is set, every write first appends the word's
+    // previous contents to it. restore() puts a word back exactly, including its never-written state.
+    struct WordUndo { int64_t address, value; bool written; };
+    void set_undo_log(std::vector<WordUndo>* log) { undo_log_ = log; }
+    void restore(int64_t address, int64_t value, bool written);
+
+    // Bumped on every write. Consumers remember the value they last saw and pass it to
+    // for_each_dirty_page to visit only the pages written since.
+    uint64_t version() const { return version_; }
+    size_t page_count() const { return sorted_pages_.size(); }
+    size_t word_count() const; // written words
+    size_t bytes_allocated() const { return pages_allocated_ * sizeof(Page); }
+
+    // Pages in ascending key order: by address range, then lane (misaligned words after the aligned ones).
+    const std::vector<Page*>& pages() const { return sorted_pages_; }
+    template<class F> void for_each_dirty_page(uint64_t since_version, F f) const {
+        for (const Page* p : sorted_pages_) if (p->stamp > since_version) f(*p);
+    }
+    // Mirrors another memory: copies its pages (as visited by for_each_dirty_page) over ours, stamps
+    // included, and adopts its version.
+    void apply_pages(const std::vector<Page>& pages, uint64_t version);
+    // Every written word in ascending address order: f(address, value). The lanes of one range are merged.
+    template<class F> void for_each_word(F f) const {
+        for (size_t i = 0; i < sorted_pages_.size();) {
+            size_t end = i + 1;
+            while (end < sorted_pages_.size() && (sorted_pages_[end]->number >> 3) == (sorted_pages_[i]->number >> 3)) ++end;
+            for (int64_t off = 0; off < WORDS; ++off)
+                for (size_t k = i; k < end; ++k) { const Page* p = sorted_pages_[k]; if (p->is_written(off)) f(p->address(off), p->words[off]); }
+            i = end;
+        }
+    }
+
+private:
+    const Page* find_page(int64_t number) const {
+        if (last_page_ && last_page_->number == number) return last_page_;
+        auto it = table_.find(number);
+        if (it == table_.end()) return nullptr;
+        last_page_ = it->second; return last_page_;
+    }
+    Page* page_for_write(int64_t number) {
+        if (last_page_ && last_page_->number == number) return last_page_;
+        auto it = table_.find(number);
+        last_page_ = it != table_.end() ? it->second : allocate_page(number);
+        return last_page_;
+    }
+    Page* allocate_page(int64_t number);
+    void add_chunk(size_t pages);
+
+    std::vector<std::unique_ptr<Page[]>> chunks_;
+    size_t last_chunk_size_ = 0, used_in_last_chunk_ = 0, pages_allocated_ = 0;
+    std::unordered_map<int64_t, Page*> table_;
+    std::vector<Page*> sorted_pages_;
+    mutable Page* last_page_ = nullptr;
+    uint64_t version_ = 0;
+    std::vector<WordUndo>* undo_log_ = nullptr; // not copied: a copy is never the recorded machine
+};
+
+#endif // PAGEDMEMORY_H
@@ -0,0 +1,516 @@
+// Headless batch runner: loads one or more assembly files, runs PipelineSimulator::step()
+// to completion without any GUI and prints the final statistics and architectural state.
+#include "pipelinesimulator.h"
+#include "eventtrace.h"
+#include "kanatawriter.h"
+#include "functionalsim.h"
+#include "sampling.h"
+#include "checkpoint.h"
+#include "textutil.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct CliOptions {
+    std::string format = "text";
+    std::string output_path;
+    uint64_t max_cycles = 100000000;
+    long profile_top = -1; // --profile N: hottest N instructions (0 = all), -1 = no report
+    bool show_memory = true, print_config = false, generic_core = false, cycle_skipping = true;
+    MachineConfig config;
+    std::vector<std::string> programs;
+    std::vector<std::pair<int64_t, std::string>> data_images; // --data BASE:FILE
+    std::string trace_path; uint64_t trace_keyframes = 4096; // --trace FILE, --trace-keyframes N
+    std::string kanata_path; // --kanata FILE
+    uint64_t fast_forward = 0; std::string fast_forward_to; bool warm = false; // --fast-forward N, --fast-forward-to LABEL, --warm
+    bool check = false; // --check
+    bool sample = false; SamplingConfig sampling; // --sample PERIOD, --sample-warmup/-unit/-offset/-confidence, --sample-cold
+    std::string save_checkpoint, restore; // --save-checkpoint FILE, --restore FILE (then the only "program")
+};
+
+struct RunResult {
+    std::string program; std::string error;
+    bool finished = false; double host_seconds = 0.0;
+    uint64_t trace_events = 0, trace_bytes = 0, kanata_rows = 0;
+    uint64_t fast_forwarded = 0; double fast_forward_seconds = 0.0;
+    bool check_ok = true; uint64_t checked_uops = 0; std::string check_report;
+    SamplingResult sampling;
+    uint64_t checkpoint_bytes = 0, restored_cycle = 0; double checkpoint_seconds = 0.0, restore_seconds = 0.0;
+};
+
+void print_usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [options] <program.asm> [more.asm ...]\n"
+              << "       " << argv0 << " [options] --restore <checkpoint>\n"
+              << "  --format text|json   output format (default: text)\n"
+              << "  --max-cycles N       stop a run after N cycles (default: 100000000)\n"
+              << "  --no-memory          omit the data memory dump\n"
+              << "  --profile N          per-instruction profile of the N hottest instructions (0 = all)\n"
+              << "  --data BASE:FILE     preload FILE (raw little-endian int64 words) at BASE, BASE+8, ... (repeatable)\n"
+              << "  --config FILE        load machine parameters (key = value lines)\n"
+              << "  --set KEY=VALUE      override one machine parameter (repeatable)\n"
+              << "  --print-config       print the effective machine configuration and exit\n"
+              << "  --generic-core       never use the compile-time specialized core\n"
+              << "  --no-cycle-skip      step every idle cycle instead of jumping to the next event\n"
+              << "  --trace FILE         record a binary event trace for offline replay (one program only)\n"
+              << "  --trace-keyframes N  cycles between trace keyframes (default: 4096)\n"
+              << "  --kanata FILE        write a pipeline diagram for the Konata viewer (one program only)\n"
+              << "  --fast-forward N     execute the first N instructions functionally (no timing), then simulate in detail\n"
+              << "  --fast-forward-to L  fast-forward up to label L (with --fast-forward: whichever comes first)\n"
+              << "  --warm               train the branch predictor and caches while fast-forwarding\n"
+              << "  --check              check every retired micro-op against the functional model (exit code 3 on divergence)\n"
+              << "  --sample PERIOD      sampled simulation: one measured unit per PERIOD instructions, the rest fast-forwarded\n"
+              << "  --sample-unit N      measured instructions per unit (default: 1000)\n"
+              << "  --sample-warmup N    detailed instructions before each unit, not measured (default: 2000)\n"
+              << "  --sample-offset N    instructions fast-forwarded before the first period (default: 0)\n"
+              << "  --sample-confidence P  confidence level of the CPI interval (default: 0.997)\n"
+              << "  --sample-cold        do not warm the predictor and caches while fast-forwarding\n"
+              << "  --save-checkpoint F  save the complete simulator state to F where the run stops (program end or\n"
+              << "                       --max-cycles; --max-cycles 0 saves right after --fast-forward)\n"
+              << "  --restore F          continue from checkpoint F instead of loading a program; its machine\n"
+              << "                       configuration replaces --config/--set\n"
+              << "  -o, --output FILE    write results to FILE instead of stdout\n"
+              << "  -h, --help           show this help\n";
+}
+
+bool parse_args(int argc, char* argv[], CliOptions& opts) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto need_value = [&](const char* name) -> const char* {
+            if (i + 1 >= argc) { std::cerr << "Missing value for " << name << "\n"; return nullptr; }
+            return argv[++i];
+        };
+        if (a == "-h" || a == "--help") { print_usage(argv[0]); std::exit(0); }
+        else if (a == "--format") { const char* v = need_value("--format"); if (!v) return false; opts.format = v; }
+        else if (a == "--max-cycles") { const char* v = need_value("--max-cycles"); if (!v) return false; opts.max_cycles = std::strtoull(v, nullptr, 10); }
+        else if (a == "--no-memory") { opts.show_memory = false; }
+        else if (a == "--profile") { const char* v = need_value("--profile"); if (!v) return false; opts.profile_top = std::strtol(v, nullptr, 10); }
+        else if (a == "--data") {
+            const char* v = need_value("--data"); if (!v) return false;
+            std::string s = v; size_t colon = s.find(':'); char* end = nullptr;
+            long long base = colon == std::string::npos ? 0 : std::strtoll(s.c_str(), &end, 0);
+            if (colon == std::string::npos || end != s.c_str() + colon) { std::cerr << "Expected BASE:FILE, got: " << s << "\n"; return false; }
+            opts.data_images.emplace_back(base, s.substr(colon + 1));
+        }
+        else if (a == "--config" || a == "--set") {
+            const char* v = need_value(a.c_str()); if (!v) return false;
+            try { if (a == "--config") opts.config.load_file(v); else opts.config.set_assignment(v); }
+            catch (const std::exception& e) { std::cerr << e.what() << "\n"; return false; }
+        }
+        else if (a == "--print-config") { opts.print_config = true; }
+        else if (a == "--generic-core") { opts.generic_core = true; }
+        else if (a == "--no-cycle-skip") { opts.cycle_skipping = false; }
+        else if (a == "--trace") { const char* v = need_value("--trace"); if (!v) return false; opts.trace_path = v; }
+        else if (a == "--trace-keyframes") { const char* v = need_value("--trace-keyframes"); if (!v) return false; opts.trace_keyframes = std::strtoull(v, nullptr, 10); }
+        else if (a == "--kanata") { const char* v = need_value("--kanata"); if (!v) return false; opts.kanata_path = v; }
+        else if (a == "--fast-forward") { const char* v = need_value("--fast-forward"); if (!v) return false; opts.fast_forward = std::strtoull(v, nullptr, 10); }
+        else if (a == "--fast-forward-to") { const char* v = need_value("--fast-forward-to"); if (!v) return false; opts.fast_forward_to = v; }
+        else if (a == "--warm") { opts.warm = true; }
+        else if (a == "--check") { opts.check = true; }
+        else if (a == "--sample") { const char* v = need_value("--sample"); if (!v) return false; opts.sample = true; opts.sampling.period = std::strtoull(v, nullptr, 10); }
+        else if (a == "--sample-unit") { const char* v = need_value("--sample-unit"); if (!v) return false; opts.sampling.unit = std::strtoull(v, nullptr, 10); }
+        else if (a == "--sample-warmup") { const char* v = need_value("--sample-warmup"); if (!v) return false; opts.sampling.warmup = std::strtoull(v, nullptr, 10); }
+        else if (a == "--sample-offset") { const char* v = need_value("--sample-offset"); if (!v) return false; opts.sampling.offset = std::strtoull(v, nullptr, 10); }
+        else if (a == "--sample-confidence") { const char* v = need_value("--sample-confidence"); if (!v) return false; opts.sampling.confidence = std::strtod(v, nullptr); }
+        else if (a == "--sample-cold") { opts.sampling.functional_warming = false; }
+        else if (a == "--save-checkpoint") { const char* v = need_value("--save-checkpoint"); if (!v) return false; opts.save_checkpoint = v; }
+        else if (a == "--restore") { const char* v = need_value("--restore"); if (!v) return false; opts.restore = v; }
+        else if (a == "-o" || a == "--output") { const char* v = need_value("--output"); if (!v) return false; opts.output_path = v; }
+        else if (!a.empty() && a[0] == '-') { std::cerr << "Unknown option: " << a << "\n"; return false; }
+        else { opts.programs.push_back(a); }
+    }
+    if (opts.format != "text" && opts.format != "json") { std::cerr << "Unknown format: " << opts.format << "\n"; return false; }
+    try { opts.config.validate(); } catch (const std::exception& e) { std::cerr << e.what() << "\n"; return false; }
+    if (!opts.restore.empty()) {
+        if (!opts.programs.empty()) { std::cerr << "--restore replaces the program; do not give one\n"; return false; }
+        if (!opts.data_images.empty()) { std::cerr << "--restore cannot be combined with --data (memory comes from the checkpoint)\n"; return false; }
+        opts.programs.push_back(opts.restore);
+    }
+    if (opts.programs.empty() && !opts.print_config) { std::cerr << "No program given\n"; return false; }
+    if (!opts.save_checkpoint.empty() && opts.programs.size() > 1) { std::cerr << "--save-checkpoint saves a single program\n"; return false; }
+    if (!opts.trace_path.empty() || !opts.kanata_path.empty()) {
+        const char* option = opts.trace_path.empty() ? "--kanata" : "--trace";
+        if (!opts.trace_path.empty() && !opts.kanata_path.empty()) { std::cerr << "--trace and --kanata cannot be combined\n"; return false; }
+        if (opts.programs.size() > 1) { std::cerr << option << " records a single program\n"; return false; }
+        if (!trace_supported()) { std::cerr << option << ": this build has no trace hooks (PIPELIGHT_TRACE=OFF)\n"; return false; }
+    }
+    if (opts.check) {
+        if (!opts.trace_path.empty() || !opts.kanata_path.empty()) { std::cerr << "--check cannot be combined with --trace or --kanata\n"; return false; }
+        if (!trace_supported()) { std::cerr << "--check: this build has no trace hooks (PIPELIGHT_TRACE=OFF)\n"; return false; }
+    }
+    if (opts.sample) {
+        if (opts.fast_forward || !opts.fast_forward_to.empty() || opts.check || !opts.trace_path.empty() || !opts.kanata_path.empty()) {
+            std::cerr << "--sample cannot be combined with --fast-forward, --check, --trace or --kanata\n"; return false;
+        }
+        try { opts.sampling.validate(); } catch (const std::exception& e) { std::cerr << e.what() << "\n"; return false; }
+    }
+    return true;
+}
+
+bool read_file(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::stringstream ss; ss << in.rdbuf(); out = ss.str();
+    return true;
+}
+
+// Instructions that did anything, hottest first: cycles blocking commit, then operand waits, then address.
+std::vector<size_t> profile_order(const PipelineSimulator& sim, long top) {
+    const auto& prof = sim.getProfile(); std::vector<size_t> order;
+    for (size_t i = 0; i < prof.size(); ++i) if (prof[i].commits || prof[i].head_stall_cycles || prof[i].operand_wait_cycles) order.push_back(i);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (prof[a].head_stall_cycles != prof[b].head_stall_cycles) return prof[a].head_stall_cycles > prof[b].head_stall_cycles;
+        return prof[a].operand_wait_cycles > prof[b].operand_wait_cycles;
+    });
+    if (top > 0 && order.size() > static_cast<size_t>(top)) order.resize(top);
+    return order;
+}
+
+void print_profile(std::ostream& os, const PipelineSimulator& sim, long top) {
+    os << "profile: (sorted by cycles at the ROB head; share of all cycles)\n"
+       << "  " << std::setw(5) << "addr" << std::setw(6) << "line" << std::setw(10) << "commits" << std::setw(11) << "head_stall" << std::setw(8) << "share"
+       << std::setw(13) << "operand_wait" << std::setw(12) << "mispredicts" << std::setw(10) << "load_lat" << "  instruction\n";
+    const auto& prof = sim.getProfile();
+    for (size_t i : profile_order(sim, top)) {
+        const InstructionProfile& p = prof[i]; const Instruction& ins = sim.program_memory[i];
+        std::ostringstream share, lat;
+        share << std::fixed << std::setprecision(1) << (sim.cycle_count ? 100.0 * p.head_stall_cycles / sim.cycle_count : 0.0) << "%";
+        if (p.loads) lat << std::fixed << std::setprecision(1) << p.average_load_latency(); else lat << "-";
+        os << "  " << std::setw(5) << ins.address << std::setw(6) << ins.line << std::setw(10) << p.commits << std::setw(11) << p.head_stall_cycles
+           << std::setw(8) << share.str() << std::setw(13) << p.operand_wait_cycles
+           << std::setw(12) << (p.branches ? std::to_string(p.mispredicts) + "/" + std::to_string(p.branches) : std::string("-"))
+           << std::setw(10) << lat.str() << "  " << sim.instructionText(ins) << "\n";
+    }
+}
+
+RunResult run_program(const std::string& path, const CliOptions& opts, PipelineSimulator& sim) {
+    RunResult r; r.program = path;
+    std::string source;
+    if (!opts.restore.empty()) {
+        auto r0 = std::chrono::steady_clock::now();
+        try { load_checkpoint(sim, path); } catch (const std::exception& e) { r.error = e.what(); return r; }
+        r.restore_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - r0).count();
+        source = sim.programSource(); r.restored_cycle = sim.cycle_count;
+    }
+    else {
+        if (!read_file(path, source)) { r.error = "cannot read file"; return r; }
+        try {
+            sim.parse_and_load_program(source);
+            for (const auto& image : opts.data_images) sim.preloadDataFile(image.first, image.second);
+        }
+        catch (const std::exception& e) { r.error = e.what(); return r; }
+    }
+    if (opts.fast_forward || !opts.fast_forward_to.empty()) {
+        int64_t stop = -1;
+        if (!opts.fast_forward_to.empty() && (stop = sim.labelAddress(opts.fast_forward_to)) < 0) { r.error = "Label not found: " + opts.fast_forward_to; return r; }
+        FunctionalSimulator ff(sim); ff.setWarmup(opts.warm, opts.warm);
+        auto f0 = std::chrono::steady_clock::now();
+        try { r.fast_forwarded = ff.run(opts.fast_forward ? opts.fast_forward : UINT64_MAX, stop); }
+        catch (const std::exception& e) { r.error = e.what(); return r; }
+        r.fast_forward_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - f0).count();
+    }
+    std::unique_ptr<TraceWriter> trace; std::unique_ptr<KanataWriter> kanata; std::unique_ptr<LockstepChecker> checker;
+    try {
+        if (opts.check) { checker.reset(new LockstepChecker()); checker->begin(sim); }
+        if (!opts.trace_path.empty()) { trace.reset(new TraceWriter(opts.trace_path, opts.trace_keyframes)); trace->begin(sim, source); }
+        if (!opts.kanata_path.empty()) { kanata.reset(new KanataWriter(opts.kanata_path)); kanata->begin(sim); }
+    }
+    catch (const std::exception& e) { r.error = e.what(); return r; }
+
+    auto t0 = std::chrono::steady_clock::now();
+    if (opts.sample) r.sampling = run_sampled(sim, opts.sampling, opts.max_cycles);
+    else while (!sim.is_finished() && sim.cycle_count < opts.max_cycles) sim.advance(opts.max_cycles);
+    if (trace) { trace->finish(); r.trace_events = trace->events(); r.trace_bytes = trace->bytes(); }
+    if (kanata) { kanata->finish(); r.kanata_rows = kanata->rows(); }
+    if (checker) { checker->finish(); r.check_ok = checker->ok(); r.checked_uops = checker->checked(); r.check_report = checker->report(); }
+    auto t1 = std::chrono::steady_clock::now();
+    r.finished = sim.is_finished();
+    r.host_seconds = std::chrono::duration<double>(t1 - t0).count();
+    if (!opts.save_checkpoint.empty()) {
+        try { r.checkpoint_bytes = save_checkpoint(sim, opts.save_checkpoint); } catch (const std::exception& e) { r.error = e.what(); return r; }
+        r.checkpoint_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+    }
+    return r;
+}
+
+void print_sampling(std::ostream& os, const SamplingResult& s, const SamplingConfig& c) {
+    os << "sampling: period=" << c.period << " warmup=" << c.warmup << " unit=" << c.unit << " offset=" << c.offset
+       << (c.functional_warming ? " (warm)" : " (cold)") << " units=" << s.units() << "\n"
+       << "  instructions: total=" << s.instructions << " fast_forwarded=" << s.fast_forwarded << " detailed=" << s.detailed << "\n";
+    if (s.units() == 0) { os << "  cpi: no complete unit (program shorter than one period?)\n"; return; }
+    os << "  cpi: " << s.mean_cpi << " +- " << s.half_width << " (" << 100.0 * c.confidence << "% confidence, " << 100.0 * s.relative_error()
+       << "% relative, stddev=" << s.stddev << ", units for +-3%: " << s.required_units(0.03) << ")\n"
+       << "  ipc: " << s.ipc() << " [" << s.ipc_low() << ", " << s.ipc_high() << "]\n"
+       << "  estimated_cycles: " << static_cast<uint64_t>(s.estimated_cycles()) << "\n"
+       << "  host: seconds=" << s.host_seconds << " detailed=" << s.detailed_host_seconds << " full_detailed_estimate=" << s.full_detailed_host_seconds
+       << " saved=" << s.host_seconds_saved() << "\n";
+}
+
+void print_text(std::ostream& os, const RunResult& r, const PipelineSimulator& sim, const CliOptions& opts) {
+    os << "program: " << r.program << "\n";
+    if (!r.error.empty()) { os << "error: " << r.error << "\n"; return; }
+    double ipc = sim.cycle_count > 0 ? (double)sim.committed_ins_count / sim.cycle_count : 0.0;
+    os << "finished: " << (r.finished ? "yes" : "no (cycle limit reached)") << "\n"
+       << "cycles: " << sim.cycle_count << "\n"
+       << "committed: " << sim.committed_ins_count << "\n"
+       << "ipc: " << ipc << "\n"
+       << "branches: " << sim.total_branch_count << "\n"
+       << "mispredicts: " << sim.mispredict_count << "\n"
+       << "mispredict_penalty: avg=" << sim.averageMispredictPenalty() << " total=" << sim.mispredict_penalty_cycles
+       << " squashed_uops=" << sim.squashed_uop_count << "\n"
+       << "host_seconds: " << r.host_seconds << "\n"
+       << "skipped_cycles: " << sim.skipped_cycles << "\n";
+    if (!opts.trace_path.empty()) os << "trace: " << opts.trace_path << " (" << r.trace_events << " events, " << r.trace_bytes / 1024 << " KiB)\n";
+    if (!opts.kanata_path.empty()) os << "kanata: " << opts.kanata_path << " (" << r.kanata_rows << " micro-ops)\n";
+    if (opts.fast_forward || !opts.fast_forward_to.empty())
+        os << "fast_forward: " << r.fast_forwarded << " instructions in " << r.fast_forward_seconds << " s" << (opts.warm ? " (warm)" : "") << "\n";
+    if (opts.check) os << "check: " << (r.check_ok ? "" : "FAILED ") << r.check_report << "\n";
+    if (!opts.restore.empty()) os << "restored: " << opts.restore << " at cycle " << r.restored_cycle << " in " << r.restore_seconds << " s\n";
+    if (!opts.save_checkpoint.empty())
+        os << "checkpoint: " << opts.save_checkpoint << " (" << r.checkpoint_bytes / 1024 << " KiB in " << r.checkpoint_seconds << " s)\n";
+    if (opts.sample) print_sampling(os, r.sampling, opts.sampling);
+    os
+       << "memory_pages: " << sim.getMemory().page_count() << " (" << sim.getMemory().bytes_allocated() / 1024 << " KiB allocated)\n";
+    const WidthStats& w = sim.getWidthStats();
+    const MachineConfig& cfg = sim.getConfig();
+    os << "issue: width=" << cfg.issue_width << " slots_used=" << w.issue_slots_used << " width_bound_cycles=" << w.issue_width_bound_cycles;
+    for (int i = 1; i < static_cast<int>(IssueStall::Count); ++i) os << " " << issue_stall_name(static_cast<IssueStall>(i)) << "=" << w.issue_slots_lost[i];
+    os << "\ncommit: width=" << cfg.commit_width << " slots_used=" << w.commit_slots_used << " width_bound_cycles=" << w.commit_width_bound_cycles;
+    for (int i = 1; i < static_cast<int>(CommitStall::Count); ++i) os << " " << commit_stall_name(static_cast<CommitStall>(i)) << "=" << w.commit_slots_lost[i];
+    os << "\ncdb: width=" << cfg.cdb_width << " results=" << w.cdb_results << " width_bound_cycles=" << w.cdb_width_bound_cycles
+       << " delayed_results=" << w.cdb_delayed_results << " per_cycle=";
+    const PipelineStats& ps = sim.getPipelineStats();
+    for (int i = 0; i < PipelineStats::CDB_BUCKETS; ++i) os << (i ? "/" : "") << ps.cdb_per_cycle[i];
+    const TopDown t = sim.topDown();
+    os << "\ntopdown: slots=" << t.total_slots << " retiring=" << t.fraction(t.retiring) << " bad_speculation=" << t.fraction(t.bad_speculation)
+       << " frontend_bound=" << t.fraction(t.frontend_bound) << " backend_bound=" << t.fraction(t.backend_bound)
+       << " (memory=" << t.fraction(t.backend_memory) << " core=" << t.fraction(t.backend_core) << ") in_flight=" << t.fraction(t.in_flight) << "\n";
+    os << "occupancy:";
+    for (int i = 0; i < static_cast<int>(Structure::Count); ++i) {
+        const OccupancyHistogram& h = ps.occupancy[i];
+        os << " " << structure_name(static_cast<Structure>(i)) << "=" << h.mean() << "/" << h.cycles.size() - 1 << " (full " << h.full_fraction() << ")";
+    }
+    os << " operand_wait: alu_rs=" << ps.operand_wait[static_cast<int>(Structure::AluRs)] << " mul_div_rs=" << ps.operand_wait[static_cast<int>(Structure::MulDivRs)];
+    os << "\nfu_busy:";
+    for (int i = 0; i < static_cast<int>(FuClass::Count); ++i)
+        os << " " << fu_class_name(static_cast<FuClass>(i)) << "=" << ps.fu[i].busy_cycles << " (ops " << ps.fu[i].op_cycles << ")";
+    os << "\nports: select_policy=" << cfg.value_string(*MachineConfig::find_field("select_policy")) << "\n";
+    for (int i = 0; i < static_cast<int>(Port::Count); ++i) {
+        const PortUsage& p = ps.ports[i];
+        os << "  " << port_name(static_cast<Port>(i)) << ": units=";
+        if (p.units) {
+            os << p.units << " utilization=" << p.mean_utilization() << " per_unit=";
+            for (int u = 0; u < p.units; ++u) os << (u ? "/" : "") << p.utilization(u);
+            os << " saturated=" << p.saturated_fraction();
+        } else os << "unlimited mean_busy=" << p.busy.mean();
+        os << " waits=" << p.waits << "\n";
+    }
+    const BranchUnit& bu = sim.getBranchUnit();
+    auto counters = [&](const char* name, const PredictorCounters& c) {
+        os << "  " << name << ": lookups=" << c.lookups << " correct=" << c.correct << " accuracy=" << c.accuracy() << "\n";
+    };
+    os << "predictor: " << bu.direction().name() << "\n";
+    counters("overall", bu.overall()); counters("direction", bu.direction().counters);
+    counters("btb", bu.btb().counters); counters("ras", bu.ras().counters);
+    if (!bu.direction().detail().empty()) os << "  providers: " << bu.direction().detail() << "\n";
+    os << "  ras_overflows=" << bu.ras().overflows << " ras_underflows=" << bu.ras().underflows << "\n";
+    const MemoryHierarchy& mh = sim.getMemoryHierarchy();
+    if (mh.enabled()) {
+        auto level = [&](const char* name, const CacheCounters& c) {
+            os << "  " << name << ": accesses=" << c.accesses << " hits=" << c.hits << " misses=" << c.misses << " mshr_merges=" << c.mshr_merges
+               << " mshr_full=" << c.mshr_full << " hit_rate=" << c.hit_rate() << " writes=" << c.writes << " write_hits=" << c.write_hits
+               << " writebacks=" << c.writebacks << "\n";
+        };
+        os << "caches:\n";
+        level("l1d", mh.l1d().counters); if (mh.l2().enabled()) level("l2", mh.l2().counters);
+        os << "  mem: reads=" << mh.memory_reads() << " writes=" << mh.memory_writes() << "\n";
+        const PrefetchCounters& p = mh.prefetch();
+        os << "  prefetch: kind=" << mh.prefetcher_name() << " issued=" << p.issued << " useful=" << p.useful << " late=" << p.late
+           << " dropped=" << p.dropped << " accuracy=" << p.accuracy() << " coverage=" << p.coverage(mh.l1d().counters.misses) << "\n";
+    } else os << "caches: ideal\n";
+    const LsqStats& q = sim.getLsqStats();
+    os << "lsq: memory_dependence=" << sim.getConfig().value_string(*MachineConfig::find_field("memory_dependence")) << " forwards=" << q.forwards
+       << " speculative_loads=" << q.speculative_loads << " store_waits=" << q.store_waits << " violations=" << q.violations
+       << " replays=" << q.replays << " replayed_uops=" << q.replayed_uops << " store_sets=" << sim.getStoreSets().sets_created() << "\n";
+    if (opts.profile_top >= 0) print_profile(os, sim, opts.profile_top);
+    const auto& regs = sim.getArchRegs();
+    os << "registers:\n";
+    for (int r = 0; r < NUM_GPRS; ++r) os << "  " << reg_name(r) << " = " << regs.gpr[r] << "\n";
+    os << "flags: ZF=" << regs.ZF << " SF=" << regs.SF << " OF=" << regs.OF << "\n";
+    if (opts.show_memory) {
+        os << "memory:\n";
+        sim.getMemory().for_each_word([&](int64_t a, int64_t v) { os << "  [" << a << "] = " << v << "\n"; });
+    }
+}
+
+void print_json(std::ostream& os, const RunResult& r, const PipelineSimulator& sim, const CliOptions& opts) {
+    os << "{\"program\": \"" << json_escape(r.program) << "\"";
+    if (!r.error.empty()) { os << ", \"error\": \"" << json_escape(r.error) << "\"}"; return; }
+    double ipc = sim.cycle_count > 0 ? (double)sim.committed_ins_count / sim.cycle_count : 0.0;
+    os << ", \"finished\": " << (r.finished ? "true" : "false")
+       << ", \"cycles\": " << sim.cycle_count
+       << ", \"committed\": " << sim.committed_ins_count
+       << ", \"ipc\": " << ipc
+       << ", \"branches\": " << sim.total_branch_count
+       << ", \"mispredicts\": " << sim.mispredict_count
+       << ", \"mispredict_penalty\": {\"avg\": " << sim.averageMispredictPenalty() << ", \"total\": " << sim.mispredict_penalty_cycles
+       << ", \"squashed_uops\": " << sim.squashed_uop_count << "}"
+       << ", \"host_seconds\": " << r.host_seconds
+       << ", \"skipped_cycles\": " << sim.skipped_cycles;
+    if (!opts.trace_path.empty())
+        os << ", \"trace\": {\"file\": \"" << json_escape(opts.trace_path) << "\", \"events\": " << r.trace_events << ", \"bytes\": " << r.trace_bytes << "}";
+    if (!opts.kanata_path.empty())
+        os << ", \"kanata\": {\"file\": \"" << json_escape(opts.kanata_path) << "\", \"uops\": " << r.kanata_rows << "}";
+    if (opts.fast_forward || !opts.fast_forward_to.empty())
+        os << ", \"fast_forward\": {\"instructions\": " << r.fast_forwarded << ", \"seconds\": " << r.fast_forward_seconds << ", \"warm\": " << (opts.warm ? "true" : "false") << "}";
+    if (opts.sample) {
+        const SamplingResult& s = r.sampling;
+        os << ", \"sampling\": {\"period\": " << opts.sampling.period << ", \"warmup\": " << opts.sampling.warmup << ", \"unit\": " << opts.sampling.unit
+           << ", \"offset\": " << opts.sampling.offset << ", \"functional_warming\": " << (opts.sampling.functional_warming ? "true" : "false")
+           << ", \"units\": " << s.units() << ", \"instructions\": " << s.instructions << ", \"fast_forwarded\": " << s.fast_forwarded
+           << ", \"detailed\": " << s.detailed << ", \"confidence\": " << opts.sampling.confidence << ", \"cpi\": " << s.mean_cpi
+           << ", \"cpi_half_width\": " << s.half_width << ", \"cpi_stddev\": " << s.stddev << ", \"ipc\": " << s.ipc()
+           << ", \"ipc_low\": " << s.ipc_low() << ", \"ipc_high\": " << s.ipc_high() << ", \"estimated_cycles\": " << s.estimated_cycles()
+           << ", \"host_seconds\": " << s.host_seconds << ", \"detailed_host_seconds\": " << s.detailed_host_seconds
+           << ", \"full_detailed_host_seconds\": " << s.full_detailed_host_seconds << ", \"host_seconds_saved\": " << s.host_seconds_saved() << "}";
+    }
+    if (!opts.restore.empty()) os << ", \"restored\": {\"file\": \"" << json_escape(opts.restore) << "\", \"cycle\": " << r.restored_cycle << ", \"seconds\": " << r.restore_seconds << "}";
+    if (!opts.save_checkpoint.empty())
+        os << ", \"checkpoint\": {\"file\": \"" << json_escape(opts.save_checkpoint) << "\", \"bytes\": " << r.checkpoint_bytes << ", \"seconds\": " << r.checkpoint_seconds << "}";
+    if (opts.check)
+        os << ", \"check\": {\"ok\": " << (r.check_ok ? "true" : "false") << ", \"uops\": " << r.checked_uops << ", \"report\": \"" << json_escape(r.check_report) << "\"}";
+    const WidthStats& w = sim.getWidthStats();
+    os << ", \"issue\": {\"slots_used\": " << w.issue_slots_used << ", \"width_bound_cycles\": " << w.issue_width_bound_cycles;
+    for (int i = 1; i < static_cast<int>(IssueStall::Count); ++i) os << ", \"" << issue_stall_name(static_cast<IssueStall>(i)) << "\": " << w.issue_slots_lost[i];
+    os << "}, \"commit\": {\"slots_used\": " << w.commit_slots_used << ", \"width_bound_cycles\": " << w.commit_width_bound_cycles;
+    for (int i = 1; i < static_cast<int>(CommitStall::Count); ++i) os << ", \"" << commit_stall_name(static_cast<CommitStall>(i)) << "\": " << w.commit_slots_lost[i];
+    os << "}, \"cdb\": {\"results\": " << w.cdb_results << ", \"width_bound_cycles\": " << w.cdb_width_bound_cycles
+       << ", \"delayed_results\": " << w.cdb_delayed_results << ", \"per_cycle\": [";
+    const PipelineStats& ps = sim.getPipelineStats();
+    for (int i = 0; i < PipelineStats::CDB_BUCKETS; ++i) os << (i ? ", " : "") << ps.cdb_per_cycle[i];
+    const TopDown t = sim.topDown();
+    os << "]}, \"topdown\": {\"slots\": " << t.total_slots << ", \"retiring\": " << t.retiring << ", \"bad_speculation\": " << t.bad_speculation
+       << ", \"frontend_bound\": " << t.frontend_bound << ", \"backend_bound\": " << t.backend_bound << ", \"backend_memory\": " << t.backend_memory
+       << ", \"backend_core\": " << t.backend_core << ", \"in_flight\": " << t.in_flight << "}";
+    os << ", \"occupancy\": {";
+    for (int i = 0; i < static_cast<int>(Structure::Count); ++i) {
+        const OccupancyHistogram& h = ps.occupancy[i];
+        os << (i ? ", " : "") << "\"" << structure_name(static_cast<Structure>(i)) << "\": {\"mean\": " << h.mean() << ", \"full\": " << h.full_fraction()
+           << ", \"operand_wait\": " << ps.operand_wait[i] << ", \"histogram\": [";
+        for (size_t k = 0; k < h.cycles.size(); ++k) os << (k ? ", " : "") << h.cycles[k];
+        os << "]}";
+    }
+    os << "}, \"fu\": {";
+    for (int i = 0; i < static_cast<int>(FuClass::Count); ++i)
+        os << (i ? ", " : "") << "\"" << fu_class_name(static_cast<FuClass>(i)) << "\": {\"busy_cycles\": " << ps.fu[i].busy_cycles << ", \"op_cycles\": " << ps.fu[i].op_cycles << "}";
+    os << "}, \"ports\": {\"select_policy\": \"" << sim.getConfig().value_string(*MachineConfig::find_field("select_policy")) << "\"";
+    for (int i = 0; i < static_cast<int>(Port::Count); ++i) {
+        const PortUsage& p = ps.ports[i];
+        os << ", \"" << port_name(static_cast<Port>(i)) << "\": {\"units\": " << p.units << ", \"mean_busy\": " << p.busy.mean() << ", \"waits\": " << p.waits;
+        if (p.units) {
+            os << ", \"utilization\": " << p.mean_utilization() << ", \"saturated\": " << p.saturated_fraction() << ", \"per_unit\": [";
+            for (int u = 0; u < p.units; ++u) os << (u ? ", " : "") << p.utilization(u);
+            os << "]";
+        }
+        os << ", \"histogram\": [";
+        for (size_t k = 0; k < p.busy.cycles.size(); ++k) os << (k ? ", " : "") << p.busy.cycles[k];
+        os << "]}";
+    }
+    os << "}";
+    const BranchUnit& bu = sim.getBranchUnit();
+    auto counters = [&](const char* name, const PredictorCounters& c) {
+        os << ", \"" << name << "\": {\"lookups\": " << c.lookups << ", \"correct\": " << c.correct << ", \"accuracy\": " << c.accuracy() << "}";
+    };
+    os << ", \"predictor\": {\"name\": \"" << bu.direction().name() << "\"";
+    counters("overall", bu.overall()); counters("direction", bu.direction().counters);
+    counters("btb", bu.btb().counters); counters("ras", bu.ras().counters);
+    os << ", \"ras_overflows\": " << bu.ras().overflows << ", \"ras_underflows\": " << bu.ras().underflows << "}";
+    const MemoryHierarchy& mh = sim.getMemoryHierarchy();
+    if (mh.enabled()) {
+        auto level = [&](const char* name, const CacheCounters& c) {
+            os << ", \"" << name << "\": {\"accesses\": " << c.accesses << ", \"hits\": " << c.hits << ", \"misses\": " << c.misses
+               << ", \"mshr_merges\": " << c.mshr_merges << ", \"mshr_full\": " << c.mshr_full << ", \"hit_rate\": " << c.hit_rate()
+               << ", \"writes\": " << c.writes << ", \"write_hits\": " << c.write_hits << ", \"writebacks\": " << c.writebacks << "}";
+        };
+        os << ", \"caches\": {\"mem_reads\": " << mh.memory_reads() << ", \"mem_writes\": " << mh.memory_writes();
+        level("l1d", mh.l1d().counters); if (mh.l2().enabled()) level("l2", mh.l2().counters);
+        const PrefetchCounters& p = mh.prefetch();
+        os << ", \"prefetch\": {\"kind\": \"" << mh.prefetcher_name() << "\", \"issued\": " << p.issued << ", \"useful\": " << p.useful
+           << ", \"late\": " << p.late << ", \"dropped\": " << p.dropped << ", \"accuracy\": " << p.accuracy()
+           << ", \"coverage\": " << p.coverage(mh.l1d().counters.misses) << "}}";
+    }
+    const LsqStats& q = sim.getLsqStats();
+    os << ", \"lsq\": {\"forwards\": " << q.forwards << ", \"speculative_loads\": " << q.speculative_loads << ", \"store_waits\": " << q.store_waits
+       << ", \"violations\": " << q.violations << ", \"replays\": " << q.replays << ", \"replayed_uops\": " << q.replayed_uops
+       << ", \"store_sets\": " << sim.getStoreSets().sets_created() << "}";
+    if (opts.profile_top >= 0) {
+        os << ", \"profile\": [";
+        const auto& prof = sim.getProfile(); bool first_row = true;
+        for (size_t i : profile_order(sim, opts.profile_top)) {
+            const InstructionProfile& p = prof[i]; const Instruction& ins = sim.program_memory[i];
+            os << (first_row ? "" : ", ") << "{\"address\": " << ins.address << ", \"line\": " << ins.line << ", \"text\": \"" << json_escape(std::string(sim.instructionText(ins)))
+               << "\", \"commits\": " << p.commits << ", \"head_stall_cycles\": " << p.head_stall_cycles << ", \"operand_wait_cycles\": " << p.operand_wait_cycles
+               << ", \"branches\": " << p.branches << ", \"mispredicts\": " << p.mispredicts << ", \"loads\": " << p.loads
+               << ", \"load_latency_cycles\": " << p.load_latency_cycles << "}";
+            first_row = false;
+        }
+        os << "]";
+    }
+    os << ", \"config\": {";
+    bool first = true;
+    for (const auto& f : MachineConfig::fields()) {
+        std::string v = sim.getConfig().value_string(f);
+        os << (first ? "" : ", ") << "\"" << f.key << "\": " << (f.names ? "\"" + v + "\"" : v); first = false;
+    }
+    os << "}";
+    const auto& regs = sim.getArchRegs();
+    os << ", \"registers\": {";
+    first = true;
+    for (int r = 0; r < NUM_GPRS; ++r) { os << (first ? "" : ", ") << "\"" << reg_name(r) << "\": " << regs.gpr[r]; first = false; }
+    os << "}, \"flags\": {\"ZF\": " << regs.ZF << ", \"SF\": " << regs.SF << ", \"OF\": " << regs.OF << "}";
+    if (opts.show_memory) {
+        os << ", \"memory\": {"; first = true;
+        sim.getMemory().for_each_word([&](int64_t a, int64_t v) { os << (first ? "" : ", ") << "\"" << a << "\": " << v; first = false; });
+        os << "}";
+    }
+    os << "}";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    CliOptions opts;
+    if (!parse_args(argc, argv, opts)) { print_usage(argv[0]); return 1; }
+    if (opts.print_config) { std::cout << opts.config.to_string(); return 0; }
+
+    std::ofstream file_out;
+    if (!opts.output_path.empty()) {
+        file_out.open(opts.output_path);
+        if (!file_out) { std::cerr << "Cannot open output file: " << opts.output_path << "\n"; return 1; }
+    }
+    std::ostream& os = opts.output_path.empty() ? std::cout : file_out;
+
+    bool json = opts.format == "json", many = opts.programs.size() > 1;
+    int exit_code = 0;
+    if (json && many) os << "[\n";
+    for (size_t i = 0; i < opts.programs.size(); ++i) {
+        PipelineSimulator sim(opts.config);
+        sim.setSpecializedCoreEnabled(!opts.generic_core);
+        sim.setCycleSkipping(opts.cycle_skipping);
+        RunResult r = run_program(opts.programs[i], opts, sim);
+        if (!r.error.empty()) exit_code = 1; else if (!r.check_ok && exit_code != 1) exit_code = 3; else if (!r.finished && exit_code == 0) exit_code = 2;
+        if (json) { print_json(os, r, sim, opts); os << (many && i + 1 < opts.programs.size() ? ",\n" : "\n"); }
+        else { if (i > 0) os << "\n"; print_text(os, r, sim, opts); }
+    }
+    if (json && many) os << "]\n";
+    return exit_code;
+}
@@ -0,0 +1,108 @@
+// Design-space sweep driver: runs every combination of a parameter grid over a set of programs on a
+// work-stealing thread pool and writes one CSV/JSON table. Row order is fixed by (point, program),
+// so the output does not depend on --threads.
+#include "sweepengine.h"
+#include "pagedmemory.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+namespace {
+
+struct SweepOptions {
+    std::string format = "csv";
+    std::string output_path;
+    unsigned threads = 0;
+    bool host_time = false, quiet = false;
+};
+
+void print_usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [options] <program.asm> [more.asm ...]\n"
+              << "  --grid FILE          swept parameters, one \"key = values\" line each\n"
+              << "  --param KEY=VALUES   add a swept parameter; VALUES is \"a,b,c\", \"lo..hi\" or \"lo..hi:step\"\n"
+              << "  --config FILE        base machine parameters for every point\n"
+              << "  --set KEY=VALUE      override one base parameter (repeatable)\n"
+              << "  --data BASE:FILE     preload FILE (raw little-endian int64 words) at BASE, BASE+8, ... (repeatable)\n"
+              << "  --max-cycles N       stop a run after N cycles (default: 100000000)\n"
+              << "  --threads N          worker threads (default: all cores)\n"
+              << "  --format csv|json    output format (default: csv)\n"
+              << "  --host-time          add host wall-clock seconds per run (not deterministic)\n"
+              << "  --quiet              no progress on stderr\n"
+              << "  -o, --output FILE    write results to FILE instead of stdout\n"
+              << "  -h, --help           show this help\n";
+}
+
+bool parse_args(int argc, char* argv[], SweepOptions& opts, SweepEngine& engine) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto need_value = [&](const char* name) -> const char* {
+            if (i + 1 >= argc) { std::cerr << "Missing value for " << name << "\n"; return nullptr; }
+            return argv[++i];
+        };
+        try {
+            if (a == "-h" || a == "--help") { print_usage(argv[0]); std::exit(0); }
+            else if (a == "--grid") { const char* v = need_value("--grid"); if (!v) return false; engine.load_grid_file(v); }
+            else if (a == "--param") {
+                const char* v = need_value("--param"); if (!v) return false;
+                std::string s = v; size_t eq = s.find('=');
+                if (eq == std::string::npos) { std::cerr << "Expected KEY=VALUES, got: " << s << "\n"; return false; }
+                engine.grid.push_back(SweepParameter::parse(s.substr(0, eq), s.substr(eq + 1)));
+            }
+            else if (a == "--config") { const char* v = need_value("--config"); if (!v) return false; engine.base_config.load_file(v); }
+            else if (a == "--set") { const char* v = need_value("--set"); if (!v) return false; engine.base_config.set_assignment(v); }
+            else if (a == "--data") {
+                const char* v = need_value("--data"); if (!v) return false;
+                std::string s = v; size_t colon = s.find(':'); char* end = nullptr;
+                long long base = colon == std::string::npos ? 0 : std::strtoll(s.c_str(), &end, 0);
+                if (colon == std::string::npos || end != s.c_str() + colon) { std::cerr << "Expected BASE:FILE, got: " << s << "\n"; return false; }
+                engine.data_images.push_back({base, PagedMemory::read_image_file(s.substr(colon + 1))});
+            }
+            else if (a == "--max-cycles") { const char* v = need_value("--max-cycles"); if (!v) return false; engine.max_cycles = std::strtoull(v, nullptr, 10); }
+            else if (a == "--threads") { const char* v = need_value("--threads"); if (!v) return false; opts.threads = static_cast<unsigned>(std::strtoul(v, nullptr, 10)); }
+            else if (a == "--format") { const char* v = need_value("--format"); if (!v) return false; opts.format = v; }
+            else if (a == "--host-time") { opts.host_time = true; }
+            else if (a == "--quiet") { opts.quiet = true; }
+            else if (a == "-o" || a == "--output") { const char* v = need_value("--output"); if (!v) return false; opts.output_path = v; }
+            else if (!a.empty() && a[0] == '-') { std::cerr << "Unknown option: " << a << "\n"; return false; }
+            else {
+                std::ifstream in(a, std::ios::binary);
+                if (!in) { std::cerr << "Cannot read program: " << a << "\n"; return false; }
+                std::stringstream ss; ss << in.rdbuf();
+                engine.programs.push_back({a, ss.str()});
+            }
+        } catch (const std::exception& e) { std::cerr << e.what() << "\n"; return false; }
+    }
+    if (opts.format != "csv" && opts.format != "json") { std::cerr << "Unknown format: " << opts.format << "\n"; return false; }
+    if (engine.programs.empty()) { std::cerr << "No program given\n"; return false; }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    SweepOptions opts; SweepEngine engine;
+    if (!parse_args(argc, argv, opts, engine)) { print_usage(argv[0]); return 1; }
+
+    std::ofstream file_out;
+    if (!opts.output_path.empty()) {
+        file_out.open(opts.output_path);
+        if (!file_out) { std::cerr << "Cannot open output file: " << opts.output_path << "\n"; return 1; }
+    }
+    std::ostream& os = opts.output_path.empty() ? std::cout : file_out;
+
+    std::mutex progress_mutex;
+    auto progress = [&progress_mutex](size_t done, size_t total) {
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        if (done == total || done % 16 == 0) std::cerr << "\r" << done << "/" << total << " runs" << (done == total ? "\n" : "") << std::flush;
+    };
+    std::vector<SweepJobResult> results = engine.run(opts.threads, opts.quiet ? std::function<void(size_t, size_t)>() : progress);
+    if (opts.format == "json") engine.write_json(os, results, opts.host_time);
+    else engine.write_csv(os, results, opts.host_time);
+
+    int exit_code = 0;
+    for (const auto& r : results) { if (!r.error.empty()) exit_code = 1; else if (!r.finished && exit_code == 0) exit_code = 2; }
+    return exit_code;
+}
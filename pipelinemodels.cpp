@@ -0,0 +1,234 @@
+#include "pipelinemodels.h"
+#include <algorithm>
+
+StateTableModel::StateTableModel(const QStringList& headers, QObject* parent) : QAbstractTableModel(parent), headers(headers) {}
+
+QVariant StateTableModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (role == Qt::DisplayRole && orientation == Qt::Horizontal && section >= 0 && section < headers.size()) return headers[section];
+    return QVariant();
+}
+
+QVariant StateTableModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= rows) return QVariant();
+    if (role == Qt::DisplayRole) return cellText(index.row(), index.column());
+    if (role == Qt::BackgroundRole) return rowBackground(index.row());
+    return QVariant();
+}
+
+bool StateTableModel::resize(int new_rows) {
+    if (new_rows == rows) return false;
+    beginResetModel(); rows = new_rows; endResetModel();
+    return true;
+}
+
+QVariant StateTableModel::stateColor(RobState s) {
+    switch (s) {
+    case RobState::Issue: return QColor("#fff3cd");
+    case RobState::Execute: return QColor("#d4edda");
+    case RobState::Write: return QColor("#cce5ff");
+    case RobState::Commit: return QColor("#f8d7da");
+    }
+    return QVariant();
+}
+
+// --- ROB ---
+RobModel::RobModel(QObject* parent) : StateTableModel({"Entry", "Busy", "Instruction", "State", "Value/Address"}, parent) {}
+
+void RobModel::refresh(const SimulationSnapshot& s) {
+    const auto& rob = s.rob;
+    const int old_head = head, old_tail = tail;
+    const bool reshaped = entries.size() != rob.size();
+    // A row is repainted only when a shown field or its head/tail marker changed.
+    auto same = [](const ReorderBufferEntry& a, const ReorderBufferEntry& b) {
+        return a.busy == b.busy && a.uop_index == b.uop_index && a.state == b.state && a.ready == b.ready
+            && a.value == b.value && a.address_result == b.address_result;
+    };
+    std::vector<char> changed(rob.size(), reshaped);
+    if (!reshaped) for (size_t i = 0; i < rob.size(); ++i) changed[i] = !same(entries[i], rob[i]);
+    sim = s.program; entries = rob; head = s.rob_head; tail = s.rob_tail;
+    for (int r : {old_head, old_tail, head, tail}) if (r < static_cast<int>(changed.size())) changed[r] = true;
+    publish(static_cast<int>(entries.size()), [&](int r) { return changed[r] != 0; });
+}
+
+QString RobModel::cellText(int row, int column) const {
+    const ReorderBufferEntry& e = entries[row];
+    switch (column) {
+    case 0: {
+        QString entry = "ROB" + QString::number(row);
+        if (row == head) entry.append(" (H)");
+        if (row == tail && e.busy) entry.append(" (T)");
+        return entry;
+    }
+    case 1: return e.busy ? "Yes" : "";
+    }
+    if (!e.busy) return "";
+    switch (column) {
+    case 2: return QString::fromStdString(sim->uopText(e.uop_index));
+    case 3: return rob_state_name(e.state);
+    default:
+        if (!e.ready) return "";
+        return sim->getMicroOp(e.uop_index).op == Opcode::STORE ? "Addr:" + QString::number(e.address_result) : QString::number(e.value);
+    }
+}
+
+QVariant RobModel::rowBackground(int row) const { return entries[row].busy ? stateColor(entries[row].state) : QVariant(); }
+
+// --- Reservation stations ---
+RsModel::RsModel(const QString& prefix, bool mul_div, QObject* parent)
+    : StateTableModel({"Name", "Busy", "Op", "Vj", "Vk", "Qj", "Qk"}, parent), prefix(prefix), mul_div(mul_div) {}
+
+void RsModel::refresh(const SimulationSnapshot& s) {
+    const auto& rs = mul_div ? s.mul_div_rs : s.alu_rs; const auto& rob = s.rob;
+    auto same = [](const ReservationStationEntry& a, const ReservationStationEntry& b) {
+        return a.busy == b.busy && a.op == b.op && a.Vj == b.Vj && a.Vk == b.Vk && a.Qj == b.Qj && a.Qk == b.Qk;
+    };
+    const bool reshaped = entries.size() != rs.size();
+    std::vector<char> changed(rs.size(), reshaped);
+    executing.resize(rs.size());
+    for (size_t i = 0; i < rs.size(); ++i) {
+        char ex = rs[i].busy && rob[rs[i].dest_rob_index].state == RobState::Execute;
+        if (!reshaped && (!same(entries[i], rs[i]) || executing[i] != ex)) changed[i] = true;
+        executing[i] = ex;
+    }
+    entries = rs;
+    publish(static_cast<int>(entries.size()), [&](int r) { return changed[r] != 0; });
+}
+
+QString RsModel::cellText(int row, int column) const {
+    const ReservationStationEntry& e = entries[row];
+    if (column == 0) return prefix + QString::number(row);
+    if (column == 1) return e.busy ? "Yes" : "";
+    if (!e.busy) return "";
+    switch (column) {
+    case 2: return opcode_name(e.op);
+    case 3: return e.Qj == -1 ? QString::number(e.Vj) : "";
+    case 4: return e.Qk == -1 ? QString::number(e.Vk) : "";
+    case 5: return e.Qj != -1 ? "ROB" + QString::number(e.Qj) : "";
+    default: return e.Qk != -1 ? "ROB" + QString::number(e.Qk) : "";
+    }
+}
+
+QVariant RsModel::rowBackground(int row) const {
+    return entries[row].busy ? stateColor(executing[row] ? RobState::Execute : RobState::Issue) : QVariant();
+}
+
+// --- LSB ---
+LsbModel::LsbModel(QObject* parent) : StateTableModel({"Name", "Busy", "Op", "Addr Rdy", "Address", "Value Rdy"}, parent) {}
+
+void LsbModel::refresh(const SimulationSnapshot& s) {
+    const auto& lsb = s.lsb; const auto& rob = s.rob;
+    auto same = [](const LoadStoreBufferEntry& a, const LoadStoreBufferEntry& b) {
+        return a.busy == b.busy && a.op == b.op && a.address_ready == b.address_ready && a.address == b.address && a.Qs == b.Qs
+            && a.wait == b.wait && a.forwarded == b.forwarded && a.forward_value == b.forward_value && a.data_ready_cycle == b.data_ready_cycle;
+    };
+    const bool reshaped = entries.size() != lsb.size();
+    std::vector<char> changed(lsb.size(), reshaped);
+    executing.resize(lsb.size());
+    for (size_t i = 0; i < lsb.size(); ++i) {
+        char ex = lsb[i].busy && rob[lsb[i].dest_rob_index].state == RobState::Execute;
+        if (!reshaped && (!same(entries[i], lsb[i]) || executing[i] != ex)) changed[i] = true;
+        executing[i] = ex;
+    }
+    entries = lsb;
+    publish(static_cast<int>(entries.size()), [&](int r) { return changed[r] != 0; });
+}
+
+QString LsbModel::cellText(int row, int column) const {
+    const LoadStoreBufferEntry& e = entries[row];
+    if (column == 0) return "LSB" + QString::number(row);
+    if (column == 1) return e.busy ? "Yes" : "";
+    if (!e.busy) return "";
+    switch (column) {
+    case 2: return opcode_name(e.op);
+    case 3: return e.address_ready ? "Rdy" : "No";
+    case 4: return e.address_ready ? QString::number(e.address) : "";
+    default:
+        if (e.is_load && e.wait == LoadWait::Mshr) return "MSHR wait";
+        if (e.is_load && e.wait != LoadWait::None) return "Wait store";
+        if (e.is_load && e.forwarded) return "Fwd " + QString::number(e.forward_value);
+        if (e.is_load && e.data_ready_cycle > 0) return "Miss, cycle " + QString::number(e.data_ready_cycle);
+        return e.Qs == -1 ? "Rdy" : "ROB" + QString::number(e.Qs);
+    }
+}
+
+QVariant LsbModel::rowBackground(int row) const {
+    return entries[row].busy ? stateColor(executing[row] ? RobState::Execute : RobState::Issue) : QVariant();
+}
+
+// --- RAT / ARF ---
+RatModel::RatModel(QObject* parent) : StateTableModel({"Register", "Destination"}, parent) {}
+
+void RatModel::refresh(const SimulationSnapshot& s) {
+    const auto& rat = s.rat; std::array<char, NUM_GPRS> changed{};
+    for (int r = 0; r < NUM_GPRS; ++r) {
+        changed[r] = rat[r].is_rob != entries[r].is_rob || rat[r].rob_index != entries[r].rob_index;
+        entries[r] = rat[r];
+    }
+    publish(NUM_GPRS, [&](int r) { return changed[r] != 0; });
+}
+
+QString RatModel::cellText(int row, int column) const {
+    if (column == 0) return reg_name(row);
+    return entries[row].is_rob ? "ROB" + QString::number(entries[row].rob_index) : "ARF";
+}
+
+RegisterModel::RegisterModel(QObject* parent) : StateTableModel({"Register", "Value"}, parent) {}
+
+void RegisterModel::refresh(const SimulationSnapshot& s) {
+    const RegisterFile& now = s.regs;
+    std::array<char, NUM_GPRS + 1> changed{};
+    for (int r = 0; r < NUM_GPRS; ++r) changed[r] = now.gpr[r] != regs.gpr[r];
+    changed[NUM_GPRS] = now.ZF != regs.ZF || now.SF != regs.SF || now.OF != regs.OF;
+    regs = now;
+    publish(NUM_GPRS + 1, [&](int r) { return changed[r] != 0; });
+}
+
+QString RegisterModel::cellText(int row, int column) const {
+    if (row == NUM_GPRS) return column == 0 ? QString("FLAGS") : QString("Z:%1 S:%2 O:%3").arg(regs.ZF).arg(regs.SF).arg(regs.OF);
+    return column == 0 ? QString(reg_name(row)) : QString::number(regs.gpr[row]);
+}
+
+// --- Memory ---
+MemoryModel::MemoryModel(QObject* parent) : StateTableModel({"Address", "Value (Decimal)"}, parent) {}
+
+void MemoryModel::refresh(const PagedMemory& mem) {
+    // The GUI's mirror of a running machine keeps the version and page stamps of the memory it copies
+    // (PagedMemory::apply_pages), so dirty pages are found the same way for the live machine and a run.
+    if (mem.version() == version_seen) { memory = &mem; return; }
+    const bool full = version_seen == ~uint64_t(0);
+    const auto& pages = mem.pages();
+    page_first_row.resize(pages.size() + 1); page_first_row[0] = 0;
+    for (size_t p = 0; p < pages.size(); ++p) {
+        int words = 0;
+        for (uint64_t w : pages[p]->written) words += popcount64(w);
+        page_first_row[p + 1] = page_first_row[p] + words;
+    }
+    memory = &mem;
+    const uint64_t since = version_seen; version_seen = mem.version();
+    // A newly written address shifts the rows: reset the model. Otherwise report only the rows of dirty pages.
+    if (resize(page_first_row.back())) return;
+    for (size_t p = 0; p < pages.size(); ++p)
+        if ((full || pages[p]->stamp > since) && page_first_row[p + 1] > page_first_row[p]) rowsChanged(page_first_row[p], page_first_row[p + 1] - 1);
+}
+
+bool MemoryModel::locate(int row, int64_t& address, int64_t& value) const {
+    if (!memory || row < 0 || row >= page_first_row.back()) return false;
+    size_t p = std::upper_bound(page_first_row.begin(), page_first_row.end(), row) - page_first_row.begin() - 1;
+    const PagedMemory::Page& page = *memory->pages()[p];
+    int k = row - page_first_row[p];
+    for (int w = 0; w < PagedMemory::WORDS / 64; ++w) {
+        uint64_t bits = page.written[w]; int n = popcount64(bits);
+        if (k >= n) { k -= n; continue; }
+        while (k-- > 0) bits &= bits - 1; // clear the low set bits up to the k-th
+        int64_t offset = w * 64 + lowest_set_bit64(bits);
+        address = page.address(offset); value = page.words[offset];
+        return true;
+    }
+    return false;
+}
+
+QString MemoryModel::cellText(int row, int column) const {
+    int64_t address = 0, value = 0;
+    if (!locate(row, address, value)) return "";
+    return QString::number(column == 0 ? address : value);
+}
@@ -0,0 +1,132 @@
+#ifndef PIPELINEMODELS_H
+#define PIPELINEMODELS_H
+
+#include <QAbstractTableModel>
+#include <QColor>
+#include <QStringList>
+#include <vector>
+#include "simulationrunner.h"
+
+// Table models behind the GUI's structure views. refresh() copies the part of the captured state a
+// table shows and emits dataChanged only for the rows that differ from the previous refresh; cells are
+// formatted on demand in data(), so a view only touches the rows it actually paints.
+class StateTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit StateTableModel(const QStringList& headers, QObject* parent = nullptr);
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override { return parent.isValid() ? 0 : rows; }
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override { return parent.isValid() ? 0 : headers.size(); }
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    static QVariant stateColor(RobState s); // row background of a busy entry
+
+protected:
+    virtual QString cellText(int row, int column) const = 0;
+    virtual QVariant rowBackground(int) const { return QVariant(); }
+    // Announces the new state: a different row count resets the model (only on reconfiguration),
+    // otherwise every run of rows with changed(row) == true becomes one dataChanged.
+    template<class Changed> void publish(int new_rows, Changed changed) {
+        if (resize(new_rows)) return;
+        for (int r = 0; r < rows;) {
+            if (!changed(r)) { ++r; continue; }
+            int first = r; while (r < rows && changed(r)) ++r;
+            rowsChanged(first, r - 1);
+        }
+    }
+    bool resize(int new_rows); // true if the row count changed (and the model was reset)
+    void rowsChanged(int first, int last) { emit dataChanged(index(first, 0), index(last, columnCount() - 1)); }
+
+private:
+    QStringList headers;
+    int rows = 0;
+};
+
+class RobModel : public StateTableModel
+{
+public:
+    explicit RobModel(QObject* parent = nullptr);
+    void refresh(const SimulationSnapshot& s);
+protected:
+    QString cellText(int row, int column) const override;
+    QVariant rowBackground(int row) const override;
+private:
+    const PipelineSimulator* sim = nullptr; // program text only (SimulationSnapshot::program)
+    std::vector<ReorderBufferEntry> entries;
+    int head = 0, tail = 0;
+};
+
+// ALU/Branch and MUL/DIV reservation stations.
+class RsModel : public StateTableModel
+{
+public:
+    RsModel(const QString& prefix, bool mul_div, QObject* parent = nullptr);
+    void refresh(const SimulationSnapshot& s);
+protected:
+    QString cellText(int row, int column) const override;
+    QVariant rowBackground(int row) const override;
+private:
+    QString prefix; bool mul_div;
+    std::vector<ReservationStationEntry> entries;
+    std::vector<char> executing; // the owning ROB entry is in the Execute state
+};
+
+class LsbModel : public StateTableModel
+{
+public:
+    explicit LsbModel(QObject* parent = nullptr);
+    void refresh(const SimulationSnapshot& s);
+protected:
+    QString cellText(int row, int column) const override;
+    QVariant rowBackground(int row) const override;
+private:
+    std::vector<LoadStoreBufferEntry> entries;
+    std::vector<char> executing;
+};
+
+class RatModel : public StateTableModel
+{
+public:
+    explicit RatModel(QObject* parent = nullptr);
+    void refresh(const SimulationSnapshot& s);
+protected:
+    QString cellText(int row, int column) const override;
+private:
+    std::array<RatEntry, NUM_GPRS> entries{};
+};
+
+// Architectural GPRs plus a FLAGS row.
+class RegisterModel : public StateTableModel
+{
+public:
+    explicit RegisterModel(QObject* parent = nullptr);
+    void refresh(const SimulationSnapshot& s);
+protected:
+    QString cellText(int row, int column) const override;
+private:
+    RegisterFile regs;
+};
+
+// Every written word of the paged data memory, in address order (misaligned words follow the aligned
+// ones of their page, see PagedMemory::pages()). Rows are located through a per-page
+// prefix count instead of a materialized list, so the view scales to millions of words; only the
+// rows of pages written since the last refresh are reported as changed.
+class MemoryModel : public StateTableModel
+{
+public:
+    explicit MemoryModel(QObject* parent = nullptr);
+    void refresh(const PagedMemory& memory);
+    void invalidate() { version_seen = ~uint64_t(0); } // the memory was cleared or reloaded
+protected:
+    QString cellText(int row, int column) const override;
+private:
+    bool locate(int row, int64_t& address, int64_t& value) const;
+
+    const PagedMemory* memory = nullptr;
+    std::vector<int> page_first_row; // first row of each page in memory->pages(), plus the total
+    uint64_t version_seen = ~uint64_t(0);
+};
+
+#endif // PIPELINEMODELS_H
@@ -1,303 +1,837 @@
 #include "pipelinesimulator.h"
+#include "eventtrace.h"
+#include "checkpoint.h"
+#include "assembler.h"
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <climits>
+#include <cstring>
 #include <vector>
 
+static const char* const REG_NAMES[NUM_REGS] = {"RAX", "RBX", "RCX", "RDX", "RSI", "RDI", "RBP", "RSP", "R8", "R9", "R10", "R11", "R12", "R13", "R14", "R15", "TMP", "FLAGS"};
+
+const char* reg_name(int reg_id) { return (reg_id >= 0 && reg_id < NUM_REGS) ? REG_NAMES[reg_id] : "?"; }
+
+int reg_id(const std::string& name) {
+    for (int i = 0; i < NUM_GPRS; ++i) { if (name == REG_NAMES[i]) return i; }
+    return -1;
+}
+
+const char* opcode_name(Opcode op) {
+    static const char* const names[] = {"ADD", "SUB", "MUL", "DIV", "AND", "OR", "XOR", "NOT", "INC", "DEC", "MOV", "LEA", "CMP",
+                                        "LOAD", "STORE", "JMP", "JZ", "JNZ", "JG", "JGE", "JL", "JLE", "JMP*"};
+    return names[static_cast<int>(op)];
+}
+
+const char* rob_state_name(RobState s) {
+    switch (s) { case RobState::Issue: return "Issue"; case RobState::Execute: return "Execute"; case RobState::Write: return "Write"; case RobState::Commit: return "Commit"; }
+    return "";
+}
+
+const char* issue_stall_name(IssueStall s) {
+    static const char* const names[] = {"none", "rob_full", "alu_rs_full", "mul_div_rs_full", "lsb_full", "program_end", "taken_branch"};
+    return names[static_cast<int>(s)];
+}
+
+const char* commit_stall_name(CommitStall s) {
+    static const char* const names[] = {"none", "rob_empty", "head_not_ready", "flush"};
+    return names[static_cast<int>(s)];
+}
+
 RegisterFile::RegisterFile() {
-    const std::vector<std::string> names = {"RAX", "RBX", "RCX", "RDX", "RSI", "RDI", "RBP", "RSP", "R8", "R9", "R10", "R11", "R12", "R13", "R14", "R15"};
-    for (const auto& n : names) { gpr[n] = 0; }
+    gpr.fill(0);
     ZF = false; SF = false; OF = false;
 }
 
 void RegisterFile::write(const std::string& reg_name, int64_t value) {
-    if(gpr.count(reg_name)) { gpr[reg_name] = value; }
+    int r = reg_id(reg_name); if (r >= 0) { gpr[r] = value; }
 }
 
-int64_t RegisterFile::read(const std::string& reg_name) {
-    if(gpr.count(reg_name)) { return gpr.at(reg_name); }
+int64_t RegisterFile::read(const std::string& reg_name) const {
+    int r = reg_id(reg_name); if (r >= 0) { return gpr[r]; }
     throw std::runtime_error("Invalid register read: " + reg_name);
 }
 
-PipelineSimulator::PipelineSimulator() {
+// Structure-size policies. With FixedShape the ROB modulus, slot offsets and loop bounds become compile-time constants.
+struct DynamicShape {
+    const MachineConfig& c;
+    int rob_size() const { return c.rob_size; }
+    int alu_rs_size() const { return c.alu_rs_size; }
+    int mul_div_rs_size() const { return c.mul_div_rs_size; }
+    int lsb_size() const { return c.lsb_size; }
+};
+template<int ROB, int ALU, int MD, int LSB> struct FixedShape {
+    explicit FixedShape(const MachineConfig&) {}
+    static constexpr int rob_size() { return ROB; }
+    static constexpr int alu_rs_size() { return ALU; }
+    static constexpr int mul_div_rs_size() { return MD; }
+    static constexpr int lsb_size() { return LSB; }
+};
+
+// Compiled-in fixed shapes (ROB, ALU RS, MUL/DIV RS, LSB). PIPELIGHT_NO_SPECIALIZED_CORE turns them off.
+#ifndef PIPELIGHT_NO_SPECIALIZED_CORE
+#define PIPELIGHT_FIXED_SHAPES(X) X(32, 6, 3, 6) X(64, 16, 8, 16) X(128, 32, 16, 32) X(256, 64, 32, 64)
+#else
+#define PIPELIGHT_FIXED_SHAPES(X)
+#endif
+
+// Event trace hooks (eventtrace.h). PIPELIGHT_NO_TRACE compiles them out; otherwise a detached trace costs one branch.
+#if defined(__GNUC__) || defined(__clang__)
+#define PIPELIGHT_UNLIKELY(cond) __builtin_expect(!!(cond), 0)
+#else
+#define PIPELIGHT_UNLIKELY(cond) (cond)
+#endif
+#ifndef PIPELIGHT_NO_TRACE
+#define PIPELIGHT_TRACE(call) do { if (PIPELIGHT_UNLIKELY(trace_ != nullptr)) trace_->call; } while (0)
+bool trace_supported() { return true; }
+#else
+#define PIPELIGHT_TRACE(call) do {} while (0)
+bool trace_supported() { return false; }
+#endif
+
+PipelineSimulator::PipelineSimulator(const MachineConfig& config) : config_(config) {
+    config_.validate();
+    select_step_function();
+    reset();
+}
+
+void PipelineSimulator::setConfig(const MachineConfig& config) {
+    config.validate();
+    config_ = config;
+    select_step_function();
     reset();
 }
 
+void PipelineSimulator::select_step_function() {
+    step_fn = &PipelineSimulator::step_impl<DynamicShape>; specialized_active = false;
+    if (!specialized_enabled) return;
+    const MachineConfig& c = config_;
+#define PIPELIGHT_SELECT_SHAPE(R, A, M, L) \
+    if (c.rob_size == R && c.alu_rs_size == A && c.mul_div_rs_size == M && c.lsb_size == L) { \
+        step_fn = &PipelineSimulator::step_impl<FixedShape<R, A, M, L>>; specialized_active = true; return; }
+    PIPELIGHT_FIXED_SHAPES(PIPELIGHT_SELECT_SHAPE)
+#undef PIPELIGHT_SELECT_SHAPE
+    (void)c;
+}
+
 void PipelineSimulator::reset() {
     cycle_count = 0; program_counter = 0; committed_ins_count = 0; mispredict_count = 0; total_branch_count = 0;
+    mispredict_penalty_cycles = 0; squashed_uop_count = 0; skipped_cycles = 0;
+    width_stats = WidthStats();
+    pipeline_stats.reset(config_); select_rng = 0x9E3779B97F4A7C15ull;
+    branch_unit = BranchUnit(config_);
+    memory_hierarchy = MemoryHierarchy(config_);
+    store_sets = StoreSetPredictor(config_.store_set_entries); lsq_stats = LsqStats();
     simulation_finished = false;
     reg_file = RegisterFile();
-    reorder_buffer.assign(ROB_SIZE, ReorderBufferEntry());
-    alu_rs.assign(ALU_RS_SIZE, ReservationStationEntry());
-    mul_div_rs.assign(MUL_DIV_RS_SIZE, ReservationStationEntry());
-    lsb.assign(LSB_SIZE, LoadStoreBufferEntry());
-    register_alias_table.clear();
-    for(const auto& p : reg_file.gpr) { register_alias_table[p.first] = {false, -1}; }
-    rob_head = 0; rob_tail = 0;
+    clear_pipeline();
     rob_head_q = 0; rob_tail_q = 0;
     data_memory.clear();
-    program_memory.clear();
+    program_memory.clear(); instruction_profile.clear();
+    micro_ops.clear(); labels.clear(); program_source.clear();
 }
 
 void PipelineSimulator::parse_and_load_program(const std::string& assembly_code) {
     reset();
-    std::stringstream ss(assembly_code);
-    std::string line;
-    uint64_t current_address = 0;
-    std::map<std::string, uint64_t> labels;
-
-    // 1. Geçiş: Etiketleri (Labels) bul ve BÜYÜK HARFE çevirerek kaydet
-    while (std::getline(ss, line)) {
-        line.erase(0, line.find_first_not_of(" \t"));
-        size_t comment_pos = line.find(';'); if (comment_pos != std::string::npos) line = line.substr(0, comment_pos);
-        line.erase(line.find_last_not_of(" \t\n\r") + 1);
-        if (line.empty() || line.rfind("//", 0) == 0) continue;
-        if (line.back() == ':') {
-            std::string label = line.substr(0, line.length() - 1);
-            std::transform(label.begin(), label.end(), label.begin(), ::toupper);
-            labels[label] = current_address;
-        } else if(!line.empty()){
-            current_address++;
+    AssembledProgram program = assemble(assembly_code, config_); // on error: AssemblyError, the simulator stays empty
+    program_source = assembly_code;
+    program_memory = std::move(program.instructions); micro_ops = std::move(program.micro_ops); labels = std::move(program.labels);
+    for (const auto& word : program.data) data_memory.write(word.first, word.second);
+    instruction_profile.assign(program_memory.size(), InstructionProfile());
+}
+
+uint64_t PipelineSimulator::instruction_to_uop(int64_t address) const {
+    if (address < 0 || static_cast<uint64_t>(address) >= program_memory.size()) return micro_ops.size();
+    return program_memory[address].first_uop;
+}
+
+void PipelineSimulator::checkpoint(CheckpointIO& io) {
+    io.pod(cycle_count); io.pod(program_counter); io.pod(simulation_finished);
+    io.pod(committed_ins_count); io.pod(mispredict_count); io.pod(total_branch_count); io.pod(skipped_cycles);
+    io.pod(mispredict_penalty_cycles); io.pod(squashed_uop_count);
+    io.pod(rob_head); io.pod(rob_tail); io.pod(rob_count); io.pod(rob_head_q); io.pod(rob_tail_q);
+    io.vec(reorder_buffer, true); io.vec(alu_rs, true); io.vec(mul_div_rs, true); io.vec(lsb, true);
+    io.vec(wakeup_head, true); io.vec(wakeup_next, true);
+    io.vec(alu_ready); io.vec(mul_div_ready); io.vec(lsb_ready);
+    io.vec(alu_free); io.vec(mul_div_free); io.vec(lsb_free); io.vec(lsb_in_flight); io.pod(select_rng);
+    io.pod(register_alias_table); io.vec(rat_checkpoints, true);
+    std::vector<CdbResult> cdb(cdb_bus.begin(), cdb_bus.end()); io.vec(cdb);
+    if (io.loading()) cdb_bus.assign(cdb.begin(), cdb.end());
+    io.pod(reg_file);
+    data_memory.checkpoint(io); memory_hierarchy.checkpoint(io); store_sets.checkpoint(io); branch_unit.checkpoint(io);
+    io.pod(lsq_stats); io.pod(width_stats); pipeline_stats.checkpoint(io); io.vec(instruction_profile, true);
+    if (io.loading() && !restored_state_valid()) throw std::runtime_error("Checkpoint is corrupt");
+}
+
+// Every index a stage will subscript with comes from the file: queue entries, ROB tags, station and micro-op
+// indices, predictor snapshots and the wakeup links. The stages also rely on the bookkeeping agreeing with the
+// busy flags (free lists, ROB head/tail/count), so a corrupt file is checked against both before it can step.
+bool PipelineSimulator::restored_state_valid() const {
+    const int rob = static_cast<int>(reorder_buffer.size());
+    auto index = [](int i, size_t n) { return i >= 0 && static_cast<size_t>(i) < n; };
+    auto tag = [&](int t) { return t == -1 || index(t, rob); }; // -1: no ROB entry
+    auto owner = [&](bool busy, int t) { return busy ? index(t, rob) : tag(t); }; // a busy entry belongs to a ROB entry
+    // The file is copied in byte-wise, so a flag byte may hold anything; only 0 and 1 are bools.
+    auto flag = [](const bool& b) { uint8_t v; std::memcpy(&v, &b, 1); return v <= 1; };
+    auto rat_valid = [&](const RegisterAliasTable& t) {
+        for (const RatEntry& r : t) if (!flag(r.is_rob) || (r.is_rob && !index(r.rob_index, rob))) return false;
+        return true;
+    };
+    // A ready or in-flight queue holds distinct busy entries; a free list holds every idle entry once.
+    auto queue_valid = [&](const auto& group, const std::vector<int>& queue, bool free_list) {
+        std::vector<bool> seen(group.size(), false);
+        for (int i : queue) {
+            if (!index(i, group.size()) || seen[i] || group[i].busy == free_list) return false;
+            seen[i] = true;
         }
-    }
+        return !free_list || queue.size() == static_cast<size_t>(std::count_if(group.begin(), group.end(), [](const auto& e) { return !e.busy; }));
+    };
 
-    ss.clear(); ss.seekg(0); current_address = 0;
-    while (std::getline(ss, line)) {
-        line.erase(0, line.find_first_not_of(" \t\n\r"));
-        size_t comment_pos = line.find(';'); if (comment_pos != std::string::npos) line = line.substr(0, comment_pos);
-        line.erase(line.find_last_not_of(" \t\n\r") + 1);
-        if (line.empty() || line.rfind("//", 0) == 0 || line.back() == ':') continue;
-
-        std::stringstream line_ss(line);
-        std::string mnemonic_str; line_ss >> mnemonic_str;
-        std::transform(mnemonic_str.begin(), mnemonic_str.end(), mnemonic_str.begin(), ::toupper);
-
-        Instruction instr;
-        instr.original_text = line; instr.mnemonic = mnemonic_str; instr.address = current_address;
-
-        std::string ops_part; std::getline(line_ss, ops_part);
-        std::vector<std::string> operands; std::stringstream ops_ss(ops_part); std::string operand;
-        while(std::getline(ops_ss, operand, ',')) {
-            operand.erase(0, operand.find_first_not_of(" \t"));
-            operand.erase(operand.find_last_not_of(" \t") + 1);
-            if (!operand.empty()) operands.push_back(operand);
+    for (const ReorderBufferEntry& e : reorder_buffer) if (!flag(e.busy)) return false;
+    for (const auto* group : {&alu_rs, &mul_div_rs}) for (const ReservationStationEntry& e : *group) if (!flag(e.busy)) return false;
+    for (const LoadStoreBufferEntry& e : lsb) if (!flag(e.busy)) return false;
+    if (!index(rob_head, rob) || rob_count < 0 || rob_count > rob || rob_tail != (rob_head + rob_count) % rob ||
+        !index(rob_head_q, rob) || !index(rob_tail_q, rob) || program_counter > micro_ops.size() ||
+        !queue_valid(alu_rs, alu_ready, false) || !queue_valid(alu_rs, alu_free, true) ||
+        !queue_valid(mul_div_rs, mul_div_ready, false) || !queue_valid(mul_div_rs, mul_div_free, true) ||
+        !queue_valid(lsb, lsb_ready, false) || !queue_valid(lsb, lsb_free, true) || !queue_valid(lsb, lsb_in_flight, false) ||
+        !rat_valid(register_alias_table))
+        return false;
+    for (int n = 0; n < rob; ++n) {
+        const ReorderBufferEntry& e = reorder_buffer[(rob_head + n) % rob];
+        if (e.busy != (n < rob_count) || (e.lsb_index != -1 && !index(e.lsb_index, lsb.size())) || !tag(e.load_source) ||
+            !branch_unit.ras().holds(e.bp.ras_top, e.bp.ras_depth))
+            return false;
+        // A busy entry names its micro-op and, for a load or store, its LSB entry.
+        if (e.busy && (e.uop_index >= micro_ops.size() || (micro_ops[e.uop_index].fu == FUKind::MEMORY && e.lsb_index == -1))) return false;
+    }
+    for (const auto* group : {&alu_rs, &mul_div_rs})
+        for (const ReservationStationEntry& e : *group) if (!tag(e.Qj) || !tag(e.Qk) || !owner(e.busy, e.dest_rob_index)) return false;
+    for (const LoadStoreBufferEntry& e : lsb) if (!tag(e.Q_addr) || !tag(e.Qs) || !owner(e.busy, e.dest_rob_index)) return false;
+    for (const RegisterAliasTable& t : rat_checkpoints) if (!rat_valid(t)) return false;
+    for (const CdbResult& r : cdb_bus) if (!index(r.rob_index, rob)) return false;
+    // Each wakeup list must end: every link stays inside wakeup_next and a slot is linked at most once.
+    for (int next : wakeup_next) if (next != -1 && !index(next, wakeup_next.size())) return false;
+    std::vector<bool> linked(wakeup_next.size(), false);
+    for (int slot : wakeup_head) {
+        for (; slot != -1; slot = wakeup_next[slot]) {
+            if (!index(slot, wakeup_next.size()) || linked[slot]) return false;
+            linked[slot] = true;
         }
-        for(auto& op : operands) { std::transform(op.begin(), op.end(), op.begin(), ::toupper); }
-
-        try {
-            auto m = instr.mnemonic;
-            if (m == "ADD" || m == "SUB" || m == "MUL" || m == "DIV" || m == "AND" || m == "OR" || m == "XOR") {
-                if (operands.size() < 2 || operands.size() > 3) throw std::runtime_error("requires 2 or 3 operands");
-                instr.dest_reg = operands[0];
-                if (operands.size() == 2) { instr.src_reg1 = operands[0]; try { instr.immediate_val = std::stoll(operands[1]); } catch (...) { instr.src_reg2_base = operands[1]; } }
-                else { instr.src_reg1 = operands[1]; try { instr.immediate_val = std::stoll(operands[2]); } catch (...) { instr.src_reg2_base = operands[2]; } }
-            } else if (m == "CMP") {
-                if (operands.size() != 2) throw std::runtime_error("requires 2 ops");
-                instr.src_reg1 = operands[0]; try { instr.immediate_val = std::stoll(operands[1]); } catch(...) { instr.src_reg2_base = operands[1]; }
-            } else if (m == "MOV") {
-                if (operands.size() != 2) throw std::runtime_error("requires 2 ops");
-                instr.dest_reg = operands[0];
-                try { instr.immediate_val = std::stoll(operands[1]); } catch(...) { instr.src_reg1 = operands[1]; }
-            } else if (m == "LEA") {
-                if (operands.size() != 2) throw std::runtime_error("requires 2 ops");
-                instr.dest_reg = operands[0];
-                if (operands[1].front() != '[') throw std::runtime_error("LEA needs memory operand [reg+imm]");
-                std::string mem_op = operands[1].substr(1, operands[1].length() - 2);
-                size_t p = mem_op.find('+'); if (p == std::string::npos) throw std::runtime_error("[REG+IMM] format");
-                instr.src_reg1 = mem_op.substr(0, p);
-                instr.src_reg2_base = instr.src_reg1;
-                instr.immediate_val = std::stoll(mem_op.substr(p + 1));
-            } else if (m == "LOAD" || m == "STORE") {
-                if (operands.size() != 2) throw std::runtime_error("requires 2 ops");
-                if (operands[1].front() != '[') throw std::runtime_error("memory op needs [ ]");
-                std::string mem_op = operands[1].substr(1, operands[1].length() - 2);
-                size_t p = mem_op.find('+'); if (p == std::string::npos) throw std::runtime_error("[REG+IMM] format");
-                instr.src_reg2_base = mem_op.substr(0, p);
-                instr.immediate_val = std::stoll(mem_op.substr(p + 1));
-                if (m=="LOAD") instr.dest_reg = operands[0]; else instr.src_reg1 = operands[0];
-            } else if (m == "INC" || m == "DEC" || m == "NOT" || m == "PUSH" || m == "POP") {
-                if (operands.size() != 1) throw std::runtime_error("req 1 op");
-                instr.src_reg1 = operands[0]; if(m!="PUSH") instr.dest_reg = operands[0];
-            } else if (m.front() == 'J' || m == "CALL") {
-                if (operands.size() != 1) throw std::runtime_error("req 1 op (label)");
-                instr.is_branch = true; instr.branch_label = operands[0];
-                if (labels.count(*instr.branch_label)) { instr.target_address = labels.at(*instr.branch_label); }
-                else { throw std::runtime_error("Label not found: " + *instr.branch_label); }
-            } else if (m == "RET") { if (!operands.empty()) throw std::runtime_error("RET no ops"); instr.is_branch = true;
-            }
-        } catch (const std::exception& e) { throw std::runtime_error("Parse Error '" + line + "': " + e.what()); }
-        program_memory.push_back(instr);
-        current_address++;
     }
+    return true;
+}
+
+int64_t PipelineSimulator::labelAddress(const std::string& label) const {
+    std::string key = label;
+    std::transform(key.begin(), key.end(), key.begin(), ::toupper);
+    auto it = labels.find(key);
+    return it == labels.end() ? -1 : static_cast<int64_t>(it->second);
+}
+
+const RatEntry& PipelineSimulator::getRATEntry(const std::string& reg_name) const {
+    int r = reg_id(reg_name); if (r >= 0) { return register_alias_table[r]; }
+    throw std::runtime_error("Invalid register: " + reg_name);
+}
+
+std::string PipelineSimulator::uopText(uint32_t uop_index) const {
+    const Instruction& instr = instructionOf(uop_index);
+    std::string text(instructionText(instr));
+    if (instr.uop_count <= 1) return text;
+    return text + " [" + std::to_string(uop_index - instr.first_uop + 1) + "/" + std::to_string(instr.uop_count) + "]";
 }
 
 bool PipelineSimulator::is_finished() const {
     if (simulation_finished) return true;
-    bool rob_is_empty = true;
-    for(const auto& entry : reorder_buffer) { if (entry.busy) { rob_is_empty = false; break; } }
-    return rob_is_empty && (program_counter >= program_memory.size());
+    return rob_count == 0 && (program_counter >= micro_ops.size());
 }
 void PipelineSimulator::step() {
     if (is_finished()) { simulation_finished = true; return; }
-    cycle_count++; cdb_bus.clear();
-    do_commit(); do_write_result(); do_execute(); do_issue();
+    (this->*step_fn)();
+}
+uint64_t PipelineSimulator::advance(uint64_t cycle_limit) {
+    if (is_finished()) { simulation_finished = true; return 0; }
+    if (cycle_skipping && cycle_count < cycle_limit) {
+        uint64_t n = std::min(idle_cycles_ahead(), cycle_limit - cycle_count);
+        if (n > 0) { skip_idle_cycles(n); return n; }
+    }
+    (this->*step_fn)();
+    return 1;
+}
+
+uint64_t PipelineSimulator::drain() {
+    const uint64_t start = cycle_count;
+    fetch_stopped = true;
+    while (rob_count > 0) advance();
+    fetch_stopped = false;
+    return cycle_count - start;
+}
+
+// Number of upcoming cycles in which nothing but FU countdowns can happen: the head cannot commit,
+// no result waits for the CDB, every ready LSB entry is a load still waiting (MSHR or older store), the next
+// micro-op cannot dispatch, no ready RS entry waits for a unit it could get (only DIVs behind busy
+// dividers may wait), and no RS entry, cache miss or MSHR finishes before then. 0 if the next cycle does
+// real work.
+uint64_t PipelineSimulator::idle_cycles_ahead() const {
+    const auto& head = reorder_buffer[rob_head];
+    if ((head.busy && head.ready) || !cdb_bus.empty()) return 0;
+    bool mshr_waits = false;
+    for (int i : lsb_ready) {
+        const LoadWait w = lsb[i].wait;
+        if (w == LoadWait::None || w == LoadWait::Port) return 0;
+        mshr_waits |= w == LoadWait::Mshr;
+        // A store after the load in order may have resolved its address this cycle: is the wait over?
+        int source; bool speculative;
+        if (w != LoadWait::Mshr && find_store_source(i, source, speculative) != w) return 0;
+    }
+    if (program_counter < micro_ops.size() && !fetch_stopped && !reorder_buffer[rob_tail].busy && dispatch_stall(static_cast<uint32_t>(program_counter)) == IssueStall::None) return 0;
+    uint64_t next_event = UINT64_MAX; int divs = 0; bool div_waits = false;
+    for (int i : alu_ready) { if (config_.alu_units && !started(alu_rs[i])) return 0; next_event = std::min(next_event, cycle_count + alu_rs[i].cycles_remaining); }
+    for (int i : mul_div_ready) {
+        const auto& e = mul_div_rs[i]; const bool div = e.op == Opcode::DIV;
+        if (!started(e) && (div ? config_.div_units : config_.mul_units)) { if (!div) return 0; div_waits = true; continue; }
+        divs += div; next_event = std::min(next_event, cycle_count + e.cycles_remaining);
+    }
+    if (div_waits && divs < config_.div_units) return 0;
+    for (int i : lsb_in_flight) next_event = std::min(next_event, lsb[i].data_ready_cycle);
+    if (mshr_waits) next_event = std::min(next_event, memory_hierarchy.next_mshr_free(cycle_count));
+    // Other loads waiting for a store are released by that store executing or committing, which is never idle.
+    if (next_event == UINT64_MAX) return 0; // no event pending: advance with a normal step
+    return next_event > cycle_count + 1 ? next_event - cycle_count - 1 : 0;
+}
+
+// Bulk equivalent of n idle step() calls: same counters, same stall accounting. Ready RS entries that have
+// not started take their (unlimited) unit in the first skipped cycle; DIVs waiting for a divider keep waiting.
+void PipelineSimulator::skip_idle_cycles(uint64_t n) {
+    auto start = [&](std::vector<ReservationStationEntry>& group, int i) {
+        group[i].cycles_remaining -= static_cast<int>(n);
+        auto& rob = reorder_buffer[group[i].dest_rob_index];
+        if (rob.state != RobState::Execute) PIPELIGHT_TRACE(executeStart(cycle_count + 1, group[i].dest_rob_index, rob.uop_index));
+        rob.state = RobState::Execute;
+    };
+    int alu_new = 0, mul_new = 0, divs = 0, div_waits = 0;
+    for (int i : alu_ready) { alu_new += !started(alu_rs[i]); start(alu_rs, i); }
+    for (int i : mul_div_ready) {
+        const bool div = mul_div_rs[i].op == Opcode::DIV;
+        if (!started(mul_div_rs[i])) { if (div && config_.div_units) { div_waits++; continue; } mul_new += !div; }
+        divs += div; start(mul_div_rs, i);
+    }
+    IssueStall is = program_counter >= micro_ops.size() || fetch_stopped ? IssueStall::ProgramEnd
+                  : reorder_buffer[rob_tail].busy ? IssueStall::RobFull : dispatch_stall(static_cast<uint32_t>(program_counter));
+    CommitStall cs = reorder_buffer[rob_head].busy ? CommitStall::HeadNotReady : CommitStall::RobEmpty;
+    if (cs == CommitStall::HeadNotReady) profile_of(rob_head).head_stall_cycles += n;
+    charge_issue_stall(is, n * config_.issue_width);
+    width_stats.commit_slots_lost[static_cast<int>(cs)] += n * config_.commit_width;
+    PipelineStats& ps = pipeline_stats;
+    auto busy = [&](FuClass c, size_t ops) { if (ops) { ps.fu[static_cast<int>(c)].busy_cycles += n; ps.fu[static_cast<int>(c)].op_cycles += n * ops; } };
+    busy(FuClass::Alu, alu_ready.size()); busy(FuClass::MulDiv, mul_div_ready.size() - div_waits); busy(FuClass::Memory, lsb_in_flight.size());
+    ps.use_port(Port::Alu, alu_new); ps.use_port(Port::Alu, 0, 0, n - 1);
+    ps.use_port(Port::Mul, mul_new); ps.use_port(Port::Mul, 0, 0, n - 1);
+    ps.use_port(Port::Div, divs, div_waits, n);
+    for (Port p : {Port::Agu, Port::Load, Port::Store, Port::Writeback}) ps.use_port(p, 0, 0, n);
+    ps.cdb_per_cycle[0] += n;
+    sample_occupancy(n);
+    cycle_count += n; skipped_cycles += n;
     rob_head_q = rob_head; rob_tail_q = rob_tail;
+    PIPELIGHT_TRACE(endCycle(*this));
+}
+
+// Backend-bound slots are charged to memory when the ROB head is a load still waiting for its data (or
+// the LSB is full), to the core otherwise.
+void PipelineSimulator::charge_issue_stall(IssueStall stall, uint64_t lost_slots) {
+    width_stats.issue_slots_lost[static_cast<int>(stall)] += lost_slots;
+    if (stall < IssueStall::RobFull || stall > IssueStall::LsbFull) return;
+    const auto& head = reorder_buffer[rob_head];
+    bool memory = stall == IssueStall::LsbFull || (head.busy && !head.ready && micro_ops[head.uop_index].op == Opcode::LOAD);
+    (memory ? pipeline_stats.backend_memory_slots : pipeline_stats.backend_core_slots) += lost_slots;
+}
+
+void PipelineSimulator::sample_occupancy(uint64_t cycles) {
+    PipelineStats& ps = pipeline_stats;
+    const int alu_busy = static_cast<int>(alu_rs.size() - alu_free.size()), md_busy = static_cast<int>(mul_div_rs.size() - mul_div_free.size());
+    ps.occupancy[static_cast<int>(Structure::Rob)].add(rob_count, cycles);
+    ps.occupancy[static_cast<int>(Structure::AluRs)].add(alu_busy, cycles);
+    ps.occupancy[static_cast<int>(Structure::MulDivRs)].add(md_busy, cycles);
+    ps.occupancy[static_cast<int>(Structure::Lsb)].add(static_cast<int>(lsb.size() - lsb_free.size()), cycles);
+    // Busy RS entries that are not in a ready queue are waiting for an operand.
+    ps.operand_wait[static_cast<int>(Structure::AluRs)] += cycles * (alu_busy - alu_ready.size());
+    ps.operand_wait[static_cast<int>(Structure::MulDivRs)] += cycles * (md_busy - mul_div_ready.size());
+}
+
+TopDown PipelineSimulator::topDown() const {
+    const WidthStats& w = width_stats; TopDown t;
+    t.total_slots = cycle_count * config_.issue_width;
+    t.retiring = w.commit_slots_used;
+    t.bad_speculation = squashed_uop_count + lsq_stats.replayed_uops;
+    t.in_flight = w.issue_slots_used - t.retiring - t.bad_speculation; // still in the ROB
+    t.frontend_bound = w.issue_slots_lost[static_cast<int>(IssueStall::TakenBranch)] + w.issue_slots_lost[static_cast<int>(IssueStall::ProgramEnd)];
+    t.backend_memory = pipeline_stats.backend_memory_slots; t.backend_core = pipeline_stats.backend_core_slots;
+    t.backend_bound = t.backend_memory + t.backend_core;
+    return t;
+}
+
+template<class Shape> void PipelineSimulator::step_impl() {
+    Shape sh{config_};
+    cycle_count++;
+    do_commit(sh); do_write_result(sh); do_execute(sh); do_issue(sh);
+    sample_occupancy(1);
+    rob_head_q = rob_head; rob_tail_q = rob_tail;
+    PIPELIGHT_TRACE(endCycle(*this));
+}
+void PipelineSimulator::clear_pipeline() {
+    const MachineConfig& c = config_;
+    reorder_buffer.assign(c.rob_size, ReorderBufferEntry());
+    alu_rs.assign(c.alu_rs_size, ReservationStationEntry());
+    mul_div_rs.assign(c.mul_div_rs_size, ReservationStationEntry());
+    lsb.assign(c.lsb_size, LoadStoreBufferEntry());
+    register_alias_table.fill({false, -1}); // flat array: a single memcpy-sized operation
+    rat_checkpoints.resize(c.rob_size);
+    rob_head = 0; rob_tail = 0; rob_count = 0;
+    cdb_bus.clear();
+    wakeup_head.assign(c.rob_size, -1);
+    wakeup_next.assign(2 * (c.alu_rs_size + c.mul_div_rs_size + c.lsb_size), -1);
+    alu_ready.clear(); mul_div_ready.clear(); lsb_ready.clear(); lsb_in_flight.clear();
+    // Free lists are kept as stacks; the lowest index is handed out first.
+    auto fill_free = [](std::vector<int>& free_list, int n) { free_list.clear(); for (int i = n - 1; i >= 0; --i) free_list.push_back(i); };
+    fill_free(alu_free, c.alu_rs_size); fill_free(mul_div_free, c.mul_div_rs_size); fill_free(lsb_free, c.lsb_size);
 }
 void PipelineSimulator::handle_branch_misprediction(uint64_t correct_target_pc) {
-    mispredict_count++; program_counter = correct_target_pc;
-    reorder_buffer.assign(ROB_SIZE, ReorderBufferEntry());
-    alu_rs.assign(ALU_RS_SIZE, ReservationStationEntry());
-    mul_div_rs.assign(MUL_DIV_RS_SIZE, ReservationStationEntry());
-    lsb.assign(LSB_SIZE, LoadStoreBufferEntry());
-    register_alias_table.clear();
-    for(const auto& p : reg_file.gpr) { register_alias_table[p.first] = {false, -1}; }
-    rob_head = 0; rob_tail = 0;
-}
-void PipelineSimulator::do_issue() {
-    if (reorder_buffer[rob_tail].busy || program_counter >= program_memory.size()) return;
-    dispatch_instruction(program_memory[program_counter]);
-}
-
-void PipelineSimulator::dispatch_instruction(const Instruction& instr) {
-    auto m = instr.mnemonic;
-    if ((m=="ADD"||m=="SUB"||m=="INC"||m=="DEC"||m=="AND"||m=="OR"||m=="XOR"||m=="NOT"||m=="LEA"||m=="CMP"||m.front()=='J'||m=="CALL"||m=="RET") && !std::any_of(alu_rs.begin(), alu_rs.end(), [](const auto& rs){ return !rs.busy; })) return;
-    if ((m=="MUL"||m=="DIV") && !std::any_of(mul_div_rs.begin(), mul_div_rs.end(), [](const auto& rs){ return !rs.busy; })) return;
-    if ((m=="LOAD"||m=="STORE"||m=="PUSH"||m=="POP") && !std::any_of(lsb.begin(), lsb.end(), [](const auto& l){ return !l.busy; })) return;
+    squashed_uop_count += rob_count; program_counter = correct_target_pc;
+#ifndef PIPELIGHT_NO_TRACE
+    if (trace_) {
+        const int size = static_cast<int>(reorder_buffer.size()), branch = (rob_head - 1 + size) % size;
+        for (int n = rob_count - 1; n >= 0; --n) { int r = (rob_head + n) % size; trace_->flush(cycle_count, r, reorder_buffer[r].uop_index, 0); }
+        trace_->flush(cycle_count, branch, reorder_buffer[branch].uop_index, 0);
+    }
+#endif
+    clear_pipeline();
+}
 
-    int rob_idx = rob_tail;
-    ReservationStationEntry* rs = nullptr;
+bool PipelineSimulator::resolve_branch(int rob_idx, int64_t operand) {
+    auto& rob = reorder_buffer[rob_idx]; const MicroOp& u = micro_ops[rob.uop_index];
+    // Conditional branches take the packed flags as their operand, JMP* the target instruction address.
+    bool taken = branch_taken(u.op, operand & 1, operand & 2, operand & 4);
+    uint64_t target = (u.op == Opcode::JMP_IND) ? instruction_to_uop(operand) : u.target;
+    rob.branch_taken_actual = taken;
+    rob.resolved_next = taken ? target : rob.uop_index + 1;
+    rob.mispredicted = rob.resolved_next != rob.predicted_next;
+    return rob.mispredicted;
+}
 
-    reorder_buffer[rob_idx] = {}; reorder_buffer[rob_idx].busy = true;
-    reorder_buffer[rob_idx].instruction = instr; reorder_buffer[rob_idx].state = "Issue";
-
-    if (m=="ADD"||m=="SUB"||m=="AND"||m=="OR"||m=="XOR"||m=="NOT"||m=="LEA"||m=="INC"||m=="DEC"||m=="CMP" || m.front() == 'J' || m == "RET" || m == "CALL") {
-        rs = &(*std::find_if(alu_rs.begin(), alu_rs.end(), [](const auto& r){ return !r.busy; }));
-        *rs = {}; rs->busy = true; rs->op = m; rs->dest_rob_index = rob_idx; rs->cycles_remaining = ALU_LATENCY;
-    } else if (m=="MUL") {
-        rs = &(*std::find_if(mul_div_rs.begin(), mul_div_rs.end(), [](const auto& r){ return !r.busy; }));
-        *rs = {}; rs->busy = true; rs->op = m; rs->dest_rob_index = rob_idx; rs->cycles_remaining = MUL_LATENCY;
-    } else if (m=="DIV") {
-        rs = &(*std::find_if(mul_div_rs.begin(), mul_div_rs.end(), [](const auto& r){ return !r.busy; }));
-        *rs = {}; rs->busy = true; rs->op = m; rs->dest_rob_index = rob_idx; rs->cycles_remaining = DIV_LATENCY;
+// Drops the ROB entries from age `keep` (0 = head) on, with their RS/LSB entries, wakeup links and
+// pending CDB results. Older in-flight work is untouched. Returns the number of dropped entries.
+template<class Shape> int PipelineSimulator::squash_from(const Shape& sh, int keep) {
+    const int size = sh.rob_size();
+    for (int n = rob_count - 1; n >= keep; --n) {
+        int r = (rob_head + n) % size;
+        PIPELIGHT_TRACE(flush(cycle_count, r, reorder_buffer[r].uop_index, rob_head));
+        reorder_buffer[r] = ReorderBufferEntry();
     }
+    const int dropped = rob_count - keep;
+    rob_count = keep; rob_tail = (rob_head + keep) % size;
 
-    if(rs) { // Komut bir RS kullanıyorsa
-        if(instr.src_reg1) {
-            auto& rat = register_alias_table.at(*instr.src_reg1);
-            if(rat.is_rob) { if(reorder_buffer[rat.rob_index].ready) { rs->Vj = reorder_buffer[rat.rob_index].value; rs->Qj = -1; } else { rs->Qj = rat.rob_index; } }
-            else { rs->Vj = reg_file.read(*instr.src_reg1); rs->Qj = -1; }
-        } else { rs->Vj = instr.immediate_val.value_or(0); rs->Qj = -1; }
-        if(instr.src_reg2_base) {
-            auto& rat = register_alias_table.at(*instr.src_reg2_base);
-            if(rat.is_rob) { if(reorder_buffer[rat.rob_index].ready) { rs->Vk = reorder_buffer[rat.rob_index].value; rs->Qk = -1; } else { rs->Qk = rat.rob_index; } }
-            else { rs->Vk = reg_file.read(*instr.src_reg2_base); rs->Qk = -1; }
-        } else if (instr.immediate_val && (m!="MOV"&&m!="LEA"&&m!="INC"&&m!="DEC"&&m!="NOT")) { rs->Vk = *instr.immediate_val; rs->Qk = -1; }
-    } else if (m=="LOAD"||m=="STORE"||m=="PUSH"||m=="POP") {
-        auto it = std::find_if(lsb.begin(), lsb.end(), [](const auto& l){ return !l.busy; });
-        *it = {}; it->busy = true; it->op = instr.mnemonic; it->dest_rob_index = rob_idx;
-        it->is_load = (m=="LOAD"||m=="POP");
-        if(m=="PUSH"||m=="POP"){ it->V_addr = reg_file.read("RSP"); it->Q_addr = -1; }
-        else {
-            auto& rat_base = register_alias_table.at(*instr.src_reg2_base);
-            if(rat_base.is_rob) { if(reorder_buffer[rat_base.rob_index].ready) { it->V_addr = reorder_buffer[rat_base.rob_index].value; it->Q_addr = -1; } else { it->Q_addr = rat_base.rob_index; } }
-            else { it->V_addr = reg_file.read(*instr.src_reg2_base); it->Q_addr = -1; }
-            it->addr_offset = *instr.immediate_val;
+    auto squashed = [&](int rob_index) { return !reorder_buffer[rob_index].busy; };
+    auto drop = [&](auto& group, std::vector<int>& ready, std::vector<int>& free_list) {
+        for (auto& e : group) if (e.busy && squashed(e.dest_rob_index)) e.busy = false;
+        ready.erase(std::remove_if(ready.begin(), ready.end(), [&](int i) { return !group[i].busy; }), ready.end());
+        free_list.clear();
+        for (int i = static_cast<int>(group.size()) - 1; i >= 0; --i) if (!group[i].busy) free_list.push_back(i);
+    };
+    drop(alu_rs, alu_ready, alu_free); drop(mul_div_rs, mul_div_ready, mul_div_free); drop(lsb, lsb_ready, lsb_free);
+    lsb_in_flight.erase(std::remove_if(lsb_in_flight.begin(), lsb_in_flight.end(), [&](int i) { return !lsb[i].busy; }), lsb_in_flight.end());
+
+    // Unlink the squashed consumers from the wakeup lists; the order is kept.
+    const int md_base = mul_div_slot(sh, 0), lsb_base = lsb_slot(sh, 0);
+    auto slot_live = [&](int slot) {
+        if (slot < md_base) return alu_rs[slot / 2].busy;
+        if (slot < lsb_base) return mul_div_rs[(slot - md_base) / 2].busy;
+        return lsb[(slot - lsb_base) / 2].busy;
+    };
+    for (int tag = 0; tag < size; ++tag) {
+        int* link = &wakeup_head[tag];
+        while (*link != -1) {
+            int slot = *link;
+            if (!squashed(tag) && slot_live(slot)) link = &wakeup_next[slot];
+            else { *link = wakeup_next[slot]; wakeup_next[slot] = -1; }
         }
-        if(m=="STORE"||m=="PUSH") {
-            if (instr.src_reg1) {
-                auto& rat_val = register_alias_table.at(*instr.src_reg1);
-                if(rat_val.is_rob) { if(reorder_buffer[rat_val.rob_index].ready) { it->Vs = reorder_buffer[rat_val.rob_index].value; it->Qs = -1;} else { it->Qs = rat_val.rob_index; } }
-                else { it->Vs = reg_file.read(*instr.src_reg1); it->Qs = -1; }
-            }
+    }
+    cdb_bus.erase(std::remove_if(cdb_bus.begin(), cdb_bus.end(), [&](const CdbResult& r) { return squashed(r.rob_index); }), cdb_bus.end());
+    return dropped;
+}
+
+// Selective recovery: squashes everything younger than the branch, restores the RAT from the branch's
+// checkpoint and redirects fetch.
+template<class Shape> void PipelineSimulator::squash_younger_than(const Shape& sh, int rob_idx) {
+    squashed_uop_count += squash_from(sh, rob_age(rob_idx) + 1);
+    auto squashed = [&](int rob_index) { return !reorder_buffer[rob_index].busy; };
+
+    // If a ROB tag in the checkpoint has retired since, the value is now in the architectural register.
+    register_alias_table = rat_checkpoints[rob_idx];
+    for (auto& e : register_alias_table) if (e.is_rob && squashed(e.rob_index)) e = {false, -1};
+
+    auto& br = reorder_buffer[rob_idx]; const MicroOp& u = micro_ops[br.uop_index];
+    branch_unit.recover(u.branch_class, br.uop_index, br.bp, br.branch_taken_actual);
+    program_counter = br.resolved_next; br.recovery_cycle = cycle_count;
+}
+
+// Memory-order violation: the load and everything younger are squashed and fetched again. There is no
+// RAT checkpoint at a load, so the RAT is rebuilt from the surviving ROB entries; the predictor is
+// rewound to the oldest squashed branch.
+template<class Shape> void PipelineSimulator::replay_load(const Shape& sh, int rob_idx) {
+    const int size = sh.rob_size(), keep = rob_age(rob_idx);
+    for (int n = keep; n < rob_count; ++n) {
+        const auto& e = reorder_buffer[(rob_head + n) % size];
+        if (is_branch_op(micro_ops[e.uop_index].op)) { branch_unit.rewind(e.bp); break; }
+    }
+    const uint32_t load_uop = reorder_buffer[rob_idx].uop_index;
+    lsq_stats.replays++; lsq_stats.replayed_uops += squash_from(sh, keep);
+    register_alias_table.fill({false, -1});
+    for (int n = 0; n < rob_count; ++n) {
+        int r = (rob_head + n) % size; const MicroOp& u = micro_ops[reorder_buffer[r].uop_index];
+        if (u.dst != NO_REG) register_alias_table[u.dst] = {true, r};
+    }
+    program_counter = load_uop;
+}
+
+// Store-queue search for a load whose address is known: the youngest older store to the same address
+// is its source (-1: memory). Older stores with unknown addresses make the load wait (conservative,
+// or a predicted store-set dependence) or let it go ahead speculatively.
+LoadWait PipelineSimulator::find_store_source(int lsb_idx, int& source, bool& speculative) const {
+    const auto& l = lsb[lsb_idx]; const int age = rob_age(l.dest_rob_index);
+    const bool use_sets = config_.memory_dependence == 2;
+    const uint32_t set = use_sets ? store_sets.set_of(reorder_buffer[l.dest_rob_index].uop_index) : 0;
+    int source_age = -1, unresolved_age = -1; source = -1;
+    for (int j = 0; j < static_cast<int>(lsb.size()); ++j) {
+        const auto& s = lsb[j];
+        if (!s.busy || s.is_load) continue;
+        const int s_age = rob_age(s.dest_rob_index);
+        if (s_age >= age) continue;
+        if (!s.address_ready) {
+            if (config_.memory_dependence == 0 || (set && store_sets.set_of(reorder_buffer[s.dest_rob_index].uop_index) == set)) return LoadWait::StoreAddress;
+            unresolved_age = std::max(unresolved_age, s_age);
+        } else if (s.address == l.address && s_age > source_age) { source = j; source_age = s_age; }
+    }
+    speculative = unresolved_age > source_age;
+    return source >= 0 && lsb[source].Qs != -1 ? LoadWait::StoreData : LoadWait::None;
+}
+
+// Called when a store's address becomes known: the oldest younger load that already read the same
+// address from something older than this store (memory or an older store) read a stale value.
+int PipelineSimulator::find_violation(int store_lsb_idx) {
+    const auto& s = lsb[store_lsb_idx]; const int size = static_cast<int>(reorder_buffer.size());
+    const int s_age = rob_age(s.dest_rob_index);
+    for (int n = s_age + 1; n < rob_count; ++n) {
+        const auto& e = reorder_buffer[(rob_head + n) % size];
+        if (!e.load_performed || e.address_result != s.address) continue;
+        int src_age = e.load_source < 0 ? -1 : rob_age(e.load_source);
+        if (src_age >= n) src_age = -1; // the source store has already retired: same as memory
+        if (src_age < s_age) {
+            lsq_stats.violations++;
+            store_sets.record_violation(e.uop_index, reorder_buffer[s.dest_rob_index].uop_index);
+            return (rob_head + n) % size;
         }
     }
+    return -1;
+}
+template<class Shape> void PipelineSimulator::do_issue(const Shape& sh) {
+    // In-group dependences: each micro-op updates the RAT in order, so later micro-ops in the same
+    // cycle see the ROB tag of the earlier producer.
+    const int width = config_.issue_width; int issued = 0; IssueStall stall = IssueStall::None;
+    while (issued < width) {
+        if (program_counter >= micro_ops.size() || fetch_stopped) { stall = IssueStall::ProgramEnd; break; }
+        if (reorder_buffer[rob_tail].busy) { stall = IssueStall::RobFull; break; }
+        uint64_t pc = program_counter;
+        stall = dispatch_instruction(sh, static_cast<uint32_t>(pc));
+        if (stall != IssueStall::None) break;
+        issued++;
+        // A fetch group ends at a branch predicted taken.
+        if (program_counter != pc + 1) { stall = IssueStall::TakenBranch; break; }
+    }
+    width_stats.issue_slots_used += issued;
+    if (issued == width) width_stats.issue_width_bound_cycles++;
+    else charge_issue_stall(stall, width - issued);
+}
 
-    if (instr.dest_reg) { register_alias_table.at(*instr.dest_reg) = {true, rob_idx}; }
-    if(m=="PUSH"||m=="POP"||m=="CALL"||m=="RET") {register_alias_table["RSP"]={true,rob_idx};}
-
-    bool predicted_taken = instr.is_branch && (!instr.branch_label || instr.target_address < instr.address);
-    if(m=="JMP"||m=="CALL"||m=="RET") predicted_taken=true;
-    program_counter = (instr.is_branch && predicted_taken) ? instr.target_address : program_counter + 1;
-    rob_tail = (rob_tail + 1) % ROB_SIZE;
-}
-void PipelineSimulator::do_execute() {
-    auto execute_rs = [&](auto& rs_group, FUKind fu) {
-        for (auto& rs : rs_group) {
-            if (rs.busy && rs.Qj == -1 && rs.Qk == -1) {
-                if (rs.cycles_remaining < 0) rs.cycles_remaining = (fu == FUKind::MULT_DIV ? (rs.op=="MUL"?MUL_LATENCY:DIV_LATENCY) : ALU_LATENCY);
-                reorder_buffer[rs.dest_rob_index].state = "Execute"; rs.cycles_remaining--;
-                if (rs.cycles_remaining == 0) {
-                    int64_t op1=rs.Vj, op2=rs.Vk, res=0;
-                    std::optional<ReorderBufferEntry::FlagResult> flags; auto m = rs.op;
-                    if(m=="ADD"||m=="INC"){res=op1+(m=="INC"?1:op2);} else if(m=="SUB"||m=="DEC"){res=op1-(m=="DEC"?1:op2);}
-                    else if(m=="MUL"){res=op1*op2;} else if(m=="DIV"){res=op2==0?0:op1/op2;} else if(m=="AND"){res=op1&op2;}
-                    else if(m=="OR"){res=op1|op2;} else if(m=="XOR"){res=op1^op2;} else if(m=="NOT"){res=~op1;} else if(m=="LEA"){res=op1+op2;}
-                    else if(m=="CMP"){res=op1-op2; bool zf=(res==0), sf=(res<0), of=false; flags={{zf,sf,of}};}
-                    else if(m.front()=='J'||m=="RET"||m=="CALL"){reorder_buffer[rs.dest_rob_index].ready=true;}
-                    cdb_bus.push_back({fu,rs.dest_rob_index,res,flags}); rs.busy=false;
-                }
-            }
+void PipelineSimulator::read_operand(int reg, int64_t& value, int& tag) {
+    const auto& rat = register_alias_table[reg];
+    if(rat.is_rob) { if(reorder_buffer[rat.rob_index].ready) { value = reorder_buffer[rat.rob_index].value; tag = -1; } else { tag = rat.rob_index; } }
+    else { value = reg_file.read(reg); tag = -1; }
+}
+
+IssueStall PipelineSimulator::dispatch_stall(uint32_t uop_index) const {
+    const MicroOp& u = micro_ops[uop_index];
+    if (u.fu == FUKind::MEMORY) return lsb_free.empty() ? IssueStall::LsbFull : IssueStall::None;
+    if (u.fu == FUKind::MULT_DIV) return mul_div_free.empty() ? IssueStall::MulDivRsFull : IssueStall::None;
+    return alu_free.empty() ? IssueStall::AluRsFull : IssueStall::None;
+}
+
+template<class Shape> IssueStall PipelineSimulator::dispatch_instruction(const Shape& sh, uint32_t uop_index) {
+    IssueStall stall = dispatch_stall(uop_index);
+    if (stall != IssueStall::None) return stall;
+    const MicroOp& u = micro_ops[uop_index];
+    bool is_mem = u.fu == FUKind::MEMORY, is_md = u.fu == FUKind::MULT_DIV;
+    auto& free_list = is_mem ? lsb_free : is_md ? mul_div_free : alu_free;
+    int idx = free_list.back(); free_list.pop_back();
+
+    int rob_idx = rob_tail;
+    reorder_buffer[rob_idx] = {}; reorder_buffer[rob_idx].busy = true;
+    reorder_buffer[rob_idx].uop_index = uop_index; reorder_buffer[rob_idx].state = RobState::Issue;
+    reorder_buffer[rob_idx].dispatch_cycle = cycle_count;
+    if (is_mem) reorder_buffer[rob_idx].lsb_index = idx;
+
+    if(!is_mem) { // Komut bir RS kullanıyorsa
+        ReservationStationEntry* rs = is_md ? &mul_div_rs[idx] : &alu_rs[idx];
+        int slot = is_md ? mul_div_slot(sh, idx) : alu_slot(sh, idx);
+        *rs = {}; rs->busy = true; rs->op = u.op; rs->shift = u.shift; rs->dest_rob_index = rob_idx; rs->cycles_remaining = u.latency;
+        if (u.src1 != NO_REG) read_operand(u.src1, rs->Vj, rs->Qj); else rs->Vj = u.imm;
+        if (u.src2 != NO_REG) read_operand(u.src2, rs->Vk, rs->Qk); else rs->Vk = u.imm;
+        if (rs->Qj != -1) link_consumer(rs->Qj, slot);
+        if (rs->Qk != -1) link_consumer(rs->Qk, slot + 1);
+        if (rs->Qj == -1 && rs->Qk == -1) (is_md ? mul_div_ready : alu_ready).push_back(idx);
+        PIPELIGHT_TRACE(issue(cycle_count, rob_idx, uop_index, idx, rs->Vj, rs->Qj, rs->Vk, rs->Qk));
+    } else {
+        LoadStoreBufferEntry* lsq = &lsb[idx];
+        *lsq = {}; lsq->busy = true; lsq->op = u.op; lsq->dest_rob_index = rob_idx;
+        lsq->is_load = (u.op == Opcode::LOAD); lsq->addr_offset = u.disp;
+        if (u.src1 != NO_REG) read_operand(u.src1, lsq->V_addr, lsq->Q_addr); // otherwise an absolute address: V_addr = 0
+        if (!lsq->is_load) { if (u.src2 != NO_REG) read_operand(u.src2, lsq->Vs, lsq->Qs); else lsq->Vs = u.imm; }
+        if (lsq->Q_addr != -1) link_consumer(lsq->Q_addr, lsb_slot(sh, idx)); else lsb_ready.push_back(idx);
+        if (lsq->Qs != -1) link_consumer(lsq->Qs, lsb_slot(sh, idx) + 1);
+        PIPELIGHT_TRACE(issue(cycle_count, rob_idx, uop_index, idx, lsq->V_addr, lsq->Q_addr, lsq->Vs, lsq->Qs));
+    }
+
+    if (u.dst != NO_REG) { register_alias_table[u.dst] = {true, rob_idx}; }
+
+    if (is_branch_op(u.op)) {
+        rat_checkpoints[rob_idx] = register_alias_table;
+        program_counter = branch_unit.predict(u.branch_class, uop_index, u.target, reorder_buffer[rob_idx].bp);
+    } else program_counter++;
+    reorder_buffer[rob_idx].predicted_next = program_counter;
+    rob_tail = (rob_tail + 1) % sh.rob_size(); rob_count++;
+    return IssueStall::None;
+}
+void PipelineSimulator::link_consumer(int tag, int slot) {
+    wakeup_next[slot] = wakeup_head[tag]; wakeup_head[tag] = slot;
+}
+template<class Shape> void PipelineSimulator::wake_consumers(const Shape& sh, int tag, int64_t value) {
+    int slot = wakeup_head[tag]; wakeup_head[tag] = -1;
+    const int md_base = mul_div_slot(sh, 0), lsb_base = lsb_slot(sh, 0);
+    while (slot != -1) {
+        int next = wakeup_next[slot]; wakeup_next[slot] = -1;
+        if (slot < lsb_base) {
+            bool md = slot >= md_base; int idx = (slot - (md ? md_base : 0)) / 2;
+            auto& rs = md ? mul_div_rs[idx] : alu_rs[idx];
+            if (slot & 1) { rs.Vk = value; rs.Qk = -1; } else { rs.Vj = value; rs.Qj = -1; }
+            if (rs.Qj == -1 && rs.Qk == -1) { (md ? mul_div_ready : alu_ready).push_back(idx); operand_waited(rs.dest_rob_index); }
+        } else {
+            int idx = (slot - lsb_base) / 2; auto& l = lsb[idx];
+            if (slot & 1) { l.Vs = value; l.Qs = -1; if (l.address_ready) lsb_ready.push_back(idx); }
+            else { l.V_addr = value; l.Q_addr = -1; lsb_ready.push_back(idx); operand_waited(l.dest_rob_index); }
+        }
+        slot = next;
+    }
+}
+// Grant order of a limited pool's units (MachineConfig::select_policy).
+template<class Entry> void PipelineSimulator::select_order(std::vector<int>& ready, const std::vector<Entry>& group) {
+    switch (static_cast<SelectPolicy>(config_.select_policy)) {
+    case SelectPolicy::Oldest:
+        std::sort(ready.begin(), ready.end(), [&](int a, int b) { return rob_age(group[a].dest_rob_index) < rob_age(group[b].dest_rob_index); });
+        break;
+    case SelectPolicy::Random: // Fisher-Yates, xorshift64
+        for (size_t i = ready.size(); i > 1; --i) {
+            select_rng ^= select_rng << 13; select_rng ^= select_rng >> 7; select_rng ^= select_rng << 17;
+            std::swap(ready[i - 1], ready[select_rng % i]);
+        }
+        break;
+    case SelectPolicy::Position: std::sort(ready.begin(), ready.end()); break;
+    }
+}
+template<class Shape> void PipelineSimulator::do_execute(const Shape& sh) {
+    // Oldest branch found mispredicted this cycle; recovery happens at the end of execute.
+    const int size = sh.rob_size(); int recover_idx = -1;
+    auto older = [&](int a, int b) { return (a - rob_head + size) % size < (b - rob_head + size) % size; };
+    // Unit pools (in Port order): units left and used this cycle, and ready operations that found no unit.
+    constexpr int PORTS = static_cast<int>(Port::Count);
+    int left[PORTS], used[PORTS] = {}, waiting[PORTS] = {};
+    auto limited = [&](Port p) { return pipeline_stats.of(p).units != 0; };
+    for (int p = 0; p < PORTS; ++p) left[p] = limited(static_cast<Port>(p)) ? pipeline_stats.ports[p].units : INT_MAX;
+    const int ALU = static_cast<int>(Port::Alu), MUL = static_cast<int>(Port::Mul), DIV = static_cast<int>(Port::Div);
+    const int AGU = static_cast<int>(Port::Agu), LOAD = static_cast<int>(Port::Load), STORE = static_cast<int>(Port::Store);
+    if (limited(Port::Div)) { for (int i : mul_div_ready) if (mul_div_rs[i].op == Opcode::DIV && started(mul_div_rs[i])) left[DIV]--; }
+    // Only entries in the ready queues are scanned; finished entries leave the queue (keeping its order). For a
+    // limited pool with at least two candidates for a free unit, the queue is first put in select_policy order (idle
+    // cycles change neither the order nor the random state, so cycle skipping agrees); an entry without a unit waits unstarted.
+    auto execute_rs = [&](auto& rs_group, std::vector<int>& ready, std::vector<int>& free_list, FUKind fu) {
+        const bool md = fu == FUKind::MULT_DIV;
+        auto port_of = [&](const ReservationStationEntry& rs) { return !md ? ALU : rs.op == Opcode::DIV ? DIV : MUL; };
+        if (ready.size() > 1 && (md ? limited(Port::Mul) || limited(Port::Div) : limited(Port::Alu))) {
+            int candidates = 0;
+            for (int i : ready) candidates += !started(rs_group[i]) && left[port_of(rs_group[i])] > 0;
+            if (candidates > 1) select_order(ready, rs_group);
         }
+        size_t keep = 0; uint64_t executing = 0;
+        for (size_t n = 0; n < ready.size(); ++n) {
+            int idx = ready[n]; auto& rs = rs_group[idx]; auto& rob = reorder_buffer[rs.dest_rob_index];
+            const int port = port_of(rs);
+            if (rob.state != RobState::Execute) {
+                if (left[port] == 0) { waiting[port]++; ready[keep++] = idx; continue; }
+                left[port]--; used[port]++;
+                PIPELIGHT_TRACE(executeStart(cycle_count, rs.dest_rob_index, rob.uop_index));
+            } else if (port == DIV) used[port]++; // the divider is busy until the DIV finishes
+            rob.state = RobState::Execute; rs.cycles_remaining--; executing++;
+            if (rs.cycles_remaining > 0) { ready[keep++] = idx; continue; }
+            const int64_t res = alu_result(rs.op, rs.Vj, rs.Vk, rs.shift);
+            if (is_branch_op(rs.op) && resolve_branch(rs.dest_rob_index, rs.Vj) && (recover_idx < 0 || older(rs.dest_rob_index, recover_idx)))
+                recover_idx = rs.dest_rob_index;
+            cdb_bus.push_back({fu, rs.dest_rob_index, res}); rs.busy = false; free_list.push_back(idx);
+            PIPELIGHT_TRACE(complete(cycle_count, rs.dest_rob_index, rob.uop_index));
+        }
+        ready.resize(keep);
+        if (executing) { FuUsage& u = pipeline_stats.fu[static_cast<int>(fu)]; u.busy_cycles++; u.op_cycles += executing; }
     };
-    execute_rs(alu_rs, FUKind::ALU); execute_rs(mul_div_rs, FUKind::MULT_DIV);
-    for (auto& l : lsb) {
-        if(l.busy) {
-            if(!l.address_ready && l.Q_addr == -1) { l.address = l.V_addr + l.addr_offset; l.address_ready = true; }
-            if(l.address_ready) {
-                reorder_buffer[l.dest_rob_index].state = "Execute"; auto m=l.op;
-                if(m=="PUSH"){reorder_buffer[l.dest_rob_index].address_result=l.V_addr-8;} if(m=="POP"){reorder_buffer[l.dest_rob_index].address_result=l.V_addr;}
-                if (l.is_load) {
-                    int64_t mem_addr = (m=="POP")? l.V_addr : l.address;
-                    cdb_bus.push_back({FUKind::MEMORY, l.dest_rob_index, data_memory.count(mem_addr)?data_memory.at(mem_addr):0, {}}); l.busy=false;
-                } else if (l.Qs == -1) {
-                    reorder_buffer[l.dest_rob_index].address_result= (m=="PUSH")? l.V_addr-8 : l.address;
-                    reorder_buffer[l.dest_rob_index].value=l.Vs;
-                    reorder_buffer[l.dest_rob_index].ready=true; l.busy=false;
-                }
-            }
+    execute_rs(alu_rs, alu_ready, alu_free, FUKind::ALU); execute_rs(mul_div_rs, mul_div_ready, mul_div_free, FUKind::MULT_DIV);
+    // Loads returning from the caches; the value is read from memory in the cycle the data arrives.
+    if (!lsb_in_flight.empty()) {
+        FuUsage& u = pipeline_stats.fu[static_cast<int>(FuClass::Memory)]; u.busy_cycles++; u.op_cycles += lsb_in_flight.size();
+        size_t keep = 0;
+        for (int idx : lsb_in_flight) {
+            auto& l = lsb[idx];
+            if (l.data_ready_cycle > cycle_count) { lsb_in_flight[keep++] = idx; continue; }
+            complete_load(idx, cycle_count);
         }
+        lsb_in_flight.resize(keep);
+    }
+    if (lsb_ready.size() > 1 && (limited(Port::Agu) || limited(Port::Load) || limited(Port::Store))) {
+        int candidates = 0; // loads still waiting for MSHRs or stores take no port
+        for (int i : lsb_ready) candidates += lsb[i].wait == LoadWait::None || lsb[i].wait == LoadWait::Port;
+        if (candidates > 1) select_order(lsb_ready, lsb);
+    }
+    size_t lsb_keep = 0; int replay_idx = -1;
+    for (size_t n = 0; n < lsb_ready.size(); ++n) {
+        int idx = lsb_ready[n]; auto& l = lsb[idx];
+        auto& rob = reorder_buffer[l.dest_rob_index];
+        if (!l.address_ready) {
+            if (left[AGU] == 0) { waiting[AGU]++; lsb_ready[lsb_keep++] = idx; continue; }
+            left[AGU]--; used[AGU]++;
+        }
+        if (rob.state != RobState::Execute) PIPELIGHT_TRACE(executeStart(cycle_count, l.dest_rob_index, rob.uop_index));
+        rob.state = RobState::Execute;
+        if(!l.address_ready) {
+            l.address = l.V_addr + l.addr_offset; l.address_ready = true; l.address_cycle = cycle_count;
+            if (!l.is_load) { int v = find_violation(idx); if (v >= 0 && (replay_idx < 0 || older(v, replay_idx))) replay_idx = v; }
+        }
+        if (l.is_load) {
+            int source = -1; bool speculative = false;
+            LoadWait wait = find_store_source(idx, source, speculative);
+            if (wait != LoadWait::None) {
+                if (l.wait != LoadWait::StoreData && l.wait != LoadWait::StoreAddress) lsq_stats.store_waits++;
+                l.wait = wait; lsb_ready[lsb_keep++] = idx; continue;
+            }
+            if (left[LOAD] == 0) { waiting[LOAD]++; l.wait = LoadWait::Port; lsb_ready[lsb_keep++] = idx; continue; }
+            uint64_t ready = 0;
+            if (source >= 0) { // store forwarding: takes as long as an L1 hit
+                l.forwarded = true; l.forward_value = lsb[source].Vs; lsq_stats.forwards++;
+                ready = cycle_count + (memory_hierarchy.enabled() ? config_.l1d_latency : 1) - 1;
+            } else if (!memory_hierarchy.load(rob.uop_index, l.address, cycle_count, ready, l.wait != LoadWait::Mshr)) {
+                l.wait = LoadWait::Mshr; lsb_ready[lsb_keep++] = idx; continue;
+            }
+            left[LOAD]--; used[LOAD]++; // a load waiting for an MSHR holds no port
+            l.wait = LoadWait::None; if (speculative) lsq_stats.speculative_loads++;
+            rob.address_result = l.address; rob.load_performed = true; rob.load_source = source >= 0 ? lsb[source].dest_rob_index : -1;
+            PIPELIGHT_TRACE(memoryAccess(cycle_count, l.dest_rob_index, rob.uop_index, false, l.forwarded, l.address, l.forwarded ? l.forward_value : data_memory.read(l.address)));
+            if (ready > cycle_count) { l.data_ready_cycle = ready; lsb_in_flight.push_back(idx); continue; }
+            complete_load(idx, cycle_count);
+        } else if (l.Qs == -1) {
+            if (left[STORE] == 0) { waiting[STORE]++; lsb_ready[lsb_keep++] = idx; continue; }
+            left[STORE]--; used[STORE]++;
+            rob.address_result = l.address; rob.value = l.Vs; rob.ready = true; // the LSB entry stays in the store queue until commit
+            PIPELIGHT_TRACE(writeback(cycle_count, l.dest_rob_index, rob.uop_index, l.Vs, l.address));
+        } // store data not ready yet: leaves the queue, wake_consumers re-queues it
     }
+    lsb_ready.resize(lsb_keep); // loads still waiting (MSHR, an older store or a port), entries without a unit
+    for (int p = ALU; p <= STORE; ++p) pipeline_stats.use_port(static_cast<Port>(p), used[p], waiting[p]);
+    // A mispredict and a replay in the same cycle: the older one wins; the other is squashed by it anyway.
+    if (recover_idx >= 0 && config_.branch_resolution != 0) recover_idx = -1;
+    if (replay_idx >= 0 && (recover_idx < 0 || older(replay_idx, recover_idx))) replay_load(sh, replay_idx);
+    else if (recover_idx >= 0) squash_younger_than(sh, recover_idx);
+}
+// The value is read from memory (or the forwarding store) in the cycle the data arrives.
+void PipelineSimulator::complete_load(int lsb_idx, uint64_t data_cycle) {
+    auto& l = lsb[lsb_idx];
+    InstructionProfile& p = profile_of(l.dest_rob_index); p.loads++; p.load_latency_cycles += data_cycle - l.address_cycle + 1;
+    cdb_bus.push_back({FUKind::MEMORY, l.dest_rob_index, l.forwarded ? l.forward_value : data_memory.read(l.address)}); l.busy = false; lsb_free.push_back(lsb_idx);
+    PIPELIGHT_TRACE(complete(cycle_count, l.dest_rob_index, reorder_buffer[l.dest_rob_index].uop_index));
 }
-void PipelineSimulator::do_write_result() {
-    for (const auto& result : cdb_bus) {
+template<class Shape> void PipelineSimulator::do_write_result(const Shape& sh) {
+    // CDB width: at most cdb_width results broadcast this cycle, the rest wait in completion order.
+    size_t n = cdb_bus.size();
+    if (config_.cdb_width > 0 && n > static_cast<size_t>(config_.cdb_width)) {
+        width_stats.cdb_width_bound_cycles++; width_stats.cdb_delayed_results += n - config_.cdb_width;
+        n = config_.cdb_width;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        const CdbResult& result = cdb_bus[i];
         auto& rob = reorder_buffer[result.rob_index];
         if(!rob.ready){
-            rob.value = result.value; if(result.flags) rob.flag_result = *result.flags; rob.state = "Write";
-            if(rob.instruction.mnemonic.front() != 'J' && rob.instruction.mnemonic!="RET") rob.ready = true;
+            rob.value = result.value; rob.state = RobState::Write; rob.ready = true;
+            PIPELIGHT_TRACE(writeback(cycle_count, result.rob_index, rob.uop_index, result.value, 0));
         }
-        auto bcast=[&](auto& g){for(auto& rs:g){if(rs.busy&&rs.Qj==result.rob_index){rs.Vj=result.value;rs.Qj=-1;}if(rs.busy&&rs.Qk==result.rob_index){rs.Vk=result.value;rs.Qk=-1;}}};
-        bcast(alu_rs);bcast(mul_div_rs);
-        for(auto&l:lsb){if(l.busy&&l.Q_addr==result.rob_index){l.V_addr=result.value;l.Q_addr=-1;}if(l.busy&&l.Qs==result.rob_index){l.Vs=result.value;l.Qs=-1;}}
+        wake_consumers(sh, result.rob_index, result.value);
     }
+    pipeline_stats.use_port(Port::Writeback, static_cast<int>(n), static_cast<int>(cdb_bus.size() - n));
+    cdb_bus.erase(cdb_bus.begin(), cdb_bus.begin() + n);
+    width_stats.cdb_results += n;
+    pipeline_stats.cdb_per_cycle[std::min(n, static_cast<size_t>(PipelineStats::CDB_BUCKETS - 1))]++;
 }
-void PipelineSimulator::do_commit() {
-    if(!reorder_buffer[rob_head].busy) return; auto& head = reorder_buffer[rob_head];
-    if (head.state == "Commit") return;
-    if(head.instruction.is_branch && !head.ready) {
-        auto m=head.instruction.mnemonic; bool zf=reg_file.ZF, sf=reg_file.SF, of=reg_file.OF; bool taken=false;
-        if(m=="RET"){ taken=true; head.instruction.target_address=head.value;} else if(m=="JMP"||m=="CALL"){taken=true;}
-        else if(m=="JZ"){taken=zf;} else if(m=="JNZ"){taken=!zf;} else if(m=="JG"){taken=!zf&&(sf==of);}
-        else if(m=="JGE"){taken=sf==of;} else if(m=="JL"){taken=sf!=of;} else if(m=="JLE"){taken=zf||(sf!=of);}
-        head.branch_taken_actual = taken; head.ready = true;
+template<class Shape> void PipelineSimulator::do_commit(const Shape& sh) {
+    const int width = config_.commit_width; int committed = 0; CommitStall stall = CommitStall::None;
+    while (committed < width) {
+        stall = commit_head(sh);
+        if (stall == CommitStall::None) { committed++; continue; }
+        if (stall == CommitStall::Flush) committed++; // the branch itself retired
+        break;
     }
-    if (head.ready) {
-        head.state = "Commit"; const auto& instr = head.instruction;
-        bool predicted_taken = (instr.is_branch && (!instr.branch_label || instr.target_address < instr.address)) || instr.mnemonic == "JMP" || instr.mnemonic == "CALL" || instr.mnemonic == "RET";
-        if(instr.is_branch) {
-            total_branch_count++;
-            uint64_t correct_pc=head.branch_taken_actual?head.instruction.target_address:instr.address + 1;
-            uint64_t predicted_pc = predicted_taken? instr.target_address:instr.address+1;
-            if (program_counter != correct_pc && committed_ins_count > 0 && program_counter != (correct_pc - 1)) {
-                handle_branch_misprediction(correct_pc); return;
+    width_stats.commit_slots_used += committed;
+    if (stall == CommitStall::HeadNotReady) profile_of(rob_head).head_stall_cycles++;
+    if (committed == width) width_stats.commit_width_bound_cycles++;
+    else width_stats.commit_slots_lost[static_cast<int>(stall)] += width - committed;
+}
+template<class Shape> CommitStall PipelineSimulator::commit_head(const Shape& sh) {
+    auto& head = reorder_buffer[rob_head];
+    if (!head.busy) return CommitStall::RobEmpty;
+    if (!head.ready) return CommitStall::HeadNotReady;
+    head.state = RobState::Commit; const MicroOp& u = micro_ops[head.uop_index];
+    if (u.op == Opcode::STORE) {
+        data_memory.write(head.address_result, head.value); memory_hierarchy.store(head.address_result, cycle_count);
+        PIPELIGHT_TRACE(memoryAccess(cycle_count, rob_head, head.uop_index, true, false, head.address_result, head.value));
+        lsb[head.lsb_index].busy = false; lsb_free.push_back(head.lsb_index);
+    }
+    if (u.dst != NO_REG) {
+        reg_file.write(u.dst, head.value);
+        auto& r = register_alias_table[u.dst]; if (r.is_rob && r.rob_index == rob_head) r = {false, -1};
+    }
+
+    // The branch was resolved in execute; here the predictor is only trained and the penalty counted. With
+    // branch_resolution=commit recovery happens here as well, by flushing the whole pipeline.
+    bool flush = false;
+    if (is_branch_op(u.op)) {
+        total_branch_count++; profile_of(rob_head).branches++;
+        branch_unit.train(u.branch_class, head.uop_index, u.target, head.bp, head.branch_taken_actual, head.resolved_next, head.predicted_next);
+        if (head.mispredicted) {
+            mispredict_count++; profile_of(rob_head).mispredicts++;
+            if (config_.branch_resolution != 0) {
+                flush = true; head.recovery_cycle = cycle_count;
+                branch_unit.recover(u.branch_class, head.uop_index, head.bp, head.branch_taken_actual);
             }
+            mispredict_penalty_cycles += head.recovery_cycle - head.dispatch_cycle;
         }
-        if (instr.mnemonic == "STORE"||instr.mnemonic=="PUSH"||instr.mnemonic=="CALL"){data_memory[head.address_result]=head.value;}
-        if (instr.dest_reg) {reg_file.write(*instr.dest_reg, head.value);}
-        if(instr.mnemonic=="PUSH"||instr.mnemonic=="CALL"){reg_file.write("RSP",head.address_result);} else if(instr.mnemonic=="POP"||instr.mnemonic=="RET"){reg_file.write("RSP",reorder_buffer[rob_head].address_result+8);}
-        if(head.flag_result){reg_file.ZF=head.flag_result->ZF;reg_file.SF=head.flag_result->SF;reg_file.OF=head.flag_result->OF;}
-        if(instr.dest_reg){auto&r=register_alias_table.at(*instr.dest_reg);if(r.is_rob&&r.rob_index==rob_head)r={false,-1};}
-        if(instr.mnemonic=="PUSH"||instr.mnemonic=="POP"||instr.mnemonic=="CALL"||instr.mnemonic=="RET"){auto&r=register_alias_table["RSP"];if(r.is_rob&&r.rob_index==rob_head)r={false,-1};}
-        head.busy=false; rob_head=(rob_head+1)%ROB_SIZE; committed_ins_count++;
     }
+    uint64_t correct_pc = head.resolved_next;
+    if (u.last) { instruction_profile[u.instr_index].commits++; if (u.instr_index == commit_breakpoint) breakpoint_hit = true; }
+    PIPELIGHT_TRACE(commit(cycle_count, rob_head, head.uop_index));
+    head.busy=false; rob_head=(rob_head+1)%sh.rob_size(); rob_count--; if (u.last) committed_ins_count++;
+    if (flush) { handle_branch_misprediction(correct_pc); return CommitStall::Flush; }
+    return CommitStall::None;
 }
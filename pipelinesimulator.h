@@ -2,102 +2,341 @@
 #define PIPELINESIMULATOR_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <cstdint>
 #include <optional>
+#include <array>
+#include <deque>
+#include "machineconfig.h"
+#include "branchpredictor.h"
+#include "pagedmemory.h"
+#include "memoryhierarchy.h"
+#include "storesetpredictor.h"
+#include "pipelinestats.h"
 
+enum class FUKind : uint8_t { ALU, MULT_DIV, MEMORY, BRANCH };
+
+// Decoded micro-op opcodes. PUSH/POP/CALL/RET are cracked into several of these at load time.
+enum class Opcode : uint8_t {
+    ADD, SUB, MUL, DIV, AND, OR, XOR, NOT, INC, DEC, MOV, LEA, CMP,
+    LOAD, STORE,
+    JMP, JZ, JNZ, JG, JGE, JL, JLE, JMP_IND
+};
+const char* opcode_name(Opcode op);
+inline bool is_branch_op(Opcode op) { return op >= Opcode::JMP; }
+// Architectural direction of a branch for the given flags (unconditional jumps are always taken).
+inline bool branch_taken(Opcode op, bool zf, bool sf, bool of) {
+    switch (op) {
+    case Opcode::JZ: return zf;
+    case Opcode::JNZ: return !zf;
+    case Opcode::JG: return !zf && (sf == of);
+    case Opcode::JGE: return sf == of;
+    case Opcode::JL: return sf != of;
+    case Opcode::JLE: return zf || (sf != of);
+    default: return true;
+    }
+}
+enum class RobState : uint8_t { Issue, Execute, Write, Commit };
+const char* rob_state_name(RobState s);
+
+// Dense register ids: 0..15 are the architectural GPRs, REG_TMP is a hidden scratch register used by cracked RET and
+// scaled-index loads and stores.
+// REG_FLAGS is renamed like a register: CMP writes it, conditional branches read it (packed, see pack_flags).
+enum : int8_t { REG_RAX, REG_RBX, REG_RCX, REG_RDX, REG_RSI, REG_RDI, REG_RBP, REG_RSP,
+                REG_R8, REG_R9, REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15,
+                REG_TMP, REG_FLAGS, NO_REG = -1 };
+constexpr int NUM_GPRS = 16;
+constexpr int NUM_REGS = 18;
+inline int64_t pack_flags(bool zf, bool sf, bool of) { return (zf ? 1 : 0) | (sf ? 2 : 0) | (of ? 4 : 0); }
+// Result of an ALU or MUL/DIV micro-op on operands a (Vj) and b (Vk); shared by the pipeline and the
+// functional model. Unsigned arithmetic: 64-bit wraparound instead of undefined overflow. shift scales
+// LEA's index operand (MicroOp::shift).
+inline int64_t alu_result(Opcode op, int64_t vj, int64_t vk, unsigned shift = 0) {
+    const uint64_t a = static_cast<uint64_t>(vj), b = static_cast<uint64_t>(vk); uint64_t res;
+    switch (op) {
+    case Opcode::ADD: res = a + b; break;
+    case Opcode::LEA: res = a + (b << shift); break;
+    case Opcode::SUB: res = a - b; break;
+    case Opcode::INC: res = a + 1; break;
+    case Opcode::DEC: res = a - 1; break;
+    case Opcode::MUL: res = a * b; break;
+    case Opcode::DIV: res = (vk == 0) ? 0 : (vk == -1) ? 0 - a : static_cast<uint64_t>(vj / vk); break;
+    case Opcode::AND: res = a & b; break;
+    case Opcode::OR: res = a | b; break;
+    case Opcode::XOR: res = a ^ b; break;
+    case Opcode::NOT: res = ~a; break;
+    case Opcode::CMP: res = a - b; return pack_flags(res == 0, static_cast<int64_t>(res) < 0, (((a ^ b) & (a ^ res)) >> 63) != 0);
+    default: res = a; break; // MOV; branches: the flags or the JMP* target
+    }
+    return static_cast<int64_t>(res);
+}
+
+const char* reg_name(int reg_id);
+int reg_id(const std::string& name); // -1 if unknown
+
+// Source-level instruction, kept for display and profiling; the pipeline works on MicroOp.
 struct Instruction {
-    std::string original_text; std::string mnemonic;
-    std::optional<std::string> dest_reg, src_reg1, src_reg2_base, branch_label;
-    std::optional<int64_t> immediate_val;
-    bool is_branch = false; uint64_t target_address = 0; uint64_t address = 0;
+    uint64_t address = 0; int line = 0;
+    uint32_t first_uop = 0, uop_count = 0;
+    uint32_t text_offset = 0, text_length = 0; // source text (label and comment stripped) in programSource()
 };
 
-enum class FUKind { ALU, MULT_DIV, MEMORY, BRANCH };
+struct MicroOp {
+    Opcode op = Opcode::ADD; FUKind fu = FUKind::ALU; uint8_t latency = 0;
+    int8_t dst = NO_REG, src1 = NO_REG, src2 = NO_REG;
+    uint8_t shift = 0; // LEA: src2 is a scaled index, shifted left by this much
+    int64_t imm = 0;   // ALU: second operand (or first for MOV) when the register is absent; STORE: data
+    int64_t disp = 0;  // LOAD/STORE displacement; with no base register (src1), the absolute address
+    uint32_t target = 0;      // direct branch target (micro-op index)
+    uint32_t instr_index = 0; // owning Instruction in program_memory
+    bool last = true;         // last micro-op of its instruction
+    BranchClass branch_class = BranchClass::Conditional; // branches only: JMP/CALL/RET get their own class for the BTB/RAS
+};
 
 class RegisterFile {
 public:
-    std::map<std::string, int64_t> gpr;
+    std::array<int64_t, NUM_REGS> gpr{};
     bool ZF = false, SF = false, OF = false;
     RegisterFile();
+    void write(int reg_id, int64_t value) {
+        if (reg_id == REG_FLAGS) { ZF = value & 1; SF = value & 2; OF = value & 4; } else gpr[reg_id] = value;
+    }
+    int64_t read(int reg_id) const { return reg_id == REG_FLAGS ? pack_flags(ZF, SF, OF) : gpr[reg_id]; }
+    // Access by name is for the GUI and tests; the pipeline always uses integer ids.
     void write(const std::string& reg_name, int64_t value);
-    int64_t read(const std::string& reg_name);
+    int64_t read(const std::string& reg_name) const;
 };
 
 struct ReorderBufferEntry {
-    bool busy = false; Instruction instruction; std::string state;
-    bool ready = false; int64_t value = 0; int64_t address_result = 0;
-    struct FlagResult { bool ZF, SF, OF; };
-    std::optional<FlagResult> flag_result;
-    bool branch_taken_actual = false;
+    bool busy = false; uint32_t uop_index = 0; RobState state = RobState::Issue;
+    bool ready = false; int64_t value = 0; int64_t address_result = 0; // CMP: value = packed flags
+    bool branch_taken_actual = false, mispredicted = false;
+    uint64_t predicted_next = 0, resolved_next = 0;
+    uint64_t dispatch_cycle = 0, recovery_cycle = 0;
+    BranchCheckpoint bp; // predictor state at dispatch, for training and recovery
+    int lsb_index = -1;  // LOAD/STORE: its LSB entry (a store keeps it until commit)
+    bool load_performed = false; int load_source = -1; // LOAD: address_result read; ROB index of the forwarding store, -1 = memory
 };
 
 struct ReservationStationEntry {
-    bool busy = false; std::string op; int64_t Vj = 0, Vk = 0;
+    bool busy = false; Opcode op = Opcode::ADD; uint8_t shift = 0; int64_t Vj = 0, Vk = 0;
     int Qj = -1, Qk = -1; int dest_rob_index = -1; int cycles_remaining = -1;
 };
 
+// Why a load with a ready address is still in lsb_ready; it is retried every cycle.
+enum class LoadWait : uint8_t { None, Mshr, StoreData, StoreAddress, Port };
+
+// MachineConfig::select_policy: the order in which ready RS/LSB entries are offered a limited pool's units.
+enum class SelectPolicy : uint8_t { Oldest, Random, Position };
+
+// Loads and stores share the LSB. A load leaves it when its data returns, a store only at commit, so the
+// busy stores form the store queue that loads search (by ROB age) for forwarding.
 struct LoadStoreBufferEntry {
-    bool busy = false; std::string op; bool is_load; int dest_rob_index = -1;
+    bool busy = false; Opcode op = Opcode::LOAD; bool is_load = false; int dest_rob_index = -1;
     int64_t V_addr = 0; int Q_addr = -1; int64_t addr_offset = 0;
     bool address_ready = false; int64_t address = 0;
     int64_t Vs = 0; int Qs = -1;
+    LoadWait wait = LoadWait::None;
+    bool forwarded = false; int64_t forward_value = 0; // load: value taken from an older store
+    uint64_t data_ready_cycle = 0;  // load in flight in the cache hierarchy: cycle its data arrives
+    uint64_t address_cycle = 0;     // cycle the address was computed (load latency profile)
+};
+
+// Why a cycle's issue or commit slots went unused. Slots lost to the first blocking reason are charged to it.
+enum class IssueStall : uint8_t { None, RobFull, AluRsFull, MulDivRsFull, LsbFull, ProgramEnd, TakenBranch, Count };
+enum class CommitStall : uint8_t { None, RobEmpty, HeadNotReady, Flush, Count };
+const char* issue_stall_name(IssueStall s);
+const char* commit_stall_name(CommitStall s);
+
+struct WidthStats {
+    uint64_t issue_slots_used = 0, issue_width_bound_cycles = 0;
+    uint64_t issue_slots_lost[static_cast<int>(IssueStall::Count)] = {};
+    uint64_t commit_slots_used = 0, commit_width_bound_cycles = 0;
+    uint64_t commit_slots_lost[static_cast<int>(CommitStall::Count)] = {};
+    uint64_t cdb_results = 0, cdb_width_bound_cycles = 0, cdb_delayed_results = 0;
+};
+
+struct LsqStats {
+    uint64_t forwards = 0;          // loads that took their value from an older in-flight store
+    uint64_t speculative_loads = 0; // loads that issued past an older store with an unknown address
+    uint64_t store_waits = 0;       // loads held back by an older store (its data, or a predicted/conservative dependence)
+    uint64_t violations = 0;        // stores that found a younger load which had read a stale value
+    uint64_t replays = 0, replayed_uops = 0; // squash-and-refetch from the violating load
 };
 
 struct RatEntry {
     bool is_rob = false; int rob_index = -1;
 };
 
+class TraceSink;
+class CheckpointIO;
+
 class PipelineSimulator {
+    friend class StateHistory; // diffs and rewinds the structures below for reverse stepping
+    friend class TraceWriter;  // keyframes
+    friend class TraceReader;  // rebuilds the structures below from a trace
+    friend class FunctionalSimulator; // fast-forwards the architectural state
+    friend class LockstepChecker;     // reads the retiring entries
 private:
-    void do_commit(); void do_write_result(); void do_execute(); void do_issue();
-    void dispatch_instruction(const Instruction& instr);
+    // The per-cycle stages are templated on a structure-size policy (see pipelinesimulator.cpp):
+    // DynamicShape reads the sizes from config_, FixedShape<...> makes them compile-time constants.
+    template<class Shape> void step_impl();
+    template<class Shape> void do_commit(const Shape& sh);
+    template<class Shape> void do_write_result(const Shape& sh);
+    template<class Shape> void do_execute(const Shape& sh);
+    template<class Shape> void do_issue(const Shape& sh);
+    template<class Shape> IssueStall dispatch_instruction(const Shape& sh, uint32_t uop_index);
+    IssueStall dispatch_stall(uint32_t uop_index) const; // RS/LSB-full reason, None if a station is free
+    uint64_t idle_cycles_ahead() const;
+    void skip_idle_cycles(uint64_t n);
+    void charge_issue_stall(IssueStall stall, uint64_t lost_slots);
+    void sample_occupancy(uint64_t cycles); // end-of-cycle structure occupancy, for `cycles` identical cycles
+    template<class Shape> CommitStall commit_head(const Shape& sh);
+    void select_step_function();
+    void read_operand(int reg, int64_t& value, int& tag);
+    bool resolve_branch(int rob_idx, int64_t operand);
+    template<class Shape> int squash_from(const Shape& sh, int keep);
+    template<class Shape> void squash_younger_than(const Shape& sh, int rob_idx);
+    template<class Shape> void replay_load(const Shape& sh, int rob_idx);
+    // An RS entry holds a unit from its first execute cycle until it completes.
+    bool started(const ReservationStationEntry& e) const { return reorder_buffer[e.dest_rob_index].state == RobState::Execute; }
+    template<class Entry> void select_order(std::vector<int>& ready, const std::vector<Entry>& group);
+    int rob_age(int rob_idx) const { return (rob_idx - rob_head + static_cast<int>(reorder_buffer.size())) % static_cast<int>(reorder_buffer.size()); }
+    LoadWait find_store_source(int lsb_idx, int& source, bool& speculative) const;
+    int find_violation(int store_lsb_idx);
     void handle_branch_misprediction(uint64_t correct_target_pc);
+    void clear_pipeline();
+    bool restored_state_valid() const; // checkpoint(): indices and queues read from a file are consistent
+    uint64_t instruction_to_uop(int64_t address) const;
+    std::map<std::string, uint64_t> labels; // upper-case label -> instruction address
+    std::string program_source;
+
+    // Wakeup: every operand slot waiting on a ROB tag is linked into that tag's list, so a CDB
+    // broadcast only touches its own consumers. Slot ids: ALU RS 2i/2i+1 (j/k), then MUL/DIV RS,
+    // then LSB (address/store data).
+    void link_consumer(int tag, int slot);
+    template<class Shape> void wake_consumers(const Shape& sh, int tag, int64_t value);
+    template<class Shape> static int alu_slot(const Shape&, int i) { return 2 * i; }
+    template<class Shape> static int mul_div_slot(const Shape& sh, int i) { return 2 * (sh.alu_rs_size() + i); }
+    template<class Shape> static int lsb_slot(const Shape& sh, int i) { return 2 * (sh.alu_rs_size() + sh.mul_div_rs_size() + i); }
 
-    static const int ROB_SIZE = 32;
-    static const int ALU_RS_SIZE = 6;
-    static const int MUL_DIV_RS_SIZE = 3;
-    static const int LSB_SIZE = 6;
-    static const int ALU_LATENCY = 2;
-    static const int MUL_LATENCY = 8;
-    static const int DIV_LATENCY = 20;
+    MachineConfig config_;
+    using StepFn = void (PipelineSimulator::*)();
+    StepFn step_fn = nullptr; bool specialized_enabled = true, specialized_active = false;
+    bool cycle_skipping = true;
+    bool fetch_stopped = false; // drain(): dispatch nothing new
+    int64_t commit_breakpoint = -1;
 
     std::vector<ReorderBufferEntry> reorder_buffer;
     std::vector<ReservationStationEntry> alu_rs;
     std::vector<ReservationStationEntry> mul_div_rs;
     std::vector<LoadStoreBufferEntry> lsb;
+    int rob_count = 0;
 
-    std::map<std::string, RatEntry> register_alias_table;
+    std::vector<int> wakeup_head, wakeup_next;
+    // Ready queues: indices of the entries whose operands are all ready (executable) only.
+    std::vector<int> alu_ready, mul_div_ready, lsb_ready;
+    std::vector<int> alu_free, mul_div_free, lsb_free;
+    std::vector<int> lsb_in_flight; // loads waiting for the cache hierarchy, in issue order
+    uint64_t select_rng = 0;        // xorshift state of SelectPolicy::Random
 
+    using RegisterAliasTable = std::array<RatEntry, NUM_REGS>;
+    RegisterAliasTable register_alias_table;
+    std::vector<RegisterAliasTable> rat_checkpoints; // indexed by ROB entry; written when a branch dispatches
 
-    std::map<int64_t, int64_t> data_memory;
 
-    struct CdbResult {
-        FUKind fu_source; int rob_index; int64_t value;
-        std::optional<ReorderBufferEntry::FlagResult> flags;
-    };
-    std::vector<CdbResult> cdb_bus;
+    PagedMemory data_memory;
+    MemoryHierarchy memory_hierarchy; // timing only; values always come from data_memory
+    StoreSetPredictor store_sets;
+    LsqStats lsq_stats;
+
+    struct CdbResult { FUKind fu_source; int rob_index; int64_t value; };
+    std::deque<CdbResult> cdb_bus; // results waiting for a CDB slot, in completion order
+    WidthStats width_stats;
+    PipelineStats pipeline_stats;
+    std::vector<InstructionProfile> instruction_profile; // parallel to program_memory
+    InstructionProfile& profile_of(int rob_idx) { return instruction_profile[micro_ops[reorder_buffer[rob_idx].uop_index].instr_index]; }
+    void complete_load(int lsb_idx, uint64_t data_cycle);
+    // An entry dispatched in cycle D can execute in D+1 at the earliest; woken now, it waited the difference.
+    void operand_waited(int rob_idx) { profile_of(rob_idx).operand_wait_cycles += cycle_count - reorder_buffer[rob_idx].dispatch_cycle - 1; }
+    BranchUnit branch_unit;
+    TraceSink* trace_ = nullptr;
 
 public:
-    int cycle_count = 0; uint64_t program_counter = 0; bool simulation_finished = false;
+    uint64_t cycle_count = 0; uint64_t program_counter = 0; bool simulation_finished = false;
     uint64_t committed_ins_count = 0, mispredict_count = 0, total_branch_count = 0;
+    uint64_t skipped_cycles = 0; // cycles advanced in bulk by advance(), included in cycle_count
+    // Mispredict penalty: cycles from a mispredicted branch's dispatch to the redirect of fetch, summed over committed branches.
+    uint64_t mispredict_penalty_cycles = 0, squashed_uop_count = 0;
+    double averageMispredictPenalty() const { return mispredict_count ? (double)mispredict_penalty_cycles / mispredict_count : 0.0; }
     int rob_head_q = 0, rob_tail_q = 0;
     int rob_head = 0, rob_tail = 0;
 
-    RegisterFile reg_file; std::vector<Instruction> program_memory;
+    RegisterFile reg_file; std::vector<Instruction> program_memory; std::vector<MicroOp> micro_ops;
+    // Assembles and loads a program (see assembler.h); throws AssemblyError listing every problem found,
+    // leaving the simulator reset with no program.
     void parse_and_load_program(const std::string& assembly_code);
+    int64_t labelAddress(const std::string& label) const; // case-insensitive; -1 if the program has no such label
+    const std::string& programSource() const { return program_source; } // as passed to parse_and_load_program
+    // Saves or restores the complete machine state, the program excepted (see checkpoint.h): on restore,
+    // the configuration and program must already be those of the checkpoint.
+    void checkpoint(CheckpointIO& io);
+
+    explicit PipelineSimulator(const MachineConfig& config = MachineConfig());
+    void step(); bool is_finished() const; void reset();
+    // Batch stepping: like step(), but when no stage can make progress until a functional unit finishes
+    // (e.g. everything waits on a DIV) jumps straight to that cycle, never past cycle_limit. The result is
+    // cycle-exact with calling step() repeatedly. Returns the number of cycles advanced.
+    uint64_t advance(uint64_t cycle_limit = UINT64_MAX);
+    void setCycleSkipping(bool enabled) { cycle_skipping = enabled; }
+    // Stops dispatching and advances until every micro-op in flight has retired or been squashed, so that
+    // program_counter is the next micro-op in program order and the pipeline is empty (for handing the
+    // state to FunctionalSimulator). The cycles count as ProgramEnd issue stalls. Returns the cycles taken.
+    uint64_t drain();
+    // Debugger support: breakpoint_hit is set in the cycle the instruction at `address` retires (-1: none).
+    void setCommitBreakpoint(int64_t address) { commit_breakpoint = address; breakpoint_hit = false; }
+    bool breakpoint_hit = false;
+    bool isCycleSkippingEnabled() const { return cycle_skipping; }
+    // Pipeline event hooks (see eventtrace.h); TraceWriter and KanataWriter attach and detach themselves.
+    // Copies of the simulator share the sink, so only the recorded one may step while it is attached.
+    void setTrace(TraceSink* trace) { trace_ = trace; }
 
-    PipelineSimulator(); void step(); bool is_finished() const; void reset();
+    // Changing the configuration resets the machine and unloads the program.
+    void setConfig(const MachineConfig& config);
+    const MachineConfig& getConfig() const { return config_; }
+    // When the configuration matches one of the compiled-in fixed shapes, step() runs the
+    // specialized core; disable to force the generic one (e.g. for comparison).
+    void setSpecializedCoreEnabled(bool enabled) { specialized_enabled = enabled; select_step_function(); }
+    bool isSpecializedCoreActive() const { return specialized_active; }
 
     const std::vector<ReorderBufferEntry>& getROB() const { return reorder_buffer; }
     const std::vector<ReservationStationEntry>& getAluRS() const { return alu_rs; }
     const std::vector<ReservationStationEntry>& getMulDivRS() const { return mul_div_rs; }
     const std::vector<LoadStoreBufferEntry>& getLSB() const { return lsb; }
 
-    const std::map<std::string, RatEntry>& getRAT() const { return register_alias_table; } // Hatalı olan 'rat_table' 'register_alias_table' ile düzeltildi.
+    const RegisterAliasTable& getRAT() const { return register_alias_table; } // Hatalı olan 'rat_table' 'register_alias_table' ile düzeltildi.
+    const RatEntry& getRATEntry(const std::string& reg_name) const;
+
+    const WidthStats& getWidthStats() const { return width_stats; }
+    const PipelineStats& getPipelineStats() const { return pipeline_stats; }
+    TopDown topDown() const;
+    const std::vector<InstructionProfile>& getProfile() const { return instruction_profile; } // indexed by Instruction::address
+    const BranchUnit& getBranchUnit() const { return branch_unit; }
 
     const RegisterFile& getArchRegs() const { return reg_file; }
-    const std::map<int64_t, int64_t>& getMemory() const { return data_memory; }
+    const PagedMemory& getMemory() const { return data_memory; }
+    const MemoryHierarchy& getMemoryHierarchy() const { return memory_hierarchy; }
+    const LsqStats& getLsqStats() const { return lsq_stats; }
+    const StoreSetPredictor& getStoreSets() const { return store_sets; }
+    // Initial data, applied after parse_and_load_program (which clears memory). Words go to base, base+8, ...
+    void preloadData(int64_t base, const std::vector<int64_t>& words) { data_memory.load_words(base, words.data(), words.size()); }
+    size_t preloadDataFile(int64_t base, const std::string& path) { return data_memory.load_image_file(base, path); }
+
+    const MicroOp& getMicroOp(uint32_t uop_index) const { return micro_ops[uop_index]; }
+    const Instruction& instructionOf(uint32_t uop_index) const { return program_memory[micro_ops[uop_index].instr_index]; }
+    std::string_view instructionText(const Instruction& instr) const { return std::string_view(program_source).substr(instr.text_offset, instr.text_length); }
+    std::string uopText(uint32_t uop_index) const; // source text, with "[k/n]" for cracked instructions
 };
 #endif // PIPELINESIMULATOR_H
@@ -0,0 +1,55 @@
+#include "pipelinestats.h"
+#include "checkpoint.h"
+#include "machineconfig.h"
+
+const char* structure_name(Structure s) {
+    static const char* const names[] = {"rob", "alu_rs", "mul_div_rs", "lsb"};
+    return names[static_cast<int>(s)];
+}
+
+const char* fu_class_name(FuClass c) {
+    static const char* const names[] = {"alu", "mul_div", "memory"};
+    return names[static_cast<int>(c)];
+}
+
+const char* port_name(Port p) {
+    static const char* const names[] = {"alu", "mul", "div", "agu", "load", "store", "writeback"};
+    return names[static_cast<int>(p)];
+}
+
+double PortUsage::utilization(int unit) const {
+    uint64_t n = busy.samples(), used = 0;
+    for (size_t i = unit + 1; i < busy.cycles.size(); ++i) used += busy.cycles[i];
+    return n ? (double)used / n : 0.0;
+}
+
+uint64_t OccupancyHistogram::samples() const {
+    uint64_t n = 0;
+    for (uint64_t c : cycles) n += c;
+    return n;
+}
+
+double OccupancyHistogram::mean() const {
+    uint64_t n = 0, sum = 0;
+    for (size_t i = 0; i < cycles.size(); ++i) { n += cycles[i]; sum += i * cycles[i]; }
+    return n ? (double)sum / n : 0.0;
+}
+
+void PipelineStats::checkpoint(CheckpointIO& io) {
+    for (auto& h : occupancy) io.vec(h.cycles, true);
+    for (auto& p : ports) { io.vec(p.busy.cycles, true); io.pod(p.waits); }
+    io.pod(operand_wait); io.pod(fu); io.pod(cdb_per_cycle); io.pod(backend_memory_slots); io.pod(backend_core_slots);
+}
+
+void PipelineStats::reset(const MachineConfig& c) {
+    *this = PipelineStats();
+    occupancy[static_cast<int>(Structure::Rob)].reset(c.rob_size);
+    occupancy[static_cast<int>(Structure::AluRs)].reset(c.alu_rs_size);
+    occupancy[static_cast<int>(Structure::MulDivRs)].reset(c.mul_div_rs_size);
+    occupancy[static_cast<int>(Structure::Lsb)].reset(c.lsb_size);
+    // Unlimited pools can use at most as many units as the structure size (CDB: up to ROB size results).
+    auto port = [&](Port p, int units, int bound) { PortUsage& u = ports[static_cast<int>(p)]; u.units = units; u.busy.reset(units ? units : bound); };
+    port(Port::Alu, c.alu_units, c.alu_rs_size); port(Port::Mul, c.mul_units, c.mul_div_rs_size); port(Port::Div, c.div_units, c.mul_div_rs_size);
+    port(Port::Agu, c.agu_units, c.lsb_size); port(Port::Load, c.load_ports, c.lsb_size); port(Port::Store, c.store_ports, c.lsb_size);
+    port(Port::Writeback, c.cdb_width, c.rob_size);
+}
@@ -0,0 +1,95 @@
+#ifndef PIPELINESTATS_H
+#define PIPELINESTATS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CheckpointIO;
+struct MachineConfig;
+
+// Per-cycle utilization counters of a PipelineSimulator. Everything here is sampled once per simulated
+// cycle (skipped idle cycles included), so the totals are independent of cycle skipping.
+
+enum class Structure : uint8_t { Rob, AluRs, MulDivRs, Lsb, Count };
+const char* structure_name(Structure s);
+
+// Bucket i counts the cycles that ended with i entries busy.
+struct OccupancyHistogram {
+    std::vector<uint64_t> cycles;
+    void reset(int capacity) { cycles.assign(capacity + 1, 0); }
+    void add(int occupied, uint64_t n = 1) { cycles[occupied] += n; }
+    uint64_t samples() const;
+    double mean() const;
+    double full_fraction() const { uint64_t s = samples(); return s ? (double)cycles.back() / s : 0.0; }
+};
+
+// Functional-unit activity. op_cycles / busy_cycles is the average number of operations in execution;
+// with unlimited units (the default) that is the number of units in use.
+struct FuUsage {
+    uint64_t busy_cycles = 0; // cycles with at least one operation executing
+    uint64_t op_cycles = 0;   // operations executing, summed over cycles
+};
+enum class FuClass : uint8_t { Alu, MulDiv, Memory, Count }; // Memory: loads waiting on the cache hierarchy
+const char* fu_class_name(FuClass c);
+
+// Execution ports: the unit pools of MachineConfig and the CDB (cdb_width). A pipelined unit is busy in
+// the cycle it accepts an operation, a divider for the whole DIV. Units are granted lowest first, so unit
+// i was busy in every cycle that used more than i of them, as per-port counters on real cores report.
+enum class Port : uint8_t { Alu, Mul, Div, Agu, Load, Store, Writeback, Count };
+const char* port_name(Port p);
+
+struct PortUsage {
+    int units = 0;           // 0 = unlimited; busy.cycles then goes up to the structure size
+    OccupancyHistogram busy; // cycles by number of busy units
+    uint64_t waits = 0;      // ready operations that found every unit taken, summed over cycles
+    double utilization(int unit) const; // fraction of cycles unit `unit` was busy
+    double mean_utilization() const { return units ? busy.mean() / units : 0.0; }
+    double saturated_fraction() const { return units ? busy.full_fraction() : 0.0; } // every unit busy
+};
+
+// Top-down breakdown of the issue slots (issue_width per cycle). Slots that issued a micro-op are
+// retiring (it committed), bad speculation (squashed by a mispredict or a load replay) or still in
+// flight; unused slots are frontend bound (taken-branch group end, program end) or backend bound (a
+// full ROB/RS/LSB), the latter split by whether the ROB head was a load still waiting for memory.
+struct TopDown {
+    uint64_t total_slots = 0, retiring = 0, bad_speculation = 0, in_flight = 0;
+    uint64_t frontend_bound = 0, backend_bound = 0, backend_memory = 0, backend_core = 0;
+    double fraction(uint64_t part) const { return total_slots ? (double)part / total_slots : 0.0; }
+};
+
+struct PipelineStats {
+    static constexpr int CDB_BUCKETS = 9; // 0..7 results, last bucket 8 or more
+
+    OccupancyHistogram occupancy[static_cast<int>(Structure::Count)];
+    uint64_t operand_wait[static_cast<int>(Structure::Count)] = {}; // entry-cycles spent waiting for a source operand
+    FuUsage fu[static_cast<int>(FuClass::Count)];
+    PortUsage ports[static_cast<int>(Port::Count)];
+    uint64_t cdb_per_cycle[CDB_BUCKETS] = {};
+    uint64_t backend_memory_slots = 0, backend_core_slots = 0;
+
+    void reset(const MachineConfig& c);
+    void checkpoint(CheckpointIO& io); // see checkpoint.h
+    const OccupancyHistogram& of(Structure s) const { return occupancy[static_cast<int>(s)]; }
+    const FuUsage& of(FuClass c) const { return fu[static_cast<int>(c)]; }
+    const PortUsage& of(Port p) const { return ports[static_cast<int>(p)]; }
+    // n identical cycles with `used` units busy and `waiting` operations left without one.
+    void use_port(Port p, int used, int waiting = 0, uint64_t n = 1) {
+        PortUsage& u = ports[static_cast<int>(p)];
+        u.busy.add(std::min(used, static_cast<int>(u.busy.cycles.size()) - 1), n); u.waits += n * waiting;
+    }
+};
+
+// Per source instruction (indexed by Instruction::address), for annotating the assembly like `perf annotate`.
+// Cracked instructions are charged through whichever of their micro-ops is involved.
+struct InstructionProfile {
+    uint64_t commits = 0;             // times the instruction retired (its last micro-op committed)
+    uint64_t head_stall_cycles = 0;   // cycles it sat unready at the ROB head, blocking commit
+    uint64_t operand_wait_cycles = 0; // cycles its RS/LSB entries waited for a source operand beyond the earliest issue
+    uint64_t branches = 0, mispredicts = 0; // committed branch micro-ops
+    uint64_t loads = 0, load_latency_cycles = 0; // completed loads: address known to data on the CDB
+    double average_load_latency() const { return loads ? (double)load_latency_cycles / loads : 0.0; }
+};
+
+#endif // PIPELINESTATS_H
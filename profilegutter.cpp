@@ -0,0 +1,76 @@
+#include "profilegutter.h"
+#include <QAbstractTextDocumentLayout>
+#include <QHelpEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QToolTip>
+#include <algorithm>
+
+ProfileGutter::ProfileGutter(QTextEdit* editor, QWidget* parent) : QWidget(parent), editor(editor) {
+    setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
+    setFont(editor->font());
+    connect(editor->verticalScrollBar(), &QScrollBar::valueChanged, this, [this] { update(); });
+    connect(editor->document(), &QTextDocument::contentsChanged, this, [this] { update(); });
+}
+
+void ProfileGutter::setProfile(const SimulationSnapshot& s) {
+    lines.clear();
+    const PipelineSimulator& sim = *s.program; const auto& prof = s.profile;
+    uint64_t hottest = 0;
+    for (const auto& p : prof) hottest = std::max(hottest, p.head_stall_cycles);
+    const double cycles = s.cycle_count ? double(s.cycle_count) : 1.0;
+    for (size_t i = 0; i < prof.size() && i < sim.program_memory.size(); ++i) {
+        const InstructionProfile& p = prof[i];
+        if (!p.commits && !p.head_stall_cycles && !p.operand_wait_cycles) continue;
+        LineHeat& h = lines[sim.program_memory[i].line];
+        h.heat = hottest ? double(p.head_stall_cycles) / hottest : 0.0;
+        h.label = p.head_stall_cycles ? QString("%1%").arg(100.0 * p.head_stall_cycles / cycles, 0, 'f', 1) : QString();
+        h.tooltip = QString("%1\nCommitted: %2\nCycles at ROB head: %3\nOperand wait: %4 cycles")
+                        .arg(QString::fromStdString(std::string(sim.instructionText(sim.program_memory[i])))).arg(p.commits).arg(p.head_stall_cycles).arg(p.operand_wait_cycles);
+        if (p.branches) h.tooltip += QString("\nMispredicts: %1 / %2").arg(p.mispredicts).arg(p.branches);
+        if (p.loads) h.tooltip += QString("\nAvg load latency: %1 cycles").arg(p.average_load_latency(), 0, 'f', 1);
+    }
+    update();
+}
+
+void ProfileGutter::paintEvent(QPaintEvent*) {
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().window());
+    if (lines.empty()) return;
+    // The editor's viewport starts inset by the frame; blocks are measured in document coordinates.
+    const int offset = editor->viewport()->geometry().top() - editor->verticalScrollBar()->value();
+    QAbstractTextDocumentLayout* layout = editor->document()->documentLayout();
+    for (QTextBlock block = editor->document()->begin(); block.isValid(); block = block.next()) {
+        auto it = lines.find(block.blockNumber() + 1);
+        if (it == lines.end()) continue;
+        QRectF r = layout->blockBoundingRect(block);
+        int top = offset + int(r.top()), height = int(r.height());
+        if (top > this->height()) break;
+        if (top + height < 0) continue;
+        const LineHeat& h = it->second;
+        painter.fillRect(QRect(0, top, width(), height), QColor(255, int(235 * (1.0 - h.heat)), int(200 * (1.0 - h.heat))));
+        painter.drawText(QRect(2, top, width() - 4, height), Qt::AlignRight | Qt::AlignVCenter, h.label);
+    }
+}
+
+int ProfileGutter::lineAt(int y) const {
+    const int offset = editor->viewport()->geometry().top() - editor->verticalScrollBar()->value();
+    QAbstractTextDocumentLayout* layout = editor->document()->documentLayout();
+    for (QTextBlock block = editor->document()->begin(); block.isValid(); block = block.next()) {
+        QRectF r = layout->blockBoundingRect(block);
+        if (y >= offset + r.top() && y < offset + r.bottom()) return block.blockNumber() + 1;
+    }
+    return 0;
+}
+
+bool ProfileGutter::event(QEvent* event) {
+    if (event->type() == QEvent::ToolTip) {
+        auto* help = static_cast<QHelpEvent*>(event);
+        auto it = lines.find(lineAt(help->pos().y()));
+        if (it != lines.end()) QToolTip::showText(help->globalPos(), it->second.tooltip, this);
+        else { QToolTip::hideText(); event->ignore(); }
+        return true;
+    }
+    return QWidget::event(event);
+}
@@ -0,0 +1,33 @@
+#ifndef PROFILEGUTTER_H
+#define PROFILEGUTTER_H
+
+#include <QWidget>
+#include <QTextEdit>
+#include <map>
+#include "simulationrunner.h"
+
+// Heat-map strip drawn next to the program editor: every source line that was executed gets a bar
+// whose colour is its share of the cycles spent blocking commit at the ROB head, plus that share as
+// text. Hovering shows the line's full InstructionProfile.
+class ProfileGutter : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ProfileGutter(QTextEdit* editor, QWidget* parent = nullptr);
+    void setProfile(const SimulationSnapshot& s); // clears the gutter when no program is loaded
+    QSize sizeHint() const override { return QSize(56, 0); }
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    bool event(QEvent* event) override;
+
+private:
+    struct LineHeat { double heat = 0.0; QString label, tooltip; };
+    int lineAt(int y) const; // 1-based source line under gutter coordinate y, 0 if none
+
+    QTextEdit* editor;
+    std::map<int, LineHeat> lines; // by Instruction::line
+};
+
+#endif // PROFILEGUTTER_H
@@ -0,0 +1,75 @@
+#include "sampling.h"
+#include "functionalsim.h"
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+void SamplingConfig::validate() const {
+    if (unit == 0) throw std::runtime_error("Sampling unit must be at least 1 instruction");
+    if (period < warmup + unit) throw std::runtime_error("Sampling period must cover warmup + unit (" + std::to_string(warmup + unit) + " instructions)");
+    if (!(confidence > 0.0 && confidence < 1.0)) throw std::runtime_error("Sampling confidence must be between 0 and 1");
+}
+
+double normal_quantile_two_sided(double confidence) {
+    // erf(z / sqrt 2) = confidence; erf is increasing, so bisection is enough.
+    double lo = 0.0, hi = 40.0;
+    for (int i = 0; i < 200; ++i) { double mid = 0.5 * (lo + hi); (std::erf(mid / std::sqrt(2.0)) < confidence ? lo : hi) = mid; }
+    return 0.5 * (lo + hi);
+}
+
+uint64_t SamplingResult::required_units(double relative_error) const {
+    if (mean_cpi <= 0 || relative_error <= 0) return 0;
+    const double n = z * (stddev / mean_cpi) / relative_error;
+    return static_cast<uint64_t>(std::ceil(n * n));
+}
+
+SamplingResult run_sampled(PipelineSimulator& sim, const SamplingConfig& config, uint64_t max_cycles) {
+    config.validate();
+    using Clock = std::chrono::steady_clock;
+    SamplingResult r; r.z = normal_quantile_two_sided(config.confidence);
+    FunctionalSimulator functional(sim);
+    functional.setWarmup(config.functional_warming, config.functional_warming);
+    const uint64_t committed_before = sim.committed_ins_count;
+    auto executed = [&] { return r.fast_forwarded + sim.committed_ins_count - committed_before; };
+    // Detailed stepping until `target` instructions have executed in all; false if the program or the cycle budget ended first.
+    auto detailed_until = [&](uint64_t target) {
+        while (executed() < target) {
+            if (sim.is_finished() || sim.cycle_count >= max_cycles) return false;
+            sim.advance(max_cycles);
+        }
+        return true;
+    };
+
+    const auto t0 = Clock::now(); double detailed_seconds = 0.0;
+    for (uint64_t period_start = config.offset;; period_start += config.period) {
+        const uint64_t unit_start = period_start + config.period - config.unit - config.warmup;
+        if (executed() < unit_start) r.fast_forwarded += functional.run(unit_start - executed());
+        if (sim.is_finished()) break;
+
+        const auto d0 = Clock::now();
+        bool complete = detailed_until(unit_start + config.warmup);
+        const uint64_t c1 = sim.cycle_count, i1 = executed();
+        complete = complete && detailed_until(i1 + config.unit);
+        if (complete) r.unit_cpi.push_back(static_cast<double>(sim.cycle_count - c1) / static_cast<double>(executed() - i1));
+        if (sim.cycle_count < max_cycles) sim.drain();
+        detailed_seconds += std::chrono::duration<double>(Clock::now() - d0).count();
+        if (!complete || sim.cycle_count >= max_cycles) break;
+    }
+    r.host_seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    r.finished = sim.is_finished();
+    r.instructions = executed(); r.detailed = r.instructions - r.fast_forwarded;
+    r.detailed_host_seconds = detailed_seconds;
+    r.full_detailed_host_seconds = r.detailed ? detailed_seconds / r.detailed * r.instructions : 0.0;
+
+    const size_t n = r.unit_cpi.size();
+    if (n > 0) {
+        double sum = 0.0; for (double c : r.unit_cpi) sum += c;
+        r.mean_cpi = sum / n;
+        if (n > 1) {
+            double sq = 0.0; for (double c : r.unit_cpi) sq += (c - r.mean_cpi) * (c - r.mean_cpi);
+            r.stddev = std::sqrt(sq / (n - 1));
+            r.half_width = r.z * r.stddev / std::sqrt(static_cast<double>(n));
+        }
+    }
+    return r;
+}
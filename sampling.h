@@ -0,0 +1,57 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <cstdint>
+#include <vector>
+#include "pipelinesimulator.h"
+
+// SMARTS-style sampled simulation. The program is cut into periods of `period` instructions. Each
+// period is fast-forwarded functionally (FunctionalSimulator, optionally warming the predictors and
+// caches) up to its last warmup + unit instructions, which run on the detailed pipeline: `warmup`
+// instructions unmeasured, to refill the ROB and the queues, then `unit` instructions whose cycles per
+// instruction are one sample. The pipeline is drained before the next fast-forward.
+//
+// The whole-program CPI is estimated as the mean of the unit CPIs, with a confidence interval of
+// z * s / sqrt(n) from their standard deviation s. Cycles, statistics and committed_ins_count of the
+// simulator cover only the detailed parts.
+
+struct SamplingConfig {
+    uint64_t period = 1000000; // instructions per sampling period
+    uint64_t warmup = 2000;    // detailed, unmeasured instructions before each unit
+    uint64_t unit = 1000;      // measured instructions per unit
+    uint64_t offset = 0;       // instructions fast-forwarded before the first period
+    bool functional_warming = true; // train the branch predictor and caches while fast-forwarding
+    double confidence = 0.997;
+    void validate() const; // throws std::runtime_error
+};
+
+struct SamplingResult {
+    bool finished = false;         // the program ran to its end (else max_cycles stopped it)
+    std::vector<double> unit_cpi;  // one per complete measurement unit
+    uint64_t instructions = 0;     // all executed: fast-forwarded + detailed
+    uint64_t fast_forwarded = 0, detailed = 0; // detailed: warm-up, units and drains
+    double mean_cpi = 0.0, stddev = 0.0, half_width = 0.0, z = 0.0; // CI: mean_cpi +- half_width
+    double host_seconds = 0.0, detailed_host_seconds = 0.0;
+    // Host time a full detailed run would take, at the rate measured in the detailed parts.
+    double full_detailed_host_seconds = 0.0;
+
+    size_t units() const { return unit_cpi.size(); }
+    double ipc() const { return mean_cpi > 0 ? 1.0 / mean_cpi : 0.0; }
+    double ipc_low() const { return ipc_bound(mean_cpi + half_width); }
+    double ipc_high() const { return ipc_bound(mean_cpi - half_width); }
+    double relative_error() const { return mean_cpi > 0 ? half_width / mean_cpi : 0.0; }
+    double estimated_cycles() const { return mean_cpi * instructions; }
+    // Units needed for a confidence interval of +-relative_error at the measured variation.
+    uint64_t required_units(double relative_error) const;
+    double host_seconds_saved() const { return full_detailed_host_seconds - host_seconds; }
+private:
+    static double ipc_bound(double cpi) { return cpi > 0 ? 1.0 / cpi : 0.0; }
+};
+
+double normal_quantile_two_sided(double confidence); // z with P(|Z| <= z) = confidence
+
+// Runs sim's loaded program to its end (or until sim.cycle_count reaches max_cycles) in sampled mode.
+// The pipeline must be empty, as after loading.
+SamplingResult run_sampled(PipelineSimulator& sim, const SamplingConfig& config, uint64_t max_cycles = UINT64_MAX);
+
+#endif // SAMPLING_H
@@ -0,0 +1,90 @@
+#include "simulationrunner.h"
+#include <algorithm>
+#include <chrono>
+
+const char* stop_reason_name(StopReason r) {
+    static const char* const names[] = {"running", "paused", "finished", "cycle reached", "breakpoint", "commit count reached"};
+    return names[static_cast<int>(r)];
+}
+
+void SimulationRunner::run(const RunBreakpoints& breakpoints) {
+    if (running() || sim.is_finished()) return;
+    if (worker.joinable()) worker.join(); // previous run already ended on its own
+    stop_requested = false; active = true; memory_taken = 0;
+    worker = std::thread([this, breakpoints] { loop(breakpoints); });
+}
+
+void SimulationRunner::pause() {
+    stop_requested = true;
+    if (worker.joinable()) worker.join();
+}
+
+std::shared_ptr<const SimulationSnapshot> SimulationRunner::latest(uint64_t seen) {
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    if (!snapshot || snapshot->serial <= seen) return nullptr;
+    memory_taken = snapshot->memory_version;
+    return snapshot;
+}
+
+SimulationSnapshot SimulationSnapshot::capture(const PipelineSimulator& sim, uint64_t memory_since) {
+    SimulationSnapshot s;
+    s.program = &sim;
+    s.rob = sim.getROB(); s.rob_head = sim.rob_head_q; s.rob_tail = sim.rob_tail_q;
+    s.alu_rs = sim.getAluRS(); s.mul_div_rs = sim.getMulDivRS(); s.lsb = sim.getLSB();
+    s.rat = sim.getRAT(); s.regs = sim.getArchRegs();
+    s.cycle_count = sim.cycle_count; s.committed_ins_count = sim.committed_ins_count; s.mispredict_count = sim.mispredict_count;
+    s.finished = sim.is_finished(); s.mispredict_penalty = sim.averageMispredictPenalty();
+    const BranchUnit& bu = sim.getBranchUnit();
+    s.predictor = bu.direction().name(); s.predictor_accuracy = bu.overall().accuracy();
+    s.width = sim.getWidthStats(); s.pipeline = sim.getPipelineStats(); s.lsq = sim.getLsqStats(); s.top_down = sim.topDown();
+    const MemoryHierarchy& mh = sim.getMemoryHierarchy();
+    s.caches = mh.enabled();
+    if (s.caches) { s.l1d = mh.l1d().counters; s.l2 = mh.l2().counters; s.prefetcher = mh.prefetcher_name(); s.prefetch_accuracy = mh.prefetch().accuracy(); }
+    s.profile = sim.getProfile();
+    const PagedMemory& mem = sim.getMemory();
+    s.memory_since = memory_since; s.memory_version = mem.version();
+    if (memory_since != UINT64_MAX) mem.for_each_dirty_page(memory_since, [&](const PagedMemory::Page& p) { s.pages.push_back(p); });
+    return s;
+}
+
+void SimulationRunner::publish(StopReason stop, double cycles_per_second) {
+    uint64_t since;
+    { std::lock_guard<std::mutex> lock(snapshot_mutex); since = memory_taken; }
+    // The copy is taken outside the lock; the UI waits only for the pointer swap. Once stopped the UI shows
+    // the live simulator, so the final snapshot carries no pages.
+    auto s = std::make_shared<SimulationSnapshot>(SimulationSnapshot::capture(sim, stop == StopReason::None ? since : UINT64_MAX));
+    s->serial = next_serial++; s->stop = stop; s->cycles_per_second = cycles_per_second;
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    snapshot = std::move(s);
+}
+
+void SimulationRunner::loop(RunBreakpoints bp) {
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now(); const uint64_t start_cycle = sim.cycle_count;
+    auto next_publish = start;
+    sim.setCommitBreakpoint(bp.address);
+    // advance() never passes cycle_limit, so the cycle breakpoint is exact even with idle-cycle skipping.
+    const uint64_t cycle_limit = bp.cycle ? bp.cycle : UINT64_MAX;
+    StopReason stop;
+    auto speed = [&] {
+        double secs = std::chrono::duration<double>(clock::now() - start).count();
+        return secs > 0 ? (sim.cycle_count - start_cycle) / secs : 0.0;
+    };
+    for (uint32_t n = 0;; ++n) {
+        if (sim.is_finished()) { stop = StopReason::Finished; break; }
+        if (sim.cycle_count >= cycle_limit) { stop = StopReason::CycleReached; break; }
+        if (bp.commits && sim.committed_ins_count >= bp.commits) { stop = StopReason::CommitsReached; break; }
+        if (sim.breakpoint_hit) { stop = StopReason::AddressReached; break; }
+        if (stop_requested.load(std::memory_order_relaxed)) { stop = StopReason::Paused; break; }
+        sim.advance(cycle_limit);
+        if (history) history->record(sim);
+        // Read the clock every 256 steps, not every cycle.
+        if ((n & 255) == 0 && snapshot_interval_ns.load(std::memory_order_relaxed) > 0 && clock::now() >= next_publish) {
+            publish(StopReason::None, speed());
+            next_publish = clock::now() + std::chrono::nanoseconds(snapshot_interval_ns.load(std::memory_order_relaxed));
+        }
+    }
+    sim.setCommitBreakpoint(-1);
+    publish(stop, speed());
+    active.store(false, std::memory_order_release);
+}
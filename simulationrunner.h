@@ -0,0 +1,85 @@
+#ifndef SIMULATIONRUNNER_H
+#define SIMULATIONRUNNER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "pipelinesimulator.h"
+#include "statehistory.h"
+
+// Stop conditions of a run. 0 / -1 disable a condition; the run always stops when the program finishes.
+struct RunBreakpoints {
+    uint64_t cycle = 0;      // stop once cycle_count reaches this
+    int64_t address = -1;    // stop after the cycle in which the instruction at this address retires
+    uint64_t commits = 0;    // stop once committed_ins_count reaches this
+};
+
+enum class StopReason : uint8_t { None, Paused, Finished, CycleReached, AddressReached, CommitsReached };
+const char* stop_reason_name(StopReason r);
+
+// What the GUI shows of the machine: the structure tables, the registers and the counters, copied by
+// capture(). Memory is not copied whole; `pages` holds the pages written after memory_since (see
+// PagedMemory::for_each_dirty_page), which the UI applies to its own mirror.
+struct SimulationSnapshot {
+    uint64_t serial = 0;
+    StopReason stop = StopReason::None; // None while the run goes on
+    double cycles_per_second = 0.0;     // host speed since the run started
+
+    const PipelineSimulator* program = nullptr; // program text and config only: a run does not change them
+    std::vector<ReorderBufferEntry> rob; int rob_head = 0, rob_tail = 0;
+    std::vector<ReservationStationEntry> alu_rs, mul_div_rs;
+    std::vector<LoadStoreBufferEntry> lsb;
+    std::array<RatEntry, NUM_REGS> rat{};
+    RegisterFile regs{};
+    uint64_t cycle_count = 0, committed_ins_count = 0, mispredict_count = 0; bool finished = false;
+    double mispredict_penalty = 0.0;
+    const char* predictor = ""; double predictor_accuracy = 0.0;
+    WidthStats width; PipelineStats pipeline; LsqStats lsq; TopDown top_down;
+    bool caches = false; CacheCounters l1d, l2; const char* prefetcher = ""; double prefetch_accuracy = 0.0;
+    std::vector<InstructionProfile> profile;
+    std::vector<PagedMemory::Page> pages; uint64_t memory_since = 0, memory_version = 0;
+
+    // memory_since == UINT64_MAX copies no pages (the caller reads the memory itself).
+    static SimulationSnapshot capture(const PipelineSimulator& sim, uint64_t memory_since);
+};
+
+// Runs a PipelineSimulator on a worker thread at full speed. While running() the worker owns the
+// simulator and the caller must not touch it; the worker publishes a snapshot at most
+// snapshot_rate times per second (plus one when it stops), which latest() hands out without ever
+// blocking the simulation for longer than a pointer swap.
+class SimulationRunner {
+public:
+    explicit SimulationRunner(PipelineSimulator& sim) : sim(sim) {}
+    ~SimulationRunner() { pause(); }
+    SimulationRunner(const SimulationRunner&) = delete;
+    SimulationRunner& operator=(const SimulationRunner&) = delete;
+
+    void run(const RunBreakpoints& breakpoints); // no-op if already running or finished
+    void pause();                                // returns once the worker has stopped
+    bool running() const { return active.load(std::memory_order_acquire); }
+    // Records every advance() into history (null: none); set only while stopped.
+    void setHistory(StateHistory* h) { history = h; }
+    void setSnapshotRate(double hz) { snapshot_interval_ns.store(hz > 0 ? static_cast<int64_t>(1e9 / hz) : 0); }
+
+    // Newest snapshot if its serial is greater than `seen`, otherwise null. The pages of the next
+    // snapshots are counted from the one returned; the first snapshot of a run carries every page.
+    std::shared_ptr<const SimulationSnapshot> latest(uint64_t seen);
+
+private:
+    void loop(RunBreakpoints breakpoints);
+    void publish(StopReason stop, double cycles_per_second);
+
+    PipelineSimulator& sim;
+    StateHistory* history = nullptr;
+    std::thread worker;
+    std::atomic<bool> active{false}, stop_requested{false};
+    std::atomic<int64_t> snapshot_interval_ns{1000000000 / 30};
+    mutable std::mutex snapshot_mutex;
+    std::shared_ptr<const SimulationSnapshot> snapshot;
+    uint64_t memory_taken = 0; // memory_version of the snapshot the UI last took (under snapshot_mutex)
+    uint64_t next_serial = 1;
+};
+
+#endif // SIMULATIONRUNNER_H
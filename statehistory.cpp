@@ -0,0 +1,144 @@
+#include "statehistory.h"
+#include <cstring>
+#include <type_traits>
+
+// Entries are compared and patched as raw bytes; padding may differ between copies, which only costs
+// a few extra delta bytes, never a missed change.
+static_assert(std::is_trivially_copyable<ReorderBufferEntry>::value && std::is_trivially_copyable<ReservationStationEntry>::value &&
+              std::is_trivially_copyable<LoadStoreBufferEntry>::value && std::is_trivially_copyable<RatEntry>::value &&
+              std::is_trivially_copyable<RegisterFile>::value, "StateHistory diffs these byte-wise");
+
+template<class T> static void copy_bytes(std::vector<T>& dst, const std::vector<T>& src) {
+    dst.resize(src.size()); if (!src.empty()) std::memcpy(static_cast<void*>(dst.data()), src.data(), src.size() * sizeof(T));
+}
+
+static void xor_into(void* target, const uint8_t*& p, size_t n) {
+    uint8_t* t = static_cast<uint8_t*>(target);
+    for (size_t pos = 0; pos < n;) {
+        pos += *p++; size_t len = *p++;
+        for (size_t k = 0; k < len; ++k) t[pos++] ^= *p++;
+    }
+}
+
+StateHistory::StateHistory(size_t max_states, size_t max_bytes) : max_states_(max_states < 2 ? 2 : max_states), max_bytes_(max_bytes) {}
+
+StateHistory::~StateHistory() { detach(); }
+
+void StateHistory::detach() {
+    if (recorded_) recorded_->data_memory.set_undo_log(nullptr);
+    recorded_ = nullptr;
+}
+
+StateHistory::CounterBlock StateHistory::counters_of(const PipelineSimulator& s) {
+    CounterBlock c; std::memset(&c, 0, sizeof(c)); // zeroed padding: the byte compare sees only real changes
+    c.cycle_count = s.cycle_count; c.program_counter = s.program_counter; c.committed = s.committed_ins_count;
+    c.mispredicts = s.mispredict_count; c.branches = s.total_branch_count; c.skipped = s.skipped_cycles;
+    c.penalty = s.mispredict_penalty_cycles; c.squashed = s.squashed_uop_count;
+    c.rob_count = s.rob_count; c.rob_head = s.rob_head; c.rob_tail = s.rob_tail; c.rob_head_q = s.rob_head_q; c.rob_tail_q = s.rob_tail_q;
+    c.finished = s.simulation_finished;
+    return c;
+}
+
+void StateHistory::set_counters(PipelineSimulator& s, const CounterBlock& c) {
+    s.cycle_count = c.cycle_count; s.program_counter = c.program_counter; s.committed_ins_count = c.committed;
+    s.mispredict_count = c.mispredicts; s.total_branch_count = c.branches; s.skipped_cycles = c.skipped;
+    s.mispredict_penalty_cycles = c.penalty; s.squashed_uop_count = c.squashed;
+    s.rob_count = c.rob_count; s.rob_head = c.rob_head; s.rob_tail = c.rob_tail; s.rob_head_q = c.rob_head_q; s.rob_tail_q = c.rob_tail_q;
+    s.simulation_finished = c.finished;
+}
+
+void StateHistory::start(PipelineSimulator& sim) {
+    detach();
+    recorded_ = &sim; sim.data_memory.set_undo_log(&writes_);
+    started_ = true; oldest_cycle_ = sim.cycle_count;
+    deltas_.clear(); bytes_ = 0; writes_.clear();
+    copy_bytes(rob_, sim.reorder_buffer); copy_bytes(alu_rs_, sim.alu_rs); copy_bytes(mul_div_rs_, sim.mul_div_rs); copy_bytes(lsb_, sim.lsb);
+    std::memcpy(static_cast<void*>(&rat_), &sim.register_alias_table, sizeof(rat_));
+    std::memcpy(static_cast<void*>(&regs_), &sim.reg_file, sizeof(regs_));
+    counters_ = counters_of(sim);
+}
+
+// Record: kind, index (8 bytes for a memory address, else 4), then (zero run, literal run, literal
+// bytes) triples up to n bytes. The literals are old ^ new.
+void StateHistory::put(Kind kind, int64_t index, const void* before, const void* after, size_t n) {
+    const uint8_t* a = static_cast<const uint8_t*>(before); const uint8_t* b = static_cast<const uint8_t*>(after);
+    scratch_.push_back(kind);
+    size_t index_bytes = kind == Memory ? 8 : 4; uint32_t index32 = static_cast<uint32_t>(index);
+    const uint8_t* ip = kind == Memory ? reinterpret_cast<const uint8_t*>(&index) : reinterpret_cast<const uint8_t*>(&index32);
+    scratch_.insert(scratch_.end(), ip, ip + index_bytes);
+    for (size_t i = 0; i < n;) {
+        size_t zeros = 0; while (i < n && zeros < 255 && a[i] == b[i]) { ++i; ++zeros; }
+        size_t start = i, len = 0; while (i < n && len < 255 && a[i] != b[i]) { ++i; ++len; }
+        scratch_.push_back(static_cast<uint8_t>(zeros)); scratch_.push_back(static_cast<uint8_t>(len));
+        for (size_t k = 0; k < len; ++k) scratch_.push_back(a[start + k] ^ b[start + k]);
+    }
+}
+
+template<class T> void StateHistory::diff(Kind kind, const T* now, T* shadow, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (std::memcmp(&now[i], &shadow[i], sizeof(T)) == 0) continue;
+        put(kind, static_cast<int64_t>(i), &shadow[i], &now[i], sizeof(T));
+        std::memcpy(static_cast<void*>(&shadow[i]), &now[i], sizeof(T));
+    }
+}
+
+void StateHistory::record(PipelineSimulator& sim) {
+    scratch_.clear();
+    CounterBlock c = counters_of(sim);
+    diff(Counters, &c, &counters_, 1);
+    diff(Rob, sim.reorder_buffer.data(), rob_.data(), rob_.size());
+    diff(AluRs, sim.alu_rs.data(), alu_rs_.data(), alu_rs_.size());
+    diff(MulDivRs, sim.mul_div_rs.data(), mul_div_rs_.data(), mul_div_rs_.size());
+    diff(Lsb, sim.lsb.data(), lsb_.data(), lsb_.size());
+    diff(Rat, &sim.register_alias_table, &rat_, 1);
+    diff(Registers, &sim.reg_file, &regs_, 1);
+    // An address can be written several times in one step; the first record holds the value before the step.
+    for (size_t i = 0; i < writes_.size(); ++i) {
+        const PagedMemory::WordUndo& w = writes_[i];
+        bool seen = false;
+        for (size_t j = 0; j < i && !seen; ++j) seen = writes_[j].address == w.address;
+        if (seen) continue;
+        MemoryWord before{w.value, w.written}, after{sim.data_memory.read(w.address), sim.data_memory.contains(w.address)};
+        if (std::memcmp(&before, &after, sizeof(before)) != 0) put(Memory, w.address, &before, &after, sizeof(before));
+    }
+    writes_.clear();
+    if (scratch_.empty()) return;
+
+    deltas_.push_back({sim.cycle_count, std::vector<uint8_t>(scratch_.begin(), scratch_.end())});
+    bytes_ += sizeof(Delta) + scratch_.size();
+    while (deltas_.size() + 1 > max_states_ || (bytes_ > max_bytes_ && deltas_.size() > 1)) {
+        oldest_cycle_ = deltas_.front().cycle; bytes_ -= sizeof(Delta) + deltas_.front().data.size();
+        deltas_.pop_front();
+    }
+}
+
+void StateHistory::apply(PipelineSimulator& view, const Delta& d) {
+    const uint8_t* p = d.data.data(); const uint8_t* end = p + d.data.size();
+    while (p < end) {
+        Kind kind = static_cast<Kind>(*p++);
+        int64_t index = 0; uint32_t index32 = 0;
+        if (kind == Memory) { std::memcpy(&index, p, 8); p += 8; } else { std::memcpy(&index32, p, 4); p += 4; index = index32; }
+        switch (kind) {
+        case Counters: { CounterBlock c = counters_of(view); xor_into(&c, p, sizeof(c)); set_counters(view, c); break; }
+        case Rob: xor_into(&view.reorder_buffer[index], p, sizeof(ReorderBufferEntry)); break;
+        case AluRs: xor_into(&view.alu_rs[index], p, sizeof(ReservationStationEntry)); break;
+        case MulDivRs: xor_into(&view.mul_div_rs[index], p, sizeof(ReservationStationEntry)); break;
+        case Lsb: xor_into(&view.lsb[index], p, sizeof(LoadStoreBufferEntry)); break;
+        case Rat: xor_into(&view.register_alias_table, p, sizeof(view.register_alias_table)); break;
+        case Registers: xor_into(&view.reg_file, p, sizeof(view.reg_file)); break;
+        case Memory: {
+            MemoryWord w{view.data_memory.read(index), view.data_memory.contains(index)};
+            xor_into(&w, p, sizeof(w));
+            view.data_memory.restore(index, w.value, w.written != 0);
+            break;
+        }
+        }
+    }
+}
+
+void StateHistory::seek(PipelineSimulator& view, size_t& position, size_t target) const {
+    if (states() == 0) return;
+    if (target >= states()) target = states() - 1;
+    for (; position > target; --position) apply(view, deltas_[position - 1]);
+    for (; position < target; ++position) apply(view, deltas_[position]);
+}
@@ -0,0 +1,72 @@
+#ifndef STATEHISTORY_H
+#define STATEHISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "pipelinesimulator.h"
+
+// Reverse stepping: a bounded ring of per-step deltas of the state the GUI shows - ROB, RS and LSB
+// entries, the RAT, the register file, data memory words and the cycle/commit counters.
+//
+// A delta keeps, for each entry that changed, the XOR of its old and new bytes with the runs of zero
+// bytes coded away, so its size follows what the step changed and the same record moves a state one
+// step back or one step forward. Predictor, cache and statistics state is not recorded: a rewound
+// copy is for inspection, the recorded simulator always continues from the newest state.
+class StateHistory {
+public:
+    explicit StateHistory(size_t max_states = size_t(1) << 20, size_t max_bytes = size_t(64) << 20);
+    ~StateHistory();
+    StateHistory(const StateHistory&) = delete;
+    StateHistory& operator=(const StateHistory&) = delete;
+
+    // Starts a new history at sim's current state (after loading, reset or a configuration change) and
+    // hooks its memory writes. Every step()/advance() of sim from then on must be followed by record().
+    void start(PipelineSimulator& sim);
+    void record(PipelineSimulator& sim); // no-op if nothing changed
+    void detach();                       // unhooks the recorded simulator's memory
+
+    // States are numbered from the oldest one kept (0) to the current one (states() - 1).
+    size_t states() const { return started_ ? deltas_.size() + 1 : 0; }
+    uint64_t cycleOf(size_t state) const { return state == 0 ? oldest_cycle_ : deltas_[state - 1].cycle; }
+    size_t bytes() const { return bytes_; }
+
+    // Moves `view` from `position` to state `target`. A view starts as a copy of the recorded simulator
+    // with position = states() - 1; positions become invalid once record() evicts old states.
+    void seek(PipelineSimulator& view, size_t& position, size_t target) const;
+
+private:
+    enum Kind : uint8_t { Counters, Rob, AluRs, MulDivRs, Lsb, Rat, Registers, Memory };
+    struct CounterBlock {
+        uint64_t cycle_count, program_counter, committed, mispredicts, branches, skipped, penalty, squashed;
+        int32_t rob_count, rob_head, rob_tail, rob_head_q, rob_tail_q; uint8_t finished;
+    };
+    struct MemoryWord { int64_t value; uint64_t written; };
+    struct Delta { uint64_t cycle; std::vector<uint8_t> data; }; // cycle of the state after the step
+
+    static CounterBlock counters_of(const PipelineSimulator& s);
+    static void set_counters(PipelineSimulator& s, const CounterBlock& c);
+    template<class T> void diff(Kind kind, const T* now, T* shadow, size_t n);
+    void put(Kind kind, int64_t index, const void* before, const void* after, size_t n);
+    static void apply(PipelineSimulator& view, const Delta& d);
+
+    size_t max_states_, max_bytes_;
+    bool started_ = false;
+    PipelineSimulator* recorded_ = nullptr;
+    uint64_t oldest_cycle_ = 0;
+    std::deque<Delta> deltas_;
+    size_t bytes_ = 0;
+
+    // Copies of the last recorded state, compared byte-wise against the simulator after each step.
+    std::vector<ReorderBufferEntry> rob_;
+    std::vector<ReservationStationEntry> alu_rs_, mul_div_rs_;
+    std::vector<LoadStoreBufferEntry> lsb_;
+    std::array<RatEntry, NUM_REGS> rat_;
+    RegisterFile regs_;
+    CounterBlock counters_;
+    std::vector<PagedMemory::WordUndo> writes_; // filled by the memory hook during a step
+    std::vector<uint8_t> scratch_;
+};
+
+#endif // STATEHISTORY_H
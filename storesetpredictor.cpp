@@ -0,0 +1,16 @@
+#include "storesetpredictor.h"
+#include "checkpoint.h"
+#include <algorithm>
+
+void StoreSetPredictor::record_violation(uint64_t load_pc, uint64_t store_pc) {
+    if (ssit_.empty()) return;
+    uint32_t& l = ssit_[load_pc & (ssit_.size() - 1)];
+    uint32_t& s = ssit_[store_pc & (ssit_.size() - 1)];
+    // Neither in a set: new set; one in a set: the other joins it; both: the smaller id wins.
+    if (!l && !s) l = s = next_id_++;
+    else if (!l) l = s;
+    else if (!s) s = l;
+    else l = s = std::min(l, s);
+}
+
+void StoreSetPredictor::checkpoint(CheckpointIO& io) { io.vec(ssit_, true); io.pod(next_id_); }
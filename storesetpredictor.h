@@ -0,0 +1,24 @@
+#ifndef STORESETPREDICTOR_H
+#define STORESETPREDICTOR_H
+
+#include <cstdint>
+#include <vector>
+
+class CheckpointIO;
+
+// Store-set memory dependence predictor (Chrysos & Emer), without the LFST: a PC-indexed table maps
+// loads and stores to store-set ids. A memory-order violation puts the load and the store in the same
+// set; from then on the load waits for every older store of its set whose address is still unknown.
+class StoreSetPredictor {
+public:
+    explicit StoreSetPredictor(int entries = 0) : ssit_(entries, 0) {}
+    uint32_t set_of(uint64_t pc) const { return ssit_.empty() ? 0 : ssit_[pc & (ssit_.size() - 1)]; } // 0 = no set
+    void record_violation(uint64_t load_pc, uint64_t store_pc);
+    uint64_t sets_created() const { return next_id_ - 1; }
+    void checkpoint(CheckpointIO& io); // see checkpoint.h
+private:
+    std::vector<uint32_t> ssit_;
+    uint32_t next_id_ = 1;
+};
+
+#endif // STORESETPREDICTOR_H
@@ -0,0 +1,175 @@
+#include "sweepengine.h"
+#include "pipelinesimulator.h"
+#include "textutil.h"
+#include "threadpool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+static long long parse_int(const std::string& key, const std::string& text) {
+    long long v = 0; size_t used = 0;
+    try { v = std::stoll(text, &used); } catch (...) { used = 0; }
+    if (used == 0 || used != text.size()) throw std::runtime_error("Sweep value for " + key + " is not an integer: " + text);
+    return v;
+}
+
+SweepParameter SweepParameter::parse(const std::string& key, const std::string& spec) {
+    SweepParameter p; p.key = trim(key);
+    const MachineConfig::Field* field = MachineConfig::find_field(p.key);
+    if (!field) throw std::runtime_error("Unknown config key: " + p.key);
+    // Every value goes through MachineConfig::set so bad names are reported here, not per run.
+    auto add = [&](const std::string& value) { MachineConfig probe; probe.set(p.key, value); p.values.push_back(probe.value_string(*field)); };
+    std::stringstream ss(spec); std::string item;
+    while (std::getline(ss, item, ',')) {
+        item = trim(item);
+        if (item.empty()) continue;
+        size_t dots = item.find("..");
+        if (dots == std::string::npos || field->names) { add(item); continue; }
+        std::string hi_text = item.substr(dots + 2), step_text = "1";
+        size_t colon = hi_text.find(':');
+        if (colon != std::string::npos) { step_text = hi_text.substr(colon + 1); hi_text = hi_text.substr(0, colon); }
+        long long lo = parse_int(p.key, trim(item.substr(0, dots))), hi = parse_int(p.key, trim(hi_text)), step = parse_int(p.key, trim(step_text));
+        if (step <= 0 || hi < lo) throw std::runtime_error("Bad sweep range for " + p.key + ": " + item);
+        for (long long v = lo; v <= hi; v += step) add(std::to_string(v));
+    }
+    if (p.values.empty()) throw std::runtime_error("No values given for sweep parameter " + p.key);
+    return p;
+}
+
+void SweepEngine::load_grid_file(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Cannot open grid file: " + path);
+    std::string line; int line_no = 0;
+    while (std::getline(in, line)) {
+        line_no++;
+        size_t comment = line.find('#'); if (comment != std::string::npos) line = line.substr(0, comment);
+        line = trim(line);
+        if (line.empty()) continue;
+        size_t eq = line.find('=');
+        try {
+            if (eq == std::string::npos) throw std::runtime_error("Expected key = values, got: " + line);
+            grid.push_back(SweepParameter::parse(line.substr(0, eq), line.substr(eq + 1)));
+        } catch (const std::exception& e) { throw std::runtime_error(path + ": line " + std::to_string(line_no) + ": " + e.what()); }
+    }
+}
+
+size_t SweepEngine::point_count() const {
+    size_t n = 1;
+    for (const auto& p : grid) n *= p.values.size();
+    return n;
+}
+
+// Mixed-radix decode; the last grid parameter varies fastest.
+std::vector<std::string> SweepEngine::point_values(size_t point) const {
+    std::vector<std::string> out(grid.size());
+    for (size_t i = grid.size(); i-- > 0;) {
+        out[i] = grid[i].values[point % grid[i].values.size()];
+        point /= grid[i].values.size();
+    }
+    return out;
+}
+
+MachineConfig SweepEngine::config_for_point(size_t point) const {
+    MachineConfig cfg = base_config;
+    std::vector<std::string> values = point_values(point);
+    for (size_t i = 0; i < grid.size(); ++i) cfg.set(grid[i].key, values[i]);
+    cfg.validate();
+    return cfg;
+}
+
+SweepJobResult SweepEngine::run_job(size_t point, size_t program) const {
+    SweepJobResult r; r.point = point; r.program = program;
+    try {
+        PipelineSimulator sim(config_for_point(point));
+        sim.parse_and_load_program(programs[program].source);
+        for (const auto& image : data_images) sim.preloadData(image.base, image.words);
+        auto t0 = std::chrono::steady_clock::now();
+        while (!sim.is_finished() && sim.cycle_count < max_cycles) sim.advance(max_cycles);
+        r.host_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        r.finished = sim.is_finished();
+        r.cycles = sim.cycle_count; r.committed = sim.committed_ins_count;
+        r.branches = sim.total_branch_count; r.mispredicts = sim.mispredict_count;
+        r.mispredict_penalty = sim.averageMispredictPenalty();
+        r.l1d_hit_rate = sim.getMemoryHierarchy().l1d().counters.hit_rate(); r.l2_hit_rate = sim.getMemoryHierarchy().l2().counters.hit_rate();
+        const TopDown t = sim.topDown();
+        r.retiring = t.fraction(t.retiring); r.bad_speculation = t.fraction(t.bad_speculation);
+        r.frontend_bound = t.fraction(t.frontend_bound); r.backend_bound = t.fraction(t.backend_bound);
+    } catch (const std::exception& e) { r.error = e.what(); }
+    return r;
+}
+
+std::vector<SweepJobResult> SweepEngine::run(unsigned threads, const std::function<void(size_t, size_t)>& progress) const {
+    const size_t total = job_count();
+    std::vector<SweepJobResult> results(total);
+    std::atomic<size_t> done{0};
+    WorkStealingPool pool(threads);
+    // Each job writes only its own result slot; the order follows the job index, not the timing.
+    for (size_t job = 0; job < total; ++job) {
+        pool.submit([this, job, total, &results, &done, &progress] {
+            results[job] = run_job(job / programs.size(), job % programs.size());
+            size_t n = ++done;
+            if (progress) progress(n, total);
+        });
+    }
+    pool.wait_idle();
+    return results;
+}
+
+static std::string csv_field(const std::string& s) {
+    if (s.find_first_of(",\"\n\r") == std::string::npos) return s;
+    std::string out = "\"";
+    for (char c : s) { if (c == '"') out += '"'; out += c; }
+    return out + "\"";
+}
+
+static std::string format_ratio(double v) {
+    char buf[32]; std::snprintf(buf, sizeof(buf), "%.6f", v);
+    return buf;
+}
+
+void SweepEngine::write_csv(std::ostream& os, const std::vector<SweepJobResult>& results, bool host_time) const {
+    os << "program";
+    for (const auto& p : grid) os << "," << p.key;
+    os << ",finished,cycles,committed,ipc,branches,mispredicts,mispredict_penalty,l1d_hit_rate,l2_hit_rate,retiring,bad_speculation,frontend_bound,backend_bound";
+    if (host_time) os << ",host_seconds";
+    os << ",error\n";
+    for (const auto& r : results) {
+        os << csv_field(programs[r.program].name);
+        for (const auto& v : point_values(r.point)) os << "," << v;
+        os << "," << (r.finished ? 1 : 0) << "," << r.cycles << "," << r.committed << "," << format_ratio(r.ipc())
+           << "," << r.branches << "," << r.mispredicts << "," << format_ratio(r.mispredict_penalty)
+           << "," << format_ratio(r.l1d_hit_rate) << "," << format_ratio(r.l2_hit_rate)
+           << "," << format_ratio(r.retiring) << "," << format_ratio(r.bad_speculation) << "," << format_ratio(r.frontend_bound) << "," << format_ratio(r.backend_bound);
+        if (host_time) os << "," << r.host_seconds;
+        os << "," << csv_field(r.error) << "\n";
+    }
+}
+
+void SweepEngine::write_json(std::ostream& os, const std::vector<SweepJobResult>& results, bool host_time) const {
+    os << "[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const SweepJobResult& r = results[i];
+        os << "  {\"program\": \"" << json_escape(programs[r.program].name) << "\", \"params\": {";
+        std::vector<std::string> values = point_values(r.point);
+        for (size_t k = 0; k < grid.size(); ++k) {
+            bool quoted = MachineConfig::find_field(grid[k].key)->names != nullptr;
+            os << (k ? ", " : "") << "\"" << grid[k].key << "\": " << (quoted ? "\"" + values[k] + "\"" : values[k]);
+        }
+        os << "}";
+        if (!r.error.empty()) os << ", \"error\": \"" << json_escape(r.error) << "\"";
+        else {
+            os << ", \"finished\": " << (r.finished ? "true" : "false") << ", \"cycles\": " << r.cycles << ", \"committed\": " << r.committed
+               << ", \"ipc\": " << format_ratio(r.ipc()) << ", \"branches\": " << r.branches << ", \"mispredicts\": " << r.mispredicts
+               << ", \"mispredict_penalty\": " << format_ratio(r.mispredict_penalty)
+               << ", \"l1d_hit_rate\": " << format_ratio(r.l1d_hit_rate) << ", \"l2_hit_rate\": " << format_ratio(r.l2_hit_rate)
+               << ", \"retiring\": " << format_ratio(r.retiring) << ", \"bad_speculation\": " << format_ratio(r.bad_speculation)
+               << ", \"frontend_bound\": " << format_ratio(r.frontend_bound) << ", \"backend_bound\": " << format_ratio(r.backend_bound);
+            if (host_time) os << ", \"host_seconds\": " << r.host_seconds;
+        }
+        os << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    os << "]\n";
+}
@@ -0,0 +1,60 @@
+#ifndef SWEEPENGINE_H
+#define SWEEPENGINE_H
+
+#include "machineconfig.h"
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Design-space sweep: runs every (grid point x program) combination on its own PipelineSimulator
+// instance across a work-stealing pool. Results are stored by job index, so the table is identical
+// whatever the thread count or scheduling order.
+struct SweepParameter {
+    std::string key;
+    std::vector<std::string> values;
+    // "32,64,128", "1..4" or "32..256:32" (inclusive range with step).
+    static SweepParameter parse(const std::string& key, const std::string& spec);
+};
+
+struct SweepProgram { std::string name, source; };
+struct SweepDataImage { int64_t base = 0; std::vector<int64_t> words; }; // read once, preloaded into every run
+
+struct SweepJobResult {
+    size_t point = 0, program = 0;
+    std::string error;
+    bool finished = false;
+    uint64_t cycles = 0, committed = 0, branches = 0, mispredicts = 0;
+    double mispredict_penalty = 0.0; // average cycles per mispredict
+    double l1d_hit_rate = 0.0, l2_hit_rate = 0.0; // demand loads; 0 when the level is absent
+    double retiring = 0.0, bad_speculation = 0.0, frontend_bound = 0.0, backend_bound = 0.0; // top-down slot fractions
+    double host_seconds = 0.0;
+    double ipc() const { return cycles ? (double)committed / cycles : 0.0; }
+};
+
+class SweepEngine {
+public:
+    MachineConfig base_config;
+    std::vector<SweepParameter> grid;
+    std::vector<SweepProgram> programs;
+    std::vector<SweepDataImage> data_images;
+    uint64_t max_cycles = 100000000;
+
+    // Grid file: one "key = values" line per swept parameter, '#' comments.
+    void load_grid_file(const std::string& path);
+
+    size_t point_count() const;
+    size_t job_count() const { return point_count() * programs.size(); }
+    std::vector<std::string> point_values(size_t point) const; // value of each grid parameter
+    MachineConfig config_for_point(size_t point) const;        // throws on invalid combinations
+
+    // progress(done, total) is called from worker threads.
+    std::vector<SweepJobResult> run(unsigned threads, const std::function<void(size_t, size_t)>& progress = {}) const;
+    SweepJobResult run_job(size_t point, size_t program) const;
+
+    void write_csv(std::ostream& os, const std::vector<SweepJobResult>& results, bool host_time) const;
+    void write_json(std::ostream& os, const std::vector<SweepJobResult>& results, bool host_time) const;
+};
+
+#endif // SWEEPENGINE_H
@@ -0,0 +1,81 @@
+// A checkpoint saved mid-run and restored into a fresh simulator must continue bit-exact: for every example
+// program under every example configuration, saves at a third and at two thirds of the run and checks that
+// the restored machine saves back to the same bytes and then finishes exactly like an uninterrupted run.
+// The final comparison goes through state_digest: copied RAT snapshots carry struct padding, so two runs
+// with different histories need not agree byte for byte.
+// A truncated or tampered checkpoint must be rejected with std::runtime_error or, where the damage hits a
+// plain value, load into a machine that still steps; AddressSanitizer builds catch any index that slips through.
+#include "test_util.h"
+#include <cstring>
+
+// The whole machine as a checkpoint writes it (checkpoint() saves without changing the simulator).
+static std::vector<uint8_t> machine_state(PipelineSimulator& sim) { CheckpointIO io; sim.checkpoint(io); return io.buffer(); }
+
+static void write_file(const std::string& path, const std::vector<uint8_t>& data) {
+    std::ofstream out(path, std::ios::binary); out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+// Loads a damaged copy of a checkpoint. Returns the error message, or "" if it loaded (and then stepped).
+static std::string load_damaged(const std::string& file, const std::vector<uint8_t>& data) {
+    write_file(file, data);
+    PipelineSimulator sim;
+    try { load_checkpoint(sim, file); } catch (const std::runtime_error& e) { return e.what(); }
+    for (int i = 0; i < 64 && !sim.is_finished(); ++i) sim.step();
+    return "";
+}
+
+// Saves mid-run, then feeds load_checkpoint truncations of the file and, one offset at a time, the file
+// with an int32 of -2 (never a valid index or ROB tag) written over the machine state. Every offset is
+// tried in the header and in the first 12 KB of the state, where the ROB, stations, wakeup lists and
+// RATs are, and every 61st after that; without caches the remaining state is small.
+static void check_damaged(const std::string& path, const std::string& file) {
+    MachineConfig config; config.l1d_size = 0;
+    PipelineSimulator sim(config);
+    sim.parse_and_load_program(read_file(path));
+    for (int i = 0; i < 40 && !sim.is_finished(); ++i) sim.step();
+    save_checkpoint(sim, file);
+    std::ifstream in(file, std::ios::binary);
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const size_t state_at = data.size() - machine_state(sim).size();
+    for (size_t n = 0; n < data.size(); n += n < state_at ? 1 : 61) {
+        std::vector<uint8_t> cut(data.begin(), data.begin() + n);
+        check(!load_damaged(file, cut).empty(), path + ": checkpoint truncated to " + std::to_string(n) + " bytes was accepted");
+    }
+    const int32_t bad = -2; size_t corrupt = 0;
+    for (size_t at = state_at; at + sizeof(bad) <= data.size(); at += at < state_at + 12 * 1024 ? 1 : 61) {
+        std::vector<uint8_t> tampered = data;
+        std::memcpy(tampered.data() + at, &bad, sizeof(bad));
+        if (load_damaged(file, tampered) == "Checkpoint is corrupt") ++corrupt;
+    }
+    check(corrupt > 0, path + ": no tampered index was reported as a corrupt checkpoint");
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) { std::fprintf(stderr, "usage: %s <examples dir>\n", argv[0]); return 2; }
+    const std::string dir = argv[1];
+    const std::string file = (std::filesystem::temp_directory_path() / "pipelight_checkpoint_test.plckpt").string();
+    const uint64_t max_cycles = 10000000;
+    for (const auto& [config_name, config] : example_configs(dir)) {
+        for (const std::string& path : example_files(dir, ".asm")) {
+            const std::string run = path + " (" + config_name + ")";
+            PipelineSimulator reference(config);
+            reference.parse_and_load_program(read_file(path));
+            while (!reference.is_finished() && reference.cycle_count < max_cycles) reference.step();
+            check(reference.is_finished(), run + ": did not finish within " + std::to_string(max_cycles) + " cycles");
+            for (uint64_t cut : {reference.cycle_count / 3, 2 * reference.cycle_count / 3}) {
+                const std::string at = run + " restored at cycle " + std::to_string(cut);
+                PipelineSimulator saved(config), restored;
+                saved.parse_and_load_program(read_file(path));
+                while (saved.cycle_count < cut) saved.step();
+                save_checkpoint(saved, file);
+                load_checkpoint(restored, file);
+                check(machine_state(restored) == machine_state(saved), at + ": restored state differs from the saved one");
+                while (!restored.is_finished() && restored.cycle_count < max_cycles) restored.step();
+                check(state_digest(restored) == state_digest(reference), at + ": final state differs from the uninterrupted run");
+            }
+        }
+    }
+    check_damaged(example_files(dir, ".asm").front(), file);
+    std::filesystem::remove(file);
+    return test_result("checkpoint_test");
+}
@@ -0,0 +1,27 @@
+// Sweep results are stored by job index, so the table must not depend on the thread count or on the
+// order in which workers steal jobs: runs examples/sweep.grid over every example program on 1, 2 and 4
+// threads and compares the CSV output.
+#include "sweepengine.h"
+#include "test_util.h"
+#include <sstream>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) { std::fprintf(stderr, "usage: %s <examples dir>\n", argv[0]); return 2; }
+    const std::string dir = argv[1];
+    SweepEngine engine;
+    engine.load_grid_file(dir + "/sweep.grid");
+    for (const std::string& path : example_files(dir, ".asm")) engine.programs.push_back({path, read_file(path)});
+    check(!engine.programs.empty(), "no example programs in " + dir);
+
+    std::string reference;
+    for (unsigned threads : {1u, 2u, 4u}) {
+        std::vector<SweepJobResult> results = engine.run(threads);
+        check(results.size() == engine.job_count(), std::to_string(threads) + " threads: wrong number of results");
+        for (const SweepJobResult& r : results)
+            check(r.error.empty(), engine.programs[r.program].name + ": " + r.error);
+        std::ostringstream csv; engine.write_csv(csv, results, false);
+        if (threads == 1) reference = csv.str();
+        else check(csv.str() == reference, std::to_string(threads) + " threads: results differ from the single-threaded sweep");
+    }
+    return test_result("sweep_threads_test");
+}
@@ -0,0 +1,73 @@
+#ifndef PIPELIGHT_TEST_UTIL_H
+#define PIPELIGHT_TEST_UTIL_H
+
+// Shared helpers of the regression tests under tests/: each test is a plain executable that takes the
+// examples directory as its argument, prints one line per failed check and exits non-zero if any failed.
+#include "checkpoint.h"
+#include "pipelinesimulator.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+inline int test_failures = 0;
+
+inline void check(bool ok, const std::string& what) {
+    if (ok) return;
+    ++test_failures; std::fprintf(stderr, "FAIL: %s\n", what.c_str());
+}
+
+// Files in dir with the given extension, sorted by name so runs are reproducible.
+inline std::vector<std::string> example_files(const std::string& dir, const std::string& extension) {
+    std::vector<std::string> files;
+    for (const auto& entry : std::filesystem::directory_iterator(dir))
+        if (entry.path().extension() == extension) files.push_back(entry.path().string());
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+inline std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary); std::stringstream ss; ss << in.rdbuf();
+    return ss.str();
+}
+
+// Default machine plus every examples/*.cfg, so the checks also cover caches, ports and wide issue.
+inline std::vector<std::pair<std::string, MachineConfig>> example_configs(const std::string& dir) {
+    std::vector<std::pair<std::string, MachineConfig>> configs = {{"defaults", MachineConfig()}};
+    for (const std::string& path : example_files(dir, ".cfg")) { MachineConfig c; c.load_file(path); configs.push_back({path, c}); }
+    return configs;
+}
+
+// Everything a run reports: cycles and counters, registers and flags, every written memory word, the
+// width, LSQ, top-down, pipeline, cache and per-instruction statistics. skipped_cycles is left out,
+// since it only says how the cycles were simulated.
+inline std::vector<uint8_t> state_digest(const PipelineSimulator& sim) {
+    CheckpointIO io;
+    uint64_t counters[] = {sim.cycle_count, sim.program_counter, sim.committed_ins_count, sim.mispredict_count,
+                           sim.total_branch_count, sim.mispredict_penalty_cycles, sim.squashed_uop_count, sim.is_finished()};
+    io.pod(counters);
+    RegisterFile regs = sim.getArchRegs(); io.pod(regs.gpr);
+    uint8_t flags[] = {regs.ZF, regs.SF, regs.OF}; io.pod(flags);
+    std::vector<int64_t> words;
+    sim.getMemory().for_each_word([&](int64_t address, int64_t value) { words.push_back(address); words.push_back(value); });
+    io.vec(words);
+    WidthStats width = sim.getWidthStats(); io.pod(width);
+    LsqStats lsq = sim.getLsqStats(); io.pod(lsq);
+    TopDown top_down = sim.topDown(); io.pod(top_down);
+    PipelineStats pipeline = sim.getPipelineStats(); pipeline.checkpoint(io);
+    const MemoryHierarchy& mh = sim.getMemoryHierarchy();
+    if (mh.enabled()) { CacheCounters l1 = mh.l1d().counters, l2 = mh.l2().counters; io.pod(l1); io.pod(l2); }
+    std::vector<InstructionProfile> profile = sim.getProfile(); io.vec(profile);
+    return io.buffer();
+}
+
+inline int test_result(const char* name) {
+    if (test_failures) std::fprintf(stderr, "%s: %d check(s) failed\n", name, test_failures);
+    else std::printf("%s: ok\n", name);
+    return test_failures ? 1 : 0;
+}
+
+#endif // PIPELIGHT_TEST_UTIL_H
@@ -0,0 +1,13 @@
+#ifndef TEXTUTIL_H
+#define TEXTUTIL_H
+
+#include <string>
+
+// Small string helpers shared by the config and grid parsers and the JSON writers.
+
+// s without leading and trailing spaces, tabs and line breaks.
+std::string trim(const std::string& s);
+// s as the body of a JSON string literal: quotes, backslashes and control characters escaped.
+std::string json_escape(const std::string& s);
+
+#endif // TEXTUTIL_H
@@ -0,0 +1,60 @@
+#include "threadpool.h"
+
+WorkStealingPool::WorkStealingPool(unsigned threads_requested) {
+    unsigned n = threads_requested ? threads_requested : std::thread::hardware_concurrency();
+    if (n == 0) n = 1;
+    for (unsigned i = 0; i < n; ++i) workers.push_back(std::make_unique<Worker>());
+    for (unsigned i = 0; i < n; ++i) threads.emplace_back([this, i] { worker_loop(i); });
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    { std::lock_guard<std::mutex> lock(state_mutex); stopping = true; }
+    work_cv.notify_all();
+    for (auto& t : threads) t.join();
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    unsigned target;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        unfinished++; queued++;
+        target = next_worker; next_worker = (next_worker + 1) % workers.size();
+    }
+    { std::lock_guard<std::mutex> lock(workers[target]->mutex); workers[target]->tasks.push_back(std::move(task)); }
+    work_cv.notify_one();
+}
+
+void WorkStealingPool::wait_idle() {
+    std::unique_lock<std::mutex> lock(state_mutex);
+    idle_cv.wait(lock, [this] { return unfinished == 0; });
+}
+
+bool WorkStealingPool::try_pop(unsigned self, std::function<void()>& task) {
+    {
+        Worker& own = *workers[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) { task = std::move(own.tasks.back()); own.tasks.pop_back(); return true; }
+    }
+    for (size_t k = 1; k < workers.size(); ++k) {
+        Worker& victim = *workers[(self + k) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) { task = std::move(victim.tasks.front()); victim.tasks.pop_front(); return true; }
+    }
+    return false;
+}
+
+void WorkStealingPool::worker_loop(unsigned self) {
+    for (;;) {
+        std::function<void()> task;
+        if (try_pop(self, task)) {
+            queued--;
+            task();
+            std::lock_guard<std::mutex> lock(state_mutex);
+            if (--unfinished == 0) idle_cv.notify_all();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(state_mutex);
+        work_cv.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) return;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool: every worker owns a deque, pops its own work from the back and
+// steals from the front of the other workers' deques when it runs dry.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(unsigned threads = 0); // 0 = std::thread::hardware_concurrency()
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void submit(std::function<void()> task);
+    void wait_idle(); // blocks until every submitted task has finished
+    unsigned thread_count() const { return static_cast<unsigned>(workers.size()); }
+
+private:
+    struct Worker { std::mutex mutex; std::deque<std::function<void()>> tasks; };
+    bool try_pop(unsigned self, std::function<void()>& task);
+    void worker_loop(unsigned self);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::mutex state_mutex;
+    std::condition_variable work_cv, idle_cv;
+    std::atomic<size_t> queued{0};
+    size_t unfinished = 0;
+    unsigned next_worker = 0;
+    bool stopping = false;
+};
+
+#endif // THREADPOOL_H